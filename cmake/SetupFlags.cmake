@@ -1,6 +1,7 @@
 include(CheckCXXCompilerFlag)
 
 option(LW_DISABLE_FASTMATH "Disable math optimizations [Not recommended]" OFF)
+option(LW_EXACT_TRANSCENDENTALS "Use the standard library instead of approximations in hot paths" OFF)
 
 if(NOT LW_DISABLE_FASTMATH)
 	if((CMAKE_CXX_COMPILER_ID MATCHES "MSVC") OR (CMAKE_CXX_COMPILER_FRONTEND_VARIANT MATCHES "MSVC"))
@@ -18,3 +19,9 @@ endif()
 function(add_fastmath TARGET)
     target_compile_options(${TARGET} PRIVATE ${FF_FLAGS})
 endfunction()
+
+function(add_math_defines TARGET)
+    if(LW_EXACT_TRANSCENDENTALS)
+        target_compile_definitions(${TARGET} PUBLIC LW_EXACT_TRANSCENDENTALS)
+    endif()
+endfunction()
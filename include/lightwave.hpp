@@ -14,6 +14,8 @@
 #include <lightwave/registry.hpp>
 
 // MARK: - utilities
+#include <lightwave/dispatch.hpp>
+#include <lightwave/fastmath.hpp>
 #include <lightwave/hash.hpp>
 #include <lightwave/iterators.hpp>
 #include <lightwave/parallel.hpp>
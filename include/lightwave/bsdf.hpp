@@ -18,6 +18,9 @@ struct BsdfSample {
     /// @brief The weight of the sample, given by @code cos(theta) * B(wi, wo) /
     /// p(wi) @endcode
     Color weight;
+    /// @brief The solid angle density with which @c wi was sampled, or zero if
+    /// it was drawn from a Dirac delta distribution (e.g., perfect mirrors).
+    float pdf = 0;
 
     /// @brief Return an invalid sample, used to denote that sampling has
     /// failed.
@@ -25,6 +28,7 @@ struct BsdfSample {
         return {
             .wi     = Vector(0),
             .weight = Color(0),
+            .pdf    = 0,
         };
     }
 
@@ -38,11 +42,16 @@ struct BsdfEval {
     /// @brief The value of the Bsdf, given by @code cos(theta) * B(wi, wo)
     /// @endcode
     Color value;
+    /// @brief The solid angle density with which @ref Bsdf::sample would
+    /// produce @c wi , or zero if the Bsdf cannot sample it (e.g., for
+    /// Dirac delta distributions).
+    float pdf = 0;
 
     /// @brief Indicates that the Bsdf is zero for the given pair of directions.
     static BsdfEval invalid() {
         return {
             .value = Color(0),
+            .pdf   = 0,
         };
     }
 
@@ -53,17 +62,25 @@ struct BsdfEval {
 /// @brief A Bsdf, representing the scattering distribution of a surface.
 class Bsdf : public Object {
 public:
+    /**
+     * @brief Looks up the textures of the Bsdf at the texture coordinates of
+     * the closure, and stores the values needed by @ref evaluate and
+     * @ref sample in it. This happens once per intersection.
+     */
+    virtual void prepare(BsdfClosure &closure) const {}
+
     /**
      * @brief Evaluates the Bsdf (including the cosine term) for a given pair
      * of directions in local coordinates (i.e., the normal is assumed to be
      * [0,0,1]).
-     * @param uv The texture coordinates of the surface.
+     * @param closure The texture values at the surface point, see
+     * @ref prepare .
      * @param wo The outgoing direction light is scattered in, pointing away
      * from the surface, in local coordinates.
      * @param wi The incoming direction light comes from, pointing away
      * from the surface, in local coordinates.
      */
-    virtual BsdfEval evaluate(const Point2 &uv, const Vector &wo,
+    virtual BsdfEval evaluate(const BsdfClosure &closure, const Vector &wo,
                               const Vector &wi) const {
         NOT_IMPLEMENTED
     }
@@ -72,13 +89,22 @@ public:
      * local coordinates (i.e., the normal is assumed to be [0,0,1]).
      * @note Can also produce invalid samples in case sampling fails (use @ref
      * BsdfSample::isInvalid() to check for this).
-     * @param uv The texture coordinates of the surface.
+     * @param closure The texture values at the surface point, see
+     * @ref prepare .
      * @param wo The outgoing direction light is scattered in, pointing away
      * from the surface, in local coordinates.
      * @param rng A random number generator used to steer the sampling.
      */
-    virtual BsdfSample sample(const Point2 &uv, const Vector &wo,
+    virtual BsdfSample sample(const BsdfClosure &closure, const Vector &wo,
                               Sampler &rng) const = 0;
+
+    /// @brief Whether the Bsdf is Lambertian, i.e., the radiance it reflects
+    /// does not depend on the viewing direction.
+    virtual bool isDiffuse() const { return false; }
+    /// @brief Whether the Bsdf only consists of Dirac delta lobes (e.g.,
+    /// perfect mirrors), which are sampled with zero density and cannot be
+    /// evaluated for any other direction.
+    virtual bool isDelta() const { return false; }
 };
 
 } // namespace lightwave
@@ -43,6 +43,28 @@ public:
     /// @brief Returns the resolution of the image that is being rendered.
     const Vector2i &resolution() const { return m_resolution; }
 
+    /// @brief Returns the transform from local to world coordinates.
+    const Transform *transform() const { return m_transform.get(); }
+
+    /// @brief Returns the position of the camera in world coordinates.
+    Point position() const { return m_transform->apply(Point(0)); }
+
+    /**
+     * @brief Returns the angle (in radians) covered by a single pixel at the
+     * center of the image, which is used to choose the level of detail of
+     * shapes (see @ref Shape::withDetail ), or zero if the camera does not
+     * support this.
+     */
+    virtual float pixelAngle() const { return 0; }
+
+    /**
+     * @brief For pinhole cameras whose primary visibility should be rasterized
+     * (see @ref VisibilityBuffer ): returns the extent of the image plane at
+     * unit distance (in local coordinates) along each axis. Returns false if
+     * primary rays must be traced.
+     */
+    virtual bool rasterizationExtent(Vector2 &extent) const { return false; }
+
     /**
      * @brief Helper function to sample the camera model for a given pixel.
      * This function samples a random position within the given pixel,
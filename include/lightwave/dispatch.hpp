@@ -0,0 +1,95 @@
+/**
+ * @file dispatch.hpp
+ * @brief Selects between variants of hot kernels that are compiled for
+ * different instruction set extensions, based on the capabilities of the CPU
+ * the renderer runs on.
+ */
+
+#pragma once
+
+#include <lightwave/core.hpp>
+
+#include <string>
+
+#if defined(LW_CPU_X86) && defined(LW_CC_GNU) && !defined(LW_CC_MSC)
+/// @brief Whether kernels are compiled for multiple instruction sets.
+#define LW_DISPATCH_ENABLED
+// "flatten" inlines all callees (e.g., the math library) into the kernel, so
+// that they are compiled for the same instruction set as well
+#define LW_TARGET_AVX2 __attribute__((target("avx2,fma,bmi2"), flatten))
+#define LW_TARGET_AVX512                                                       \
+    __attribute__((target("avx512f,avx512vl,avx512dq,avx512bw,avx2,fma,bmi2"), \
+                   flatten))
+#define LW_TARGET_GENERIC __attribute__((flatten))
+#else
+#define LW_TARGET_AVX2
+#define LW_TARGET_AVX512
+#define LW_TARGET_GENERIC
+#endif
+
+namespace lightwave::dispatch {
+
+/// @brief The instruction set levels that kernels are compiled for, in
+/// increasing order.
+enum class Isa {
+    /// @brief Whatever the build targets (SSE2 for x86-64 by default).
+    Generic,
+    AVX2,
+    AVX512,
+};
+
+namespace detail {
+extern Isa activeIsa;
+} // namespace detail
+
+/// @brief The instruction set level used by kernels.
+inline Isa active() { return detail::activeIsa; }
+
+/// @brief Whether the CPU (and the build) supports the given level.
+bool supported(Isa isa);
+/// @brief The best level supported by the CPU.
+Isa detect();
+/// @brief The name of a level, as used by @ref select .
+const char *name(Isa isa);
+
+/**
+ * @brief Selects the instruction set level used by kernels and logs it.
+ * @param request The name of the level to use (e.g., from the command line),
+ * or an empty string to use the @c LW_ISA environment variable if set, or the
+ * best level the CPU supports otherwise. Levels that the CPU does not support
+ * fall back to the best supported one.
+ */
+void select(const std::string &request = "");
+
+} // namespace lightwave::dispatch
+
+/**
+ * @brief Defines a function that forwards to the variant of
+ * @code name##Impl @endcode for the active instruction set level. The
+ * implementation must be inline (and must not recurse), so that it can be
+ * compiled into each variant.
+ * @example
+ * @code
+ * LW_DISPATCH(bool, intersect, (const Ray &ray, float &t) const, (ray, t))
+ * @endcode
+ */
+#define LW_DISPATCH(Result, name, Parameters, Arguments)                       \
+    LW_TARGET_GENERIC Result name##Generic Parameters {                        \
+        return name##Impl Arguments;                                           \
+    }                                                                          \
+    LW_TARGET_AVX2 Result name##Avx2 Parameters {                              \
+        return name##Impl Arguments;                                           \
+    }                                                                          \
+    LW_TARGET_AVX512 Result name##Avx512 Parameters {                          \
+        return name##Impl Arguments;                                           \
+    }                                                                          \
+    Result name Parameters {                                                   \
+        switch (::lightwave::dispatch::active()) {                             \
+        case ::lightwave::dispatch::Isa::AVX512:                               \
+            return name##Avx512 Arguments;                                     \
+        case ::lightwave::dispatch::Isa::AVX2:                                 \
+            return name##Avx2 Arguments;                                       \
+        default:                                                               \
+            return name##Generic Arguments;                                    \
+        }                                                                      \
+    }
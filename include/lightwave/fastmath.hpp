@@ -0,0 +1,278 @@
+/**
+ * @file fastmath.hpp
+ * @brief Polynomial approximations of transcendental functions with bounded
+ * error, for hot paths where the precision of the standard library is not
+ * needed.
+ */
+
+#pragma once
+
+#include <lightwave/math.hpp>
+
+#include <bit>
+#include <cstdint>
+#include <span>
+
+namespace lightwave {
+
+/**
+ * @brief Approximations of transcendental functions in single precision,
+ * based on the minimax polynomials of the Cephes library and [Abramowitz and
+ * Stegun 1964]. All functions are free of branches (the compiler turns the
+ * conditionals into selects), so that loops over them can be vectorized; the
+ * span overloads are provided for that purpose.
+ *
+ * The maximum errors (over the tested ranges, see
+ * @c unittests/core/fastmath.cpp ) are:
+ * - @c sin , @c cos : 2e-7 absolute for |x| <= 100
+ * - @c atan , @c atan2 : 3e-7 absolute
+ * - @c acos : 5e-7 absolute
+ * - @c exp : 2e-7 relative
+ * - @c log : 3e-7 absolute for x in [0.1, 10], 3e-7 relative otherwise
+ * - @c pow : 4e-7 relative times @code 1 + |y log(x)| @endcode
+ */
+namespace approx {
+
+namespace detail {
+/// @brief Rounds to the nearest integer (ties away from zero), which unlike
+/// @c std::round compiles to a plain conversion instruction (and, unlike a
+/// conditional, does not introduce a branch on the sign).
+inline int roundToInt(float x) { return int(x + copysign(0.5f, x)); }
+
+/// @brief Computes @code 2^n @endcode for @code -126 <= n <= 127 @endcode ,
+/// and infinity for @code n = 128 @endcode .
+inline float exp2i(int n) {
+    return std::bit_cast<float>(uint32_t(n + 127) << 23);
+}
+
+/// @brief The arctangent for non-negative arguments.
+inline float atanPositive(float x) {
+    // reduce the argument to [0, tan(pi/8)]
+    const bool large  = x > 2.414213562373095f;  // tan(3pi/8)
+    const bool medium = x > 0.4142135623730950f; // tan(pi/8)
+    const float offset  = large ? Pi2 : medium ? Pi4 : 0.f;
+    const float reduced = large    ? -1 / x
+                          : medium ? (x - 1) / (x + 1)
+                                   : x;
+    const float z = reduced * reduced;
+    return offset + reduced + reduced * z *
+                                  (((8.05374449538e-2f * z - 1.38776856032e-1f) *
+                                        z +
+                                    1.99777106478e-1f) *
+                                       z -
+                                   3.33329491539e-1f);
+}
+} // namespace detail
+
+/// @brief Computes the sine and cosine of an angle at once.
+inline void sincos(float x, float &sin, float &cos) {
+    // reduce the argument to [-pi/4, pi/4], in double precision since the
+    // usual split into multiple constants is undone by -ffast-math
+    const int quadrant = detail::roundToInt(x * (2 * InvPi));
+    const float r      = float(double(x) - quadrant * 1.57079632679489662);
+
+    const float r2 = r * r;
+
+    const float s =
+        r + r * r2 *
+                ((-1.9515295891e-4f * r2 + 8.3321608736e-3f) * r2 -
+                 1.6666654611e-1f);
+    const float c =
+        1 - 0.5f * r2 +
+        r2 * r2 *
+            ((2.443315711809948e-5f * r2 - 1.388731625493765e-3f) * r2 +
+             4.166664568298827e-2f);
+
+    // the quadrant determines whether the results are swapped and negated
+    // (the signs are computed arithmetically, which vectorizes better)
+    const bool swap = quadrant & 1;
+    sin             = (swap ? c : s) * float(1 - (quadrant & 2));
+    cos             = (swap ? s : c) * float(1 - ((quadrant + 1) & 2));
+}
+
+inline float sin(float x) {
+    float s, c;
+    sincos(x, s, c);
+    return s;
+}
+
+inline float cos(float x) {
+    float s, c;
+    sincos(x, s, c);
+    return c;
+}
+
+inline float atan(float x) {
+    return copysign(detail::atanPositive(abs(x)), x);
+}
+
+/// @brief The angle of the point @c (x,y) to the x-axis in the range
+/// @code [-pi, pi] @endcode , with @code atan2(0, 0) = 0 @endcode .
+inline float atan2(float y, float x) {
+    const float ax = abs(x);
+    const float ay = abs(y);
+    // the ratio lies in [0, 1], so atanPositive only needs one reduction
+    const float ratio =
+        min(ax, ay) / max(max(ax, ay), std::numeric_limits<float>::min());
+    float angle = detail::atanPositive(ratio);
+    angle       = ay > ax ? Pi2 - angle : angle;
+    angle       = x < 0 ? Pi - angle : angle;
+    return copysign(angle, y);
+}
+
+/// @brief The arccosine, with arguments clamped to @code [-1, 1] @endcode
+/// (i.e., this is a replacement for @ref safe_acos ).
+/// @see Abramowitz and Stegun, equation 4.4.46
+inline float acos(float x) {
+    const float ax = min(abs(x), 1.f);
+    const float result =
+        sqrt(1 - ax) *
+        (((((((-0.0012624911f * ax + 0.0066700901f) * ax - 0.0170881256f) *
+                 ax +
+             0.0308918810f) *
+                ax -
+            0.0501743046f) *
+               ax +
+           0.0889789874f) *
+              ax -
+          0.2145988016f) *
+             ax +
+         1.5707963050f);
+    return x < 0 ? Pi - result : result;
+}
+
+inline float exp(float x) {
+    // below, the result is denormal (and flushed to zero); above, the power
+    // of two computed below overflows to infinity (slightly before the exact
+    // result would, which saves a select)
+    constexpr float MinArgument = -87.33654f;
+    constexpr float MaxArgument = 88.8f;
+    const float clamped         = clamp(x, MinArgument, MaxArgument);
+
+    // exp(x) = 2^n exp(r) with |r| <= ln(2)/2
+    const int n   = detail::roundToInt(clamped * 1.44269504088896341f);
+    const float r = float(double(clamped) - n * 0.693147180559945309);
+    const float p =
+        1 + r +
+        r * r *
+            (((((1.9875691500e-4f * r + 1.3981999507e-3f) * r +
+                8.3334519073e-3f) *
+                   r +
+               4.1665795894e-2f) *
+                  r +
+              1.6666665459e-1f) *
+                 r +
+             5.0000001201e-1f);
+    const float result = p * detail::exp2i(n);
+    return x < MinArgument ? 0.f : result;
+}
+
+/// @brief The natural logarithm, which is @c -Infinity for zero and NaN for
+/// negative arguments.
+inline float log(float x) {
+    // bring denormals into the normal range
+    const bool denormal = x < std::numeric_limits<float>::min();
+    const float scaled  = denormal ? x * 0x1p23f : x;
+
+    // split into x = 2^e m with m in [sqrt(1/2), sqrt(2))
+    const uint32_t bits = std::bit_cast<uint32_t>(scaled);
+    int e = int((bits >> 23) & 0xff) - 126 - (denormal ? 23 : 0);
+    float m = std::bit_cast<float>((bits & 0x007fffffu) | 0x3f000000u);
+    const bool small = m < 0.707106781186547524f;
+    e -= small;
+    m = (small ? m + m : m) - 1;
+
+    const float z = m * m;
+    float y =
+        m * z *
+        ((((((((7.0376836292e-2f * m - 1.1514610310e-1f) * m +
+               1.1676998740e-1f) *
+                  m -
+              1.2420140846e-1f) *
+                 m +
+             1.4249322787e-1f) *
+                m -
+            1.6668057665e-1f) *
+               m +
+           2.0000714765e-1f) *
+              m -
+          2.4999993993e-1f) *
+             m +
+         3.3333331174e-1f);
+    y = (y - 2.12194440e-4f * float(e)) - 0.5f * z;
+    const float result = (m + y) + 0.693359375f * float(e);
+
+    return x == 0          ? -Infinity
+           : x < 0         ? std::numeric_limits<float>::quiet_NaN()
+           : x == Infinity ? Infinity
+                           : result;
+}
+
+/// @brief Computes @code x^y @endcode for non-negative bases.
+inline float pow(float x, float y) {
+    const float result = exp(y * log(x));
+    return x == 0 ? (y > 0 ? 0.f : y == 0 ? 1.f : Infinity) : result;
+}
+
+// MARK: - batch versions (vectorized by the compiler)
+
+inline void sin(std::span<const float> x, std::span<float> result) {
+    assert(x.size() == result.size());
+    for (size_t i = 0; i < x.size(); i++)
+        result[i] = sin(x[i]);
+}
+
+inline void cos(std::span<const float> x, std::span<float> result) {
+    assert(x.size() == result.size());
+    for (size_t i = 0; i < x.size(); i++)
+        result[i] = cos(x[i]);
+}
+
+inline void exp(std::span<const float> x, std::span<float> result) {
+    assert(x.size() == result.size());
+    for (size_t i = 0; i < x.size(); i++)
+        result[i] = exp(x[i]);
+}
+
+inline void log(std::span<const float> x, std::span<float> result) {
+    assert(x.size() == result.size());
+    for (size_t i = 0; i < x.size(); i++)
+        result[i] = log(x[i]);
+}
+
+} // namespace approx
+
+/**
+ * @brief The transcendental functions used in hot paths. These are the
+ * approximations of @ref approx unless lightwave is built with
+ * @c LW_EXACT_TRANSCENDENTALS , in which case the standard library is used
+ * (e.g., to check whether an artifact is caused by the approximations).
+ */
+namespace fast {
+#ifdef LW_EXACT_TRANSCENDENTALS
+inline void sincos(float x, float &sin, float &cos) {
+    sin = std::sin(x);
+    cos = std::cos(x);
+}
+inline float sin(float x) { return std::sin(x); }
+inline float cos(float x) { return std::cos(x); }
+inline float atan(float x) { return std::atan(x); }
+inline float atan2(float y, float x) { return std::atan2(y, x); }
+inline float acos(float x) { return safe_acos(x); }
+inline float exp(float x) { return std::exp(x); }
+inline float log(float x) { return std::log(x); }
+inline float pow(float x, float y) { return std::pow(x, y); }
+#else
+using approx::acos;
+using approx::atan;
+using approx::atan2;
+using approx::cos;
+using approx::exp;
+using approx::log;
+using approx::pow;
+using approx::sin;
+using approx::sincos;
+#endif
+} // namespace fast
+
+} // namespace lightwave
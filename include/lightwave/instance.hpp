@@ -25,6 +25,50 @@ namespace lightwave {
  * populating the instance field).
  */
 class Instance : public Shape {
+public:
+    /// @brief The kinds of transforms that intersection is specialized for.
+    enum class TransformKind {
+        /// @brief No transform (or one that does not change anything).
+        Identity,
+        /// @brief Rotations, reflections and translations, which preserve
+        /// lengths.
+        Rigid,
+        /// @brief Rigid transforms combined with a uniform scaling, which
+        /// scale all lengths by the same factor.
+        UniformScale,
+        /// @brief Any other affine transform.
+        General,
+    };
+
+    /**
+     * @brief The data needed to intersect the shape of an instance, laid out
+     * without pointers so that acceleration structures can store it
+     * contiguously (see @ref Group ). The shape and the instance are referred
+     * to by 32-bit indices into tables kept by the acceleration structure.
+     */
+    struct Compiled {
+        /// @brief The transform from world to object coordinates.
+        AffineMatrix toObject;
+        /// @brief The factor by which the transform scales lengths.
+        float scale;
+        /// @brief The index of the shape.
+        uint32_t shape;
+        /// @brief The index of the instance.
+        uint32_t instance;
+        TransformKind kind;
+
+        /// @brief Transforms a ray to object coordinates.
+        /// @param scale Receives the distance in object coordinates per unit
+        /// distance in world coordinates.
+        Ray toObjectRay(const Ray &worldRay, float &scale) const;
+    };
+
+private:
+    using IntersectFunction = bool (Instance::*)(const Ray &, Intersection &,
+                                                 Sampler &) const;
+    using CompleteFunction  = bool (Instance::*)(Intersection &, float, float,
+                                                Sampler &) const;
+
     /// @brief When an instance is wrapped within an area light object, this
     /// will reference it.
     Light *m_light;
@@ -48,10 +92,80 @@ class Instance : public Shape {
     /// @brief Loads an additional texture that describes the alpha masking of
     /// the underlying geometry
     ref<Texture> m_alpha;
+    /// @brief The shape with the alpha mask applied by the shape itself, if it
+    /// supports this (see @ref Shape::withAlphaMask ).
+    ref<Shape> m_maskedShape;
+    /// @brief The shape that is intersected (either @c m_shape or
+    /// @c m_maskedShape ).
+    const Shape *m_intersected;
+
+    /// @brief The kind of @c m_transform , determined at load time.
+    TransformKind m_kind;
+    /// @brief The transform from object to world coordinates.
+    AffineMatrix m_toWorld;
+    /// @brief The transform from world to object coordinates.
+    AffineMatrix m_toObject;
+    /// @brief The factor by which the transform scales lengths (only used for
+    /// uniform scaling).
+    float m_scale;
+    /// @brief The variant of @ref intersectVariant chosen at load time.
+    IntersectFunction m_intersect;
+    /// @brief The variant of @ref completeVariant chosen at load time.
+    CompleteFunction m_complete;
+    /// @brief Whether the shape was merged with others (see @ref mergeInto ).
+    bool m_merged = false;
+
+    /// @brief Classifies the transform and chooses the intersection variant.
+    void specialize();
+
+    /// @brief Intersects the shape, specialized for the kind of transform and
+    /// whether alpha masking and normal mapping are used.
+    template <TransformKind Kind, bool AlphaMask, bool NormalMap>
+    bool intersectVariant(const Ray &worldRay, Intersection &its,
+                          Sampler &rng) const;
+
+    /// @brief Intersects a shape that this instance was merged into, which
+    /// completes hits with the instances of its parts itself.
+    bool intersectMerged(const Ray &ray, Intersection &its, Sampler &rng) const {
+        return m_shape->intersect(ray, its, rng);
+    }
+
+    /// @brief Completes an intersection with the shape in object coordinates,
+    /// specialized like @ref intersectVariant (see @ref completeIntersection ).
+    template <TransformKind Kind, bool AlphaMask, bool NormalMap>
+    bool completeVariant(Intersection &its, float previousT, float scale,
+                         Sampler &rng) const;
+
+    /// @brief Transforms a ray to object coordinates, specialized for the kind
+    /// of transform.
+    template <TransformKind Kind>
+    static Ray toObjectRay(const AffineMatrix &toObject, float transformScale,
+                           const Ray &worldRay, float &scale) {
+        if constexpr (Kind == TransformKind::Identity) {
+            scale = 1;
+            return worldRay;
+        }
+
+        Ray localRay       = worldRay;
+        localRay.origin    = toObject.apply(worldRay.origin);
+        localRay.direction = toObject.apply(worldRay.direction);
+        if constexpr (Kind == TransformKind::UniformScale) {
+            scale = 1 / transformScale;
+            localRay.direction *= transformScale;
+        } else if constexpr (Kind == TransformKind::General) {
+            scale = localRay.direction.length();
+            localRay.direction /= scale;
+        } else {
+            // rigid transforms preserve distances
+            scale = 1;
+        }
+        return localRay;
+    }
 
     /// @brief Transforms the frame from object coordinates to world
     /// coordinates.
-    inline void transformFrame(SurfaceEvent &surf, const Vector &wo) const;
+    template <TransformKind Kind>
+    void transformFrame(SurfaceEvent &surf) const;
 
 public:
     Instance(const Properties &properties) : m_light(nullptr) {
@@ -62,10 +176,41 @@ public:
         m_normal    = properties.getOptional<Texture>("normal");
         m_alpha     = properties.getOptional<Texture>("alpha");
         m_visible   = false;
+        if (m_alpha)
+            m_maskedShape = m_shape->withAlphaMask(m_alpha);
+        m_intersected = m_maskedShape ? m_maskedShape.get() : m_shape.get();
+        specialize();
     }
 
+    /**
+     * @brief Replaces the shape with the coarsest version whose error appears
+     * smaller than the given budget when seen from @c eye (see @ref
+     * Shape::withDetail ). This happens once at load time, so that all rays
+     * (including shadow rays) see the same geometry.
+     * @param errorPerDistance The largest error that is tolerated per unit
+     * distance from the eye, e.g., the angle covered by a pixel.
+     * @return The shape that was replaced if a coarser version was selected,
+     * or null otherwise.
+     */
+    ref<Shape> selectDetail(const Point &eye, float errorPerDistance);
+
+    /**
+     * @brief Replaces the shape by one that it was merged into together with
+     * the shapes of other untransformed instances (see @ref Group ), which
+     * releases the original shape. The merged shape reports this instance for
+     * hits on the part that stems from it, hence intersecting the instance
+     * from now on intersects all parts of the merged shape.
+     */
+    void mergeInto(const ref<Shape> &merged);
+    /// @brief Returns whether the shape was merged with others (see @ref
+    /// mergeInto ).
+    bool isMerged() const { return m_merged; }
+
     /// @brief Returns the shape.
     Shape *shape() const { return m_shape.get(); }
+    /// @brief Returns the shape that is intersected, which differs from @ref
+    /// shape if the shape applies the alpha mask itself.
+    const Shape *intersectedShape() const { return m_intersected; }
     /// @brief Returns the material that the shape should be rendered with (can
     /// be null for non-reflecting objects).
     Bsdf *bsdf() const { return m_bsdf.get(); }
@@ -106,7 +251,37 @@ public:
      * @return @c true if an intersection was found.
      */
     bool intersect(const Ray &ray, Intersection &its,
-                   Sampler &rng) const override;
+                   Sampler &rng) const override {
+        return (this->*m_intersect)(ray, its, rng);
+    }
+    /**
+     * @brief Completes an intersection with the shape in object coordinates
+     * that was found without calling @ref intersect , e.g., by acceleration
+     * structures that store instances as @ref Compiled records. Applies alpha
+     * masking, transforms the intersection to world coordinates, populates the
+     * instance field and applies normal mapping.
+     * @param previousT The distance in world coordinates before the shape was
+     * intersected, which is restored if alpha masking discards the hit.
+     * @param scale The distance in object coordinates per unit distance in
+     * world coordinates (see @ref Compiled::toObjectRay ).
+     * @return @c false if alpha masking discarded the hit.
+     */
+    bool completeIntersection(Intersection &its, float previousT, float scale,
+                              Sampler &rng) const {
+        return (this->*m_complete)(its, previousT, scale, rng);
+    }
+    /// @brief Describes the data needed to intersect the shape (the indices
+    /// are left for the caller to fill in).
+    Compiled compile() const {
+        return { .toObject = m_toObject,
+                 .scale    = m_scale,
+                 .shape    = 0,
+                 .instance = 0,
+                 .kind     = m_kind };
+    }
+    /// @brief Describes the transformed shape for inline intersection, unless
+    /// alpha masking is used.
+    InlinePrimitive inlinePrimitive() const override;
     /// @brief Returns the bounding box of the instance in world coordinates.
     Bounds getBoundingBox() const override;
     /// @brief Returns the centroid of the instance in world coordinates.
@@ -118,16 +293,26 @@ public:
      */
     AreaSample sampleArea(Sampler &rng) const override;
 
+    /// @brief The kind of transform, determined at load time.
+    TransformKind transformKind() const { return m_kind; }
+    /// @brief The transform from object to world coordinates.
+    const AffineMatrix &toWorld() const { return m_toWorld; }
+    /// @brief Describes the intersection variant chosen at load time.
+    std::string variant() const;
+
     /// @brief Returns a textual representation of this image.
     std::string toString() const override {
         return tfm::format(
             "Instance[\n"
+            "  variant = %s,\n"
             "  shape = %s,\n"
             "  bsdf = %s,\n"
             "  emission = %s,\n"
             "  transform = %s,\n"
             "  normal = %s,\n"
+            "  alpha = %s,\n"
             "]",
+            variant(),
             indent(m_shape),
             indent(m_bsdf),
             indent(m_emission),
@@ -137,4 +322,22 @@ public:
     }
 };
 
+inline Ray Instance::Compiled::toObjectRay(const Ray &worldRay,
+                                          float &scale) const {
+    switch (kind) {
+    case TransformKind::Identity:
+        return Instance::toObjectRay<TransformKind::Identity>(
+            toObject, this->scale, worldRay, scale);
+    case TransformKind::Rigid:
+        return Instance::toObjectRay<TransformKind::Rigid>(
+            toObject, this->scale, worldRay, scale);
+    case TransformKind::UniformScale:
+        return Instance::toObjectRay<TransformKind::UniformScale>(
+            toObject, this->scale, worldRay, scale);
+    default:
+        return Instance::toObjectRay<TransformKind::General>(
+            toObject, this->scale, worldRay, scale);
+    }
+}
+
 } // namespace lightwave
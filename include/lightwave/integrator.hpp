@@ -71,6 +71,20 @@ public:
      * @ref execute function of the integrator.
      */
     virtual Color Li(const Ray &ray, Sampler &rng) = 0;
+    /**
+     * @brief Returns (an estimate of) the incident radiance for a given ray,
+     * whose closest intersection has already been found (e.g., for camera rays
+     * that were rasterized). By default, the intersection is discarded and
+     * @ref Li is invoked.
+     */
+    virtual Color LiAt(const Ray &ray, const Intersection &its, Sampler &rng) {
+        return Li(ray, rng);
+    }
+
+protected:
+    /// @brief Invoked by the rendering thread after it has completed a block
+    /// of pixels, e.g., to merge statistics that it gathered locally.
+    virtual void finishBlock() {}
 };
 
 } // namespace lightwave
@@ -9,6 +9,7 @@
 #include <lightwave/core.hpp>
 #include <lightwave/emission.hpp>
 #include <lightwave/math.hpp>
+#include <lightwave/warp.hpp>
 
 namespace lightwave {
 
@@ -41,6 +42,29 @@ struct DirectLightSample {
     explicit operator bool() const { return !isInvalid(); }
 };
 
+/// @brief The result of sampling a ray leaving a light source using @ref
+/// Light::sampleEmission .
+struct EmissionSample {
+    /// @brief The ray leaving the light source.
+    Ray ray;
+    /// @brief The weight of the sample, given by @code Le * cos(theta) /
+    /// p(x, w) @endcode , i.e., the flux carried by the ray.
+    Color weight;
+
+    /// @brief Return an invalid sample, used to denote that sampling has
+    /// failed (or that the light cannot emit rays).
+    static EmissionSample invalid() {
+        return {
+            .ray    = Ray(),
+            .weight = Color(),
+        };
+    }
+
+    /// @brief Tests whether the sample is invalid (i.e., sampling has failed).
+    bool isInvalid() const { return weight == Color(0); }
+    explicit operator bool() const { return !isInvalid(); }
+};
+
 /**
  * @brief A light source that can be sampled for direct connections.
  * Some light sources can also be intersected by rays (e.g., area lights or the
@@ -57,6 +81,25 @@ protected:
      */
     float m_samplingWeight;
 
+    /**
+     * @brief Samples a ray that travels along @c direction and passes through
+     * the bounding sphere of the scene, as needed for lights that are
+     * infinitely far away.
+     * @param area Receives the area of the disk the ray origins are drawn
+     * from, i.e., the inverse of their density.
+     */
+    static Ray sampleParallelRay(const Bounds &sceneBounds,
+                                 const Vector &direction, const Point2 &rnd,
+                                 float &area) {
+        const float radius  = max(sceneBounds.diagonal().length() / 2, Epsilon);
+        const Point2 disk   = squareToUniformDiskConcentric(rnd);
+        const Frame frame   = Frame(direction);
+        const Point origin  = sceneBounds.center() - radius * direction +
+                             radius * frame.toWorld(Vector(disk.x(), disk.y(), 0));
+        area                = Pi * sqr(radius);
+        return Ray(origin, direction);
+    }
+
 public:
     Light(const Properties &properties) {
         m_samplingWeight = properties.get<float>("weight", 1.f);
@@ -80,6 +123,17 @@ public:
     virtual DirectLightSample sampleDirect(const Point &origin,
                                            Sampler &rng) const = 0;
 
+    /**
+     * @brief Samples a ray leaving the light source, e.g., to trace photons.
+     * @param sceneBounds The bounding box of the scene, which lights that are
+     * infinitely far away need to aim their rays at the scene.
+     * @param rng A random number generator used to steer the sampling.
+     */
+    virtual EmissionSample sampleEmission(const Bounds &sceneBounds,
+                                          Sampler &rng) const {
+        return EmissionSample::invalid();
+    }
+
     /// @brief Returns whether this light source can be hit by rays (i.e., has
     /// an area that has been placed within the scene).
     virtual bool canBeIntersected() const { return false; }
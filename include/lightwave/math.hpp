@@ -12,7 +12,10 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <optional>
+#include <type_traits>
 
 namespace lightwave {
 
@@ -707,6 +710,9 @@ using Vector4 = TVector<float, 4>;
 
 /// @brief An integer rectangle (e.g., to describe the blocks of an image).
 using Bounds2i = TBounds<int, 2>;
+/// @brief A rectangle with floating point components (e.g., to describe a
+/// region of texture space).
+using Bounds2 = TBounds<float, 2>;
 /// @brief A three-dimensional axis-aligned bounding box with floating point
 /// components.
 using Bounds = TBounds<float, 3>;
@@ -945,6 +951,38 @@ struct SurfaceEvent {
     }
 };
 
+/**
+ * @brief The texture values of a Bsdf at a surface point. Texture lookups
+ * (in particular bilinear fetches from large images) are costly, hence they
+ * are performed once per intersection by @ref Bsdf::prepare and reused by all
+ * subsequent evaluations and samples of the Bsdf at that point. Each Bsdf
+ * decides which values it stores, in a trivially copyable struct of its own.
+ */
+struct BsdfClosure {
+    /// @brief The maximum size of the values a Bsdf can store.
+    static constexpr size_t Capacity = 32;
+
+    /// @brief The texture coordinates of the surface point.
+    Point2 uv;
+    /// @brief Whether @ref Bsdf::prepare has been called for this point.
+    bool prepared = false;
+
+    template <typename T> void store(const T &values) {
+        static_assert(sizeof(T) <= Capacity && std::is_trivially_copyable_v<T>);
+        std::memcpy(m_data, &values, sizeof(T));
+    }
+
+    template <typename T> T load() const {
+        static_assert(sizeof(T) <= Capacity && std::is_trivially_copyable_v<T>);
+        T values;
+        std::memcpy(&values, m_data, sizeof(T));
+        return values;
+    }
+
+private:
+    alignas(float) std::byte m_data[Capacity];
+};
+
 /// @brief Describes an intersection of a ray with a surface.
 struct Intersection : public SurfaceEvent {
     /// @brief The direction of the ray that hit the surface, pointing away from
@@ -974,6 +1012,11 @@ struct Intersection : public SurfaceEvent {
         int primCounter = 0;
     } stats;
 
+    /// @brief The texture values of the Bsdf at the hit point, which are
+    /// looked up on the first evaluation or sample of the Bsdf (see
+    /// @ref bsdfClosure ), and reset by every new hit.
+    mutable BsdfClosure closure;
+
     Intersection(const Vector &wo = Vector(), float t = Infinity)
         : wo(wo), t(t) {}
 
@@ -988,6 +1031,9 @@ struct Intersection : public SurfaceEvent {
     /// @brief Samples the Bsdf of the underlying surface.
     BsdfSample sampleBsdf(Sampler &rng) const;
     BsdfEval evaluateBsdf(const Vector &wi) const;
+    /// @brief Prepares the closure of the Bsdf of the underlying surface, if
+    /// that has not happened yet.
+    const BsdfClosure &bsdfClosure() const;
 
     Light *light() const;
 };
@@ -19,12 +19,19 @@
 
 namespace lightwave {
 
-/// @brief Invokes @c f for each element of the iterator, parallelized across
-/// all available cores.
-template <class ForwardIt, class UnaryFunction>
-void for_each_parallel(ForwardIt first, ForwardIt last, UnaryFunction f) {
+/**
+ * @brief Invokes @c f for each element of the iterator, parallelized across
+ * all available cores. Each thread calls @c init once to create state that it
+ * passes to all invocations of @c f it performs, which allows reusing
+ * expensive objects (e.g., samplers) across work items.
+ */
+template <class ForwardIt, class ThreadInit, class BinaryFunction>
+void for_each_parallel(ForwardIt first, ForwardIt last, ThreadInit init,
+                       BinaryFunction f) {
 #ifdef SINGLE_THREADED
-    std::for_each(first, last, f);
+    auto state = init();
+    for (; first != last; ++first)
+        f(*first, state);
     return;
 #endif
 
@@ -37,6 +44,7 @@ void for_each_parallel(ForwardIt first, ForwardIt last, UnaryFunction f) {
     // build a thread pool
     for (int i = 0; i < numThreads; i++) {
         m_threads.emplace_back([&]() {
+            auto state = init();
             while (true) {
                 m_lock.lock();
                 if (!(first != last)) {
@@ -51,7 +59,7 @@ void for_each_parallel(ForwardIt first, ForwardIt last, UnaryFunction f) {
                 m_lock.unlock();
 
                 // execute the work item
-                f(obj);
+                f(obj, state);
             }
         });
     }
@@ -61,6 +69,14 @@ void for_each_parallel(ForwardIt first, ForwardIt last, UnaryFunction f) {
         thread.join();
 }
 
+/// @brief Invokes @c f for each element of the iterator, parallelized across
+/// all available cores.
+template <class ForwardIt, class UnaryFunction>
+void for_each_parallel(ForwardIt first, ForwardIt last, UnaryFunction f) {
+    for_each_parallel(
+        first, last, [] { return 0; }, [&](auto &obj, int) { f(obj); });
+}
+
 /// @brief Invokes @c f for each element of the iterator, parallelized across
 /// all available cores.
 template <class Iterator, class UnaryFunction>
@@ -68,6 +84,15 @@ void for_each_parallel(Iterator it, UnaryFunction f) {
     for_each_parallel(it.begin(), it.end(), f);
 }
 
+/// @brief Invokes @c f for each element of the iterator, parallelized across
+/// all available cores, with state that each thread creates once using
+/// @c init .
+template <class Iterator, class ThreadInit, class BinaryFunction>
+void for_each_parallel_with_state(Iterator it, ThreadInit init,
+                                  BinaryFunction f) {
+    for_each_parallel(it.begin(), it.end(), init, f);
+}
+
 /// @brief Atomically increment a floating point number.
 inline float atomicAdd(float &dst, float delta) {
 #if defined(__clang__)
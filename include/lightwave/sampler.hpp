@@ -10,6 +10,8 @@
 #include <lightwave/math.hpp>
 #include <lightwave/properties.hpp>
 
+#include <span>
+
 namespace lightwave {
 
 /**
@@ -34,6 +36,12 @@ public:
     virtual float next() = 0;
     /// @brief Generates a random point in the unit square [0,1)^2.
     virtual Point2 next2D() { return { next(), next() }; }
+    /// @brief Fills the given range with the next random numbers, which is
+    /// equivalent to (but can be faster than) calling @ref next repeatedly.
+    virtual void fill(std::span<float> values) {
+        for (float &value : values)
+            value = next();
+    }
 
     /**
      * @brief Initiates a random number sequence characterized by the given
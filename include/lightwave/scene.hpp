@@ -39,6 +39,9 @@ class Scene : public Object {
     /// @brief The geometry of the scene that should be rendered (typically an
     /// acceleration structure with instances in it).
     ref<Shape> m_shape;
+    /// @brief The shapes that were placed in the scene (e.g., instances),
+    /// which @c m_shape is built from.
+    std::vector<ref<Shape>> m_entities;
     /// @brief An optional background light, which provides color when rays exit
     /// the scene.
     ref<BackgroundLight> m_background;
@@ -54,9 +57,15 @@ public:
 
     /// @brief The camera from which the image is to be rendered.
     Camera *camera() const { return m_camera.get(); }
+    /// @brief The shapes that were placed in the scene.
+    const std::vector<ref<Shape>> &entities() const { return m_entities; }
 
     /// @brief Finds the closest intersection of the scene for a given ray.
     Intersection intersect(const Ray &ray, Sampler &rng) const;
+    /// @brief Fills in the background and the probability of sampling the
+    /// light that was hit, for intersections that were found without @ref
+    /// intersect (e.g., by rasterization).
+    void completeIntersection(Intersection &its) const;
     /// @brief Reports whether any intersection up to a given maximal distance
     /// exists (used for testing visibility of light sources).
     bool intersect(const Ray &ray, float tMax, Sampler &rng) const;
@@ -30,6 +30,93 @@ struct AreaSample : public SurfaceEvent {
     }
 };
 
+/**
+ * @brief Describes a simple shape in world coordinates, which allows
+ * acceleration structures to test it for intersection inline (i.e., without
+ * calling virtual functions or following pointers). Only the distance to the
+ * hit is computed this way; the rest of the intersection (texture coordinates,
+ * shading frame, ...) is left to the shape once the closest hit is known.
+ */
+struct InlinePrimitive {
+    enum class Type {
+        /// @brief The shape cannot be intersected inline.
+        None,
+        Sphere,
+        /// @brief A parallelogram spanned by two edges (e.g., a rectangle).
+        Parallelogram,
+    };
+
+    Type type = Type::None;
+    /// @brief The center of spheres, or a corner of parallelograms.
+    Point origin;
+    /// @brief The squared radius of spheres.
+    float radius2 = 0;
+    /// @brief The edges of parallelograms, starting at the origin.
+    Vector edge1, edge2;
+    /// @brief The normal of parallelograms, divided by its squared length.
+    Vector scaledNormal;
+    /// @brief The shape's own Epsilon (which applies in object space),
+    /// converted to world space.
+    float epsilon = Epsilon;
+
+    static InlinePrimitive sphere(const Point &center, float radius,
+                                  float epsilon = Epsilon) {
+        InlinePrimitive primitive;
+        primitive.type    = Type::Sphere;
+        primitive.origin  = center;
+        primitive.radius2 = radius * radius;
+        primitive.epsilon = epsilon;
+        return primitive;
+    }
+
+    static InlinePrimitive parallelogram(const Point &corner,
+                                         const Vector &edge1,
+                                         const Vector &edge2,
+                                         float epsilon = Epsilon) {
+        const Vector normal = edge1.cross(edge2);
+        InlinePrimitive primitive;
+        primitive.type         = Type::Parallelogram;
+        primitive.origin       = corner;
+        primitive.edge1        = edge1;
+        primitive.edge2        = edge2;
+        primitive.scaledNormal = normal / normal.dot(normal);
+        primitive.epsilon      = epsilon;
+        return primitive;
+    }
+
+    /// @brief Returns the distance at which the ray hits the shape, or
+    /// Infinity if it misses or the hit is not closer than @c tMax .
+    float intersect(const Ray &ray, float tMax) const {
+        if (type == Type::Sphere) {
+            // like Sphere::intersect, offset the origin against
+            // self-intersections
+            const Vector oc =
+                ray.origin + ray.direction * epsilon - origin;
+            const float b            = oc.dot(ray.direction);
+            const float discriminant = b * b - (oc.dot(oc) - radius2);
+            if (discriminant < 0)
+                return Infinity;
+            const float root = std::sqrt(discriminant);
+            const float t    = -b - root > epsilon ? -b - root : -b + root;
+            return t > epsilon && t < tMax ? t : Infinity;
+        }
+
+        const float cosine = scaledNormal.dot(ray.direction);
+        if (cosine == 0)
+            return Infinity;
+        const float t = scaledNormal.dot(origin - ray.origin) / cosine;
+        if (!(t >= epsilon && t < tMax))
+            return Infinity;
+        // coordinates of the hit with respect to the edges
+        const Vector p = ray(t) - origin;
+        const float u  = p.cross(edge2).dot(scaledNormal);
+        const float v  = edge1.cross(p).dot(scaledNormal);
+        if (u < 0 || u > 1 || v < 0 || v > 1)
+            return Infinity;
+        return t;
+    }
+};
+
 /// @brief A shape represents a geometrical object that can be intersected by
 /// rays.
 class Shape : public Object {
@@ -64,6 +151,36 @@ public:
      * tracing, if it is not also added to the scene using a reference.
      */
     virtual void markAsVisible() {}
+
+    /// @brief Describes the shape for inline intersection by acceleration
+    /// structures, if it is simple enough.
+    virtual InlinePrimitive inlinePrimitive() const { return {}; }
+
+    /**
+     * @brief Returns a shape that intersects like this one, but discards hits
+     * that are transparent according to the given alpha mask, or null if the
+     * shape does not support this (in which case @ref Instance tests the alpha
+     * of hits itself). This allows shapes to precompute which of their regions
+     * are fully opaque or transparent.
+     * @note The returned shape may refer to this shape, which must outlive it.
+     */
+    virtual ref<Shape> withAlphaMask(const ref<Texture> &alpha) const {
+        return nullptr;
+    }
+
+    /**
+     * @brief Returns a coarser version of this shape that deviates from it by
+     * at most the given distance (in object coordinates), or null if the shape
+     * has no such version (see @ref Instance::selectDetail ).
+     * @note The returned shape is kept alive by this shape.
+     */
+    virtual ref<Shape> withDetail(float error) const { return nullptr; }
+    /**
+     * @brief Releases the coarser versions of this shape that have not been
+     * returned by @ref withDetail , once all instances have selected their
+     * level of detail.
+     */
+    virtual void releaseUnusedDetail() {}
 };
 
 } // namespace lightwave
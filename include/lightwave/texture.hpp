@@ -10,6 +10,8 @@
 #include <lightwave/core.hpp>
 #include <lightwave/math.hpp>
 
+#include <optional>
+
 namespace lightwave {
 
 /// @brief Models spatially varying material properties (e.g., images or
@@ -33,6 +35,23 @@ public:
         // interface for scalar values)
         return evaluate(uv).r();
     }
+    /**
+     * @brief Returns the value of the texture if it is the same for all
+     * texture coordinates, which allows materials to bake it in at load time.
+     */
+    virtual std::optional<Color> constant() const { return std::nullopt; }
+    /**
+     * @brief Returns bounds on the values of the red channel (as used for
+     * alpha masks) within a region of texture space, or nothing if they
+     * cannot be determined cheaply. The bounds must be conservative, i.e.,
+     * every value that @ref evaluate returns within the region lies in them.
+     */
+    virtual std::optional<std::pair<float, float>> range(
+        const Bounds2 &region) const {
+        if (const auto value = constant())
+            return std::make_pair(value->r(), value->r());
+        return std::nullopt;
+    }
 };
 
 } // namespace lightwave
@@ -11,6 +11,34 @@
 
 namespace lightwave {
 
+/**
+ * @brief The upper 3x4 part of a homogeneous matrix of an affine
+ * transformation (the last row of which is always [0,0,0,1]). Compared to a
+ * full @ref Matrix4x4 , this needs fewer operations to transform points and
+ * vectors, and does not need to divide by the homogeneous coordinate.
+ */
+struct AffineMatrix {
+    /// @brief The linear part of the transformation.
+    Matrix3x3 linear;
+    /// @brief The translation applied after the linear part.
+    Vector translation;
+
+    Point apply(const Point &point) const {
+        return Point(linear * Vector(point)) + translation;
+    }
+    Vector apply(const Vector &vector) const { return linear * vector; }
+    /// @brief Multiplies with the transpose of the linear part (i.e., this
+    /// transforms normals if the matrix is the inverse transformation).
+    Vector applyTranspose(const Vector &vector) const {
+        return Vector(linear(0, 0) * vector.x() + linear(1, 0) * vector.y() +
+                          linear(2, 0) * vector.z(),
+                      linear(0, 1) * vector.x() + linear(1, 1) * vector.y() +
+                          linear(2, 1) * vector.z(),
+                      linear(0, 2) * vector.x() + linear(1, 2) * vector.y() +
+                          linear(2, 2) * vector.z());
+    }
+};
+
 /**
  * @brief Transfers points or vectors from one coordinate system to another.
  * @note This is an interface to allow time-dependent transforms (e.g., motion
@@ -21,6 +49,13 @@ protected:
     Matrix4x4 m_transform = Matrix4x4::identity();
     Matrix4x4 m_inverse   = Matrix4x4::identity();
 
+    static AffineMatrix toAffine(const Matrix4x4 &matrix) {
+        return {
+            .linear      = matrix.submatrix<3, 3>(0, 0),
+            .translation = Vector(matrix(0, 3), matrix(1, 3), matrix(2, 3)),
+        };
+    }
+
 public:
     Transform() {}
     Transform(const Properties &) {}
@@ -181,13 +216,30 @@ public:
 
         m_transform = matrix * m_transform;
 
+        // the inverse undoes the translation before the rotation
         matrix.setColumn(3, Vector4(0, 0, 0, 1));
         matrix = matrix.transpose();
-        matrix.setColumn(3, Vector4(-origin, 1));
+        const Vector4 translation = matrix * Vector4(-origin, 0);
+        matrix.setColumn(3, Vector4(translation.x(), translation.y(),
+                                    translation.z(), 1));
 
         m_inverse = m_inverse * matrix;
     }
 
+    /// @brief Whether this transformation is affine, i.e., does not involve a
+    /// perspective division.
+    bool isAffine() const {
+        return m_transform(3, 0) == 0 && m_transform(3, 1) == 0 &&
+               m_transform(3, 2) == 0 && m_transform(3, 3) == 1;
+    }
+
+    /// @brief Returns this transformation as compact affine matrix.
+    /// @warning Only valid if @ref isAffine holds.
+    AffineMatrix affine() const { return toAffine(m_transform); }
+    /// @brief Returns the inverse transformation as compact affine matrix.
+    /// @warning Only valid if @ref isAffine holds.
+    AffineMatrix affineInverse() const { return toAffine(m_inverse); }
+
     /// @brief Returns the determinant of this transformation.
     float determinant() const {
         return m_transform.submatrix<3, 3>(0, 0).determinant();
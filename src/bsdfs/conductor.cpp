@@ -10,7 +10,7 @@ public:
         m_reflectance = properties.get<Texture>("reflectance");
     }
 
-    BsdfEval evaluate(const Point2 &uv, const Vector &wo,
+    BsdfEval evaluate(const BsdfClosure &closure, const Vector &wo,
                       const Vector &wi) const override {
         // the probability of a light sample picking exactly the direction `wi'
         // that results from reflecting `wo' is zero, hence we can just ignore
@@ -18,11 +18,11 @@ public:
         return BsdfEval::invalid();
     }
 
-    BsdfSample sample(const Point2 &uv, const Vector &wo,
+    BsdfSample sample(const BsdfClosure &closure, const Vector &wo,
                       Sampler &rng) const override {
         Vector n = Vector(0, 0, 1); // Local shading normal
 
-        Color weight = m_reflectance->evaluate(uv);
+        Color weight = m_reflectance->evaluate(closure.uv);
         Vector wi    = reflect(wo, n);
 
         BsdfSample bsdfSample = BsdfSample();
@@ -32,6 +32,8 @@ public:
         return bsdfSample;
     }
 
+    bool isDelta() const override { return true; }
+
     std::string toString() const override {
         return tfm::format(
             "Conductor[\n"
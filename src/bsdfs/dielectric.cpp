@@ -15,7 +15,7 @@ public:
         m_transmittance = properties.get<Texture>("transmittance");
     }
 
-    BsdfEval evaluate(const Point2 &uv, const Vector &wo,
+    BsdfEval evaluate(const BsdfClosure &closure, const Vector &wo,
                       const Vector &wi) const override {
         // the probability of a light sample picking exactly the direction `wi'
         // that results from reflecting or refracting `wo' is zero, hence we can
@@ -23,12 +23,12 @@ public:
         return BsdfEval::invalid();
     }
 
-    BsdfSample sample(const Point2 &uv, const Vector &wo,
+    BsdfSample sample(const BsdfClosure &closure, const Vector &wo,
                       Sampler &rng) const override {
         Vector n = Vector(0, 0, 1);
         Color weight;
         Vector wi;
-        float eta      = m_ior->scalar(uv);
+        float eta      = m_ior->scalar(closure.uv);
         float cosTheta = Frame::cosTheta(wo);
         if (cosTheta < 0) {
             eta = 1 / eta;
@@ -36,10 +36,10 @@ public:
         float fresnelReflectance = fresnelDielectric(cosTheta, eta);
 
         if (rng.next() < fresnelReflectance) {
-            weight = m_reflectance->evaluate(uv);
+            weight = m_reflectance->evaluate(closure.uv);
             wi     = reflect(wo, n);
         } else {
-            weight = m_transmittance->evaluate(uv) / (pow(eta, 2));
+            weight = m_transmittance->evaluate(closure.uv) / (pow(eta, 2));
             wi     = refract(wo, n, eta);
         }
 
@@ -50,6 +50,8 @@ public:
         return bsdfSample;
     }
 
+    bool isDelta() const override { return true; }
+
     std::string toString() const override {
         return tfm::format(
             "Dielectric[\n"
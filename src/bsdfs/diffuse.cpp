@@ -1,18 +1,23 @@
 #include <lightwave.hpp>
 
+#include "specialization.hpp"
+
 namespace lightwave {
 
 class Diffuse : public Bsdf {
-    ref<Texture> m_albedo;
+    TextureInput<Color> m_albedo;
 
 public:
-    Diffuse(const Properties &properties) {
-        m_albedo = properties.get<Texture>("albedo");
+    Diffuse(const Properties &properties)
+        : m_albedo(properties.get<Texture>("albedo")) {}
+
+    void prepare(BsdfClosure &closure) const override {
+        closure.store(m_albedo(closure.uv));
     }
 
-    BsdfEval evaluate(const Point2 &uv, const Vector &wo,
+    BsdfEval evaluate(const BsdfClosure &closure, const Vector &wo,
                       const Vector &wi) const override {
-        Color color = Color(m_albedo->evaluate(uv) / Pi);
+        Color color = closure.load<Color>() / Pi;
         color *= abs(wi.normalized().z());
         BsdfEval bsdf = BsdfEval();
         if (!Frame::sameHemisphere(wo, wi)) {
@@ -22,10 +27,11 @@ public:
             return bsdf.invalid();
         }
         bsdf.value = color;
+        bsdf.pdf   = cosineHemispherePdf(wi.normalized());
         return BsdfEval(bsdf);
     }
 
-    BsdfSample sample(const Point2 &uv, const Vector &wo,
+    BsdfSample sample(const BsdfClosure &closure, const Vector &wo,
                       Sampler &rng) const override {
         // Sample a ray direction
         Vector wi = squareToCosineHemisphere(rng.next2D());
@@ -39,23 +45,28 @@ public:
             wi = -wi; // Flip the direction
         }
 
-        Color weight = m_albedo->evaluate(
-            uv); // Would be cosTheta / pdf,  but with simplified equation we
-                 // just have to evaluate the albedo.
+        // Would be cosTheta / pdf,  but with simplified equation we just have
+        // to evaluate the albedo.
+        Color weight = closure.load<Color>();
 
         BsdfSample bsdfSample = BsdfSample();
         bsdfSample.weight     = weight;
         bsdfSample.wi         = wi.normalized();
+        bsdfSample.pdf        = cosineHemispherePdf(bsdfSample.wi);
 
         return bsdfSample;
     }
 
+    bool isDiffuse() const override { return true; }
+
     std::string toString() const override {
         return tfm::format(
             "Diffuse[\n"
+            "  variant = %s,\n"
             "  albedo = %s\n"
             "]",
-            indent(m_albedo));
+            describeSpecialization({ { "albedo", m_albedo.isConstant() } }),
+            indent(m_albedo.texture()));
     }
 };
 
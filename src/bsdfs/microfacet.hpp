@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <lightwave/fastmath.hpp>
 #include <lightwave/math.hpp>
 
 namespace lightwave::microfacet {
@@ -96,10 +97,12 @@ inline Vector sampleGGXVNDF(float alpha, const Vector &wo, const Point2 &rnd) {
     // Section 4.2: parameterization of the projected area
     float r   = sqrt(rnd.x());
     float phi = 2 * Pi * rnd.y();
-    float t1  = r * cos(phi);
-    float t2  = r * sin(phi);
-    float s   = 0.5f * (1 + Vh.z());
-    t2        = (1 - s) * sqrt(1 - sqr(t1)) + s * t2;
+    float sinPhi, cosPhi;
+    fast::sincos(phi, sinPhi, cosPhi);
+    float t1 = r * cosPhi;
+    float t2 = r * sinPhi;
+    float s  = 0.5f * (1 + Vh.z());
+    t2       = (1 - s) * sqrt(1 - sqr(t1)) + s * t2;
     // Section 4.3: reprojection onto hemisphere
     Vector Nh = t1 * T1 + t2 * T2 + safe_sqrt(1 - sqr(t1) - sqr(t2)) * Vh;
     // Section 3.4: transforming the normal back to the ellipsoid configuration
@@ -201,10 +204,12 @@ inline Vector sampleAnisotropicGGXVNDF(float ax, float ay, const Vector &wo,
     // Section 4.2: parameterization of the projected area
     float r   = sqrt(rnd.x());
     float phi = 2 * Pi * rnd.y();
-    float t1  = r * cos(phi);
-    float t2  = r * sin(phi);
-    float s   = 0.5f * (1 + Vh.z());
-    t2        = (1 - s) * sqrt(1 - sqr(t1)) + s * t2;
+    float sinPhi, cosPhi;
+    fast::sincos(phi, sinPhi, cosPhi);
+    float t1 = r * cosPhi;
+    float t2 = r * sinPhi;
+    float s  = 0.5f * (1 + Vh.z());
+    t2       = (1 - s) * sqrt(1 - sqr(t1)) + s * t2;
     // Section 4.3: reprojection onto hemisphere
     Vector Nh = t1 * T1 + t2 * T2 + safe_sqrt(1 - sqr(t1) - sqr(t2)) * Vh;
     // Section 3.4: transforming the normal back to the ellipsoid configuration
@@ -251,7 +256,7 @@ inline float evaluateGTR1(float alpha, const Vector &wh) {
     float nDotH = Frame::cosTheta(wh);
     float a2    = sqr(alpha);
     float t     = 1 + (a2 - 1) * sqr(nDotH);
-    return (a2 - 1) / (Pi * log(a2) * t);
+    return (a2 - 1) / (Pi * fast::log(a2) * t);
 }
 
 /**
@@ -265,11 +270,11 @@ inline float evaluateGTR1(float alpha, const Vector &wh) {
 inline Vector sampleGTR1(float alpha, const Point2 &rnd) {
     float a2 = sqr(alpha);
 
-    float cosTheta = safe_sqrt((1 - pow(a2, 1 - rnd.x())) / (1 - a2));
+    float cosTheta = safe_sqrt((1 - fast::pow(a2, 1 - rnd.x())) / (1 - a2));
     float sinTheta = safe_sqrt(1 - (cosTheta * cosTheta));
     float phi      = 2 * Pi * rnd.y();
-    float sinPhi   = sin(phi);
-    float cosPhi   = cos(phi);
+    float sinPhi, cosPhi;
+    fast::sincos(phi, sinPhi, cosPhi);
 
     return { sinTheta * cosPhi, sinTheta * sinPhi, cosTheta };
 }
@@ -2,6 +2,7 @@
 
 #include "fresnel.hpp"
 #include "microfacet.hpp"
+#include "specialization.hpp"
 
 namespace lightwave {
 
@@ -15,6 +16,7 @@ struct DiffuseLobe {
         }
         bsdf.value = color / Pi;
         bsdf.value *= abs(wi.z());
+        bsdf.pdf = pdf(wo, wi);
         return BsdfEval(bsdf);
     }
 
@@ -24,9 +26,16 @@ struct DiffuseLobe {
         BsdfSample bsdfSample = BsdfSample();
         bsdfSample.weight     = color;
         bsdfSample.wi         = wi.normalized();
+        bsdfSample.pdf        = pdf(wo, bsdfSample.wi);
 
         return bsdfSample;
     }
+
+    float pdf(const Vector &wo, const Vector &wi) const {
+        if (!Frame::sameHemisphere(wi, wo))
+            return 0;
+        return cosineHemispherePdf(wi);
+    }
 };
 
 struct MetallicLobe {
@@ -54,6 +63,7 @@ struct MetallicLobe {
         Color Fr      = (R * D * Gwi * Gwo) / (4 * cosThetao);
         BsdfEval bsdf = BsdfEval();
         bsdf.value    = Fr;
+        bsdf.pdf      = pdf(wo, wi);
         return BsdfEval(bsdf);
     }
 
@@ -71,15 +81,30 @@ struct MetallicLobe {
         BsdfSample bsdfSample = BsdfSample();
         bsdfSample.weight     = weight;
         bsdfSample.wi         = wi.normalized();
+        bsdfSample.pdf        = pdf(wo, bsdfSample.wi);
         return bsdfSample;
     }
+
+    float pdf(const Vector &wo, const Vector &wi) const {
+        const Vector wh = (wi + wo).normalized();
+        return microfacet::pdfGGXVNDF(alpha, wh, wo) *
+               microfacet::detReflection(wh, wo);
+    }
 };
 
 class Principled : public Bsdf {
-    ref<Texture> m_baseColor;
-    ref<Texture> m_roughness;
-    ref<Texture> m_metallic;
-    ref<Texture> m_specular;
+    TextureInput<Color> m_baseColor;
+    TextureInput<float> m_roughness;
+    TextureInput<float> m_metallic;
+    TextureInput<float> m_specular;
+
+    /// @brief The texture values at a surface point.
+    struct Closure {
+        Color baseColor;
+        float alpha;
+        float specular;
+        float metallic;
+    };
 
     struct Combination {
         float diffuseSelectionProb;
@@ -87,11 +112,9 @@ class Principled : public Bsdf {
         MetallicLobe metallic;
     };
 
-    Combination combine(const Point2 &uv, const Vector &wo) const {
-        const auto baseColor = m_baseColor->evaluate(uv);
-        const auto alpha = std::max(float(1e-3), sqr(m_roughness->scalar(uv)));
-        const auto specular = m_specular->scalar(uv);
-        const auto metallic = m_metallic->scalar(uv);
+    Combination combine(const BsdfClosure &closure, const Vector &wo) const {
+        const auto [baseColor, alpha, specular, metallic] =
+            closure.load<Closure>();
         const auto F =
             specular * schlick((1 - metallic) * 0.08f, Frame::cosTheta(wo));
 
@@ -115,18 +138,27 @@ class Principled : public Bsdf {
     }
 
 public:
-    Principled(const Properties &properties) {
-        m_baseColor = properties.get<Texture>("baseColor");
-        m_roughness = properties.get<Texture>("roughness");
-        m_metallic  = properties.get<Texture>("metallic");
-        m_specular  = properties.get<Texture>("specular");
+    Principled(const Properties &properties)
+        : m_baseColor(properties.get<Texture>("baseColor")),
+          m_roughness(properties.get<Texture>("roughness")),
+          m_metallic(properties.get<Texture>("metallic")),
+          m_specular(properties.get<Texture>("specular")) {}
+
+    void prepare(BsdfClosure &closure) const override {
+        const Point2 &uv = closure.uv;
+        closure.store(Closure{
+            .baseColor = m_baseColor(uv),
+            .alpha     = std::max(float(1e-3), sqr(m_roughness(uv))),
+            .specular  = m_specular(uv),
+            .metallic  = m_metallic(uv),
+        });
     }
 
-    BsdfEval evaluate(const Point2 &uv, const Vector &wo,
+    BsdfEval evaluate(const BsdfClosure &closure, const Vector &wo,
                       const Vector &wi) const override {
         PROFILE("Principled")
 
-        const auto combination = combine(uv, wo);
+        const auto combination = combine(closure, wo);
 
         const BsdfEval diffuseEval  = combination.diffuse.evaluate(wo, wi);
         const BsdfEval metallicEval = combination.metallic.evaluate(wo, wi);
@@ -134,22 +166,33 @@ public:
         BsdfEval bsdfEval = BsdfEval();
 
         bsdfEval.value = diffuseEval.value + metallicEval.value;
+        bsdfEval.pdf   = combination.diffuseSelectionProb * diffuseEval.pdf +
+                       (1 - combination.diffuseSelectionProb) *
+                           metallicEval.pdf;
         return bsdfEval;
     }
 
-    BsdfSample sample(const Point2 &uv, const Vector &wo,
+    BsdfSample sample(const BsdfClosure &closure, const Vector &wo,
                       Sampler &rng) const override {
         PROFILE("Principled")
 
-        const auto combination = combine(uv, wo);
+        const auto combination = combine(closure, wo);
 
         if (rng.next() < combination.diffuseSelectionProb) {
             BsdfSample diffuseSample = combination.diffuse.sample(wo, rng);
             diffuseSample.weight /= combination.diffuseSelectionProb;
+            diffuseSample.pdf =
+                combination.diffuseSelectionProb * diffuseSample.pdf +
+                (1 - combination.diffuseSelectionProb) *
+                    combination.metallic.pdf(wo, diffuseSample.wi);
             return diffuseSample;
         } else {
             BsdfSample metallicSample = combination.metallic.sample(wo, rng);
             metallicSample.weight /= (1.0f - combination.diffuseSelectionProb);
+            metallicSample.pdf =
+                combination.diffuseSelectionProb *
+                    combination.diffuse.pdf(wo, metallicSample.wi) +
+                (1 - combination.diffuseSelectionProb) * metallicSample.pdf;
             return metallicSample;
         }
     }
@@ -157,15 +200,22 @@ public:
     std::string toString() const override {
         return tfm::format(
             "Principled[\n"
+            "  variant   = %s,\n"
             "  baseColor = %s,\n"
             "  roughness = %s,\n"
             "  metallic  = %s,\n"
             "  specular  = %s,\n"
             "]",
-            indent(m_baseColor),
-            indent(m_roughness),
-            indent(m_metallic),
-            indent(m_specular));
+            describeSpecialization({
+                { "baseColor", m_baseColor.isConstant() },
+                { "roughness", m_roughness.isConstant() },
+                { "metallic", m_metallic.isConstant() },
+                { "specular", m_specular.isConstant() },
+            }),
+            indent(m_baseColor.texture()),
+            indent(m_roughness.texture()),
+            indent(m_metallic.texture()),
+            indent(m_specular.texture()));
     }
 };
 
@@ -1,28 +1,39 @@
 #include "fresnel.hpp"
 #include "microfacet.hpp"
+#include "specialization.hpp"
 #include <lightwave.hpp>
 
 namespace lightwave {
 
 class RoughConductor : public Bsdf {
-    ref<Texture> m_reflectance;
-    ref<Texture> m_roughness;
+    TextureInput<Color> m_reflectance;
+    TextureInput<float> m_roughness;
+
+    struct Closure {
+        Color reflectance;
+        float alpha;
+    };
 
 public:
-    RoughConductor(const Properties &properties) {
-        m_reflectance = properties.get<Texture>("reflectance");
-        m_roughness   = properties.get<Texture>("roughness");
-    }
+    RoughConductor(const Properties &properties)
+        : m_reflectance(properties.get<Texture>("reflectance")),
+          m_roughness(properties.get<Texture>("roughness")) {}
 
-    BsdfEval evaluate(const Point2 &uv, const Vector &wo,
-                      const Vector &wi) const override {
+    void prepare(BsdfClosure &closure) const override {
         // Using the squared roughness parameter results in a more gradual
         // transition from specular to rough. For numerical stability, we avoid
         // extremely specular distributions (alpha values below 10^-3)
-        const auto alpha = std::max(float(1e-3), sqr(m_roughness->scalar(uv)));
+        closure.store(Closure{
+            .reflectance = m_reflectance(closure.uv),
+            .alpha       = std::max(float(1e-3), sqr(m_roughness(closure.uv))),
+        });
+    }
+
+    BsdfEval evaluate(const BsdfClosure &closure, const Vector &wo,
+                      const Vector &wi) const override {
+        const auto [R, alpha] = closure.load<Closure>();
 
         Vector wh = (wi + wo).normalized();
-        Color R   = m_reflectance->evaluate(uv);
 
         if (std::isnan(wi.x()) || std::isnan(wi.y()) || std::isnan(wi.z())) {
             return BsdfEval().invalid();
@@ -44,12 +55,14 @@ public:
         BsdfEval bsdf = BsdfEval();
 
         bsdf.value = Fr;
+        bsdf.pdf   = microfacet::pdfGGXVNDF(alpha, wh, wo) *
+                   microfacet::detReflection(wh, wo);
         return BsdfEval(bsdf);
     }
 
-    BsdfSample sample(const Point2 &uv, const Vector &wo,
+    BsdfSample sample(const BsdfClosure &closure, const Vector &wo,
                       Sampler &rng) const override {
-        const auto alpha = std::max(float(1e-3), sqr(m_roughness->scalar(uv)));
+        const auto [R, alpha] = closure.load<Closure>();
         // Normalized
         Vector wh =
             microfacet::sampleGGXVNDF(alpha, wo, rng.next2D()).normalized();
@@ -65,7 +78,6 @@ public:
             return BsdfSample().invalid(); // Invalid sample
         }
 
-        Color R   = m_reflectance->evaluate(uv);
         float Gwi = microfacet::smithG1(alpha, wh, wi);
 
         Color weight = (R * Gwi); // Simplifying the equation has /costhetai
@@ -73,17 +85,24 @@ public:
         BsdfSample bsdfSample = BsdfSample();
         bsdfSample.weight     = weight;
         bsdfSample.wi         = wi.normalized();
+        bsdfSample.pdf        = microfacet::pdfGGXVNDF(alpha, wh, wo) *
+                         microfacet::detReflection(wh, wo);
         return bsdfSample;
     }
 
     std::string toString() const override {
         return tfm::format(
             "RoughConductor[\n"
+            "  variant = %s,\n"
             "  reflectance = %s,\n"
             "  roughness = %s\n"
             "]",
-            indent(m_reflectance),
-            indent(m_roughness));
+            describeSpecialization({
+                { "reflectance", m_reflectance.isConstant() },
+                { "roughness", m_roughness.isConstant() },
+            }),
+            indent(m_reflectance.texture()),
+            indent(m_roughness.texture()));
     }
 };
 
@@ -0,0 +1,79 @@
+/**
+ * @brief Load-time specialization of Bsdf inputs that are constant textures.
+ * @file specialization.hpp
+ */
+
+#pragma once
+
+#include <lightwave/texture.hpp>
+
+#include <string>
+#include <utility>
+
+namespace lightwave {
+
+/**
+ * @brief A texture input of a Bsdf. If the texture is constant, its value is
+ * baked in at load time, so that looking it up neither calls a virtual
+ * function nor dereferences the texture.
+ * @tparam T Either @c Color for color inputs, or @c float for scalar inputs
+ * (which use the red channel, like @ref Texture::scalar ).
+ */
+template <typename T> class TextureInput {
+    /// @brief The texture the input was loaded from, used for printing.
+    ref<Texture> m_texture;
+    /// @brief The value of the texture if it is constant.
+    T m_value{};
+    bool m_constant;
+
+public:
+    TextureInput(const ref<Texture> &texture) : m_texture(texture) {
+        const std::optional<Color> value = texture->constant();
+        m_constant                       = value.has_value();
+        if (m_constant) {
+            if constexpr (std::is_same_v<T, float>)
+                m_value = value->r();
+            else
+                m_value = *value;
+        }
+    }
+
+    T operator()(const Point2 &uv) const {
+        if (m_constant)
+            return m_value;
+        if constexpr (std::is_same_v<T, float>)
+            return m_texture->scalar(uv);
+        else
+            return m_texture->evaluate(uv);
+    }
+
+    /// @brief Whether the value has been baked in at load time.
+    bool isConstant() const { return m_constant; }
+    const ref<Texture> &texture() const { return m_texture; }
+};
+
+/**
+ * @brief Describes which inputs of a Bsdf have been specialized, for the
+ * @c toString output of Bsdfs: "constant" if all inputs are constant,
+ * "textured" if none are, and the list of constant inputs otherwise.
+ */
+inline std::string
+describeSpecialization(std::initializer_list<std::pair<const char *, bool>>
+                           inputs) {
+    std::string constantInputs;
+    size_t count = 0;
+    for (const auto &[name, isConstant] : inputs) {
+        if (!isConstant)
+            continue;
+        if (count++)
+            constantInputs += ", ";
+        constantInputs += name;
+    }
+    if (count == inputs.size())
+        return "constant";
+    if (count == 0)
+        return "textured";
+    return "constant " + constantInputs;
+}
+
+} // namespace lightwave
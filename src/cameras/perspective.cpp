@@ -15,6 +15,7 @@ namespace lightwave {
 class Perspective : public Camera {
 public:
     Perspective(const Properties &properties) : Camera(properties) {
+        m_rasterize         = properties.get<bool>("rasterize", false);
         float fov           = properties.get<float>("fov");
         std::string fovAxis = properties.get<std::string>("fovAxis");
 
@@ -34,6 +35,15 @@ public:
         }
     }
 
+    bool rasterizationExtent(Vector2 &extent) const override {
+        extent = Vector2(mult_x, mult_y);
+        return m_rasterize;
+    }
+
+    float pixelAngle() const override {
+        return 2 * mult_x / m_resolution.x();
+    }
+
     CameraSample sample(const Point2 &normalized, Sampler &rng) const override {
 
         float px = normalized.x() * mult_x;
@@ -55,16 +65,20 @@ public:
             "Perspective[\n"
             "  width = %d,\n"
             "  height = %d,\n"
+            "  rasterize = %s,\n"
             "  transform = %s,\n"
             "]",
             m_resolution.x(),
             m_resolution.y(),
+            m_rasterize,
             indent(m_transform));
     }
 
 private:
     float mult_x;
     float mult_y;
+    /// @brief Whether primary visibility is rasterized instead of traced.
+    bool m_rasterize;
 };
 
 } // namespace lightwave
@@ -39,6 +39,10 @@ public:
         }
     }
 
+    float pixelAngle() const override {
+        return 2 * mult_x / m_resolution.x();
+    }
+
     CameraSample sample(const Point2 &normalized, Sampler &rng) const override {
         float px = normalized.x() * mult_x;
         float py = normalized.y() * mult_y;
@@ -0,0 +1,65 @@
+#include "buffer.hpp"
+
+#include <lightwave/logger.hpp>
+
+#ifdef LW_OS_WINDOWS
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lightwave {
+
+#ifdef LW_OS_WINDOWS
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream)
+        lightwave_throw("could not open file \"%s\"", path.generic_string());
+    m_contents.resize(size_t(stream.tellg()));
+    stream.seekg(0);
+    stream.read(reinterpret_cast<char *>(m_contents.data()),
+                std::streamsize(m_contents.size()));
+    if (!stream)
+        lightwave_throw("could not read file \"%s\"", path.generic_string());
+    m_data = m_contents.data();
+    m_size = m_contents.size();
+}
+
+MappedFile::~MappedFile() {}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        lightwave_throw("could not open file \"%s\"", path.generic_string());
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        lightwave_throw("could not open file \"%s\"", path.generic_string());
+    }
+    m_size = size_t(status.st_size);
+    if (m_size > 0) {
+        void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            lightwave_throw("could not map file \"%s\"", path.generic_string());
+        }
+        m_data = static_cast<const std::byte *>(data);
+    }
+    // the mapping stays valid after closing the file
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data)
+        munmap(const_cast<std::byte *>(m_data), m_size);
+}
+
+#endif
+
+} // namespace lightwave
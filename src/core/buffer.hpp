@@ -0,0 +1,146 @@
+/**
+ * @file buffer.hpp
+ * @brief Contains memory-mapped files, and buffers that can refer to their
+ * contents without copying them.
+ */
+
+#pragma once
+
+#include <lightwave/core.hpp>
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace lightwave {
+
+/**
+ * @brief The read-only contents of a file, which are memory-mapped where the
+ * platform supports it (and read into memory otherwise), so that pages are
+ * only loaded from disk when they are accessed.
+ */
+class MappedFile {
+    const std::byte *m_data = nullptr;
+    size_t m_size           = 0;
+#ifdef LW_OS_WINDOWS
+    std::vector<std::byte> m_contents;
+#endif
+
+public:
+    /// @brief Maps the given file, throwing if it cannot be opened.
+    MappedFile(const std::filesystem::path &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const std::byte *data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
+/**
+ * @brief A contiguous array that either owns its elements (like @c std::vector
+ * ), or refers to elements stored within a memory-mapped file, which it keeps
+ * alive. Modifying a buffer that refers to a file copies its elements first.
+ * @note Elements are accessed through a plain pointer in both cases, so that
+ * reading does not cost more than for @c std::vector .
+ */
+template <typename T> class Buffer {
+    std::vector<T> m_owned;
+    ref<const MappedFile> m_file;
+    T *m_data     = nullptr;
+    size_t m_size = 0;
+
+    void sync() {
+        m_data = m_owned.data();
+        m_size = m_owned.size();
+    }
+
+    void makeOwned() {
+        if (m_file) {
+            m_owned.assign(m_data, m_data + m_size);
+            m_file.reset();
+            sync();
+        }
+    }
+
+public:
+    Buffer() = default;
+    Buffer(std::vector<T> owned) : m_owned(std::move(owned)) { sync(); }
+    /// @brief Refers to elements within a file, which must be suitably
+    /// aligned.
+    Buffer(const ref<const MappedFile> &file, const T *data, size_t size)
+        : m_file(file), m_data(const_cast<T *>(data)), m_size(size) {}
+
+    Buffer(const Buffer &other) : m_owned(other.m_owned), m_file(other.m_file) {
+        if (m_file) {
+            m_data = other.m_data;
+            m_size = other.m_size;
+        } else {
+            sync();
+        }
+    }
+    Buffer(Buffer &&other) noexcept
+        : m_owned(std::move(other.m_owned)), m_file(std::move(other.m_file)),
+          m_data(other.m_data), m_size(other.m_size) {
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    Buffer &operator=(Buffer other) noexcept {
+        std::swap(m_owned, other.m_owned);
+        std::swap(m_file, other.m_file);
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    /// @brief Whether the elements are stored within a memory-mapped file.
+    bool isMapped() const { return m_file != nullptr; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const T *data() const { return m_data; }
+
+    const T &operator[](size_t index) const { return m_data[index]; }
+    T &operator[](size_t index) {
+        makeOwned();
+        return m_data[index];
+    }
+    const T &front() const { return m_data[0]; }
+    const T &back() const { return m_data[m_size - 1]; }
+
+    const T *begin() const { return m_data; }
+    const T *end() const { return m_data + m_size; }
+    T *begin() {
+        makeOwned();
+        return m_data;
+    }
+    T *end() {
+        makeOwned();
+        return m_data + m_size;
+    }
+
+    template <typename... Args> T &emplace_back(Args &&...args) {
+        makeOwned();
+        T &result = m_owned.emplace_back(std::forward<Args>(args)...);
+        sync();
+        return result;
+    }
+    void push_back(const T &value) { emplace_back(value); }
+    template <typename Iterator>
+    void insert(const T *position, Iterator first, Iterator last) {
+        const size_t index = position - m_data;
+        makeOwned();
+        m_owned.insert(m_owned.begin() + index, first, last);
+        sync();
+    }
+    void resize(size_t size) {
+        makeOwned();
+        m_owned.resize(size);
+        sync();
+    }
+
+    operator std::span<const T>() const { return { m_data, m_size }; }
+};
+
+} // namespace lightwave
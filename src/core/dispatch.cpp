@@ -0,0 +1,88 @@
+#include <lightwave/dispatch.hpp>
+#include <lightwave/logger.hpp>
+
+#include <cstdlib>
+
+namespace lightwave::dispatch {
+
+namespace detail {
+Isa activeIsa = detect();
+} // namespace detail
+
+bool supported(Isa isa) {
+    switch (isa) {
+    case Isa::Generic:
+        return true;
+#ifdef LW_DISPATCH_ENABLED
+    // these also check whether the operating system saves the wider registers
+    case Isa::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+               __builtin_cpu_supports("bmi2");
+    case Isa::AVX512:
+        return supported(Isa::AVX2) && __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512vl") &&
+               __builtin_cpu_supports("avx512dq") &&
+               __builtin_cpu_supports("avx512bw");
+#endif
+    default:
+        return false;
+    }
+}
+
+Isa detect() {
+    for (Isa isa : { Isa::AVX512, Isa::AVX2 }) {
+        if (supported(isa))
+            return isa;
+    }
+    return Isa::Generic;
+}
+
+const char *name(Isa isa) {
+    switch (isa) {
+    case Isa::AVX2:
+        return "avx2";
+    case Isa::AVX512:
+        return "avx512";
+    default:
+        return "generic";
+    }
+}
+
+void select(const std::string &request) {
+    std::string requested = request;
+    if (requested.empty()) {
+        if (const char *environment = std::getenv("LW_ISA"))
+            requested = environment;
+    }
+
+    const Isa best = detect();
+    Isa isa        = best;
+    if (!requested.empty()) {
+        bool known = false;
+        for (Isa candidate : { Isa::Generic, Isa::AVX2, Isa::AVX512 }) {
+            if (requested == name(candidate)) {
+                isa   = candidate;
+                known = true;
+            }
+        }
+        if (!known)
+            lightwave_throw("unknown instruction set \"%s\" (expected "
+                            "generic, avx2 or avx512)",
+                            requested);
+        if (!supported(isa)) {
+            logger(EWarn,
+                   "this CPU does not support %s, falling back to %s",
+                   name(isa),
+                   name(best));
+            isa = best;
+        }
+    }
+
+    detail::activeIsa = isa;
+    logger(EInfo,
+           "using %s kernels (best supported: %s)",
+           name(isa),
+           name(best));
+}
+
+} // namespace lightwave::dispatch
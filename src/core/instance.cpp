@@ -3,9 +3,12 @@
 #include <lightwave/registry.hpp>
 #include <lightwave/sampler.hpp>
 
+#include <utility>
+
 namespace lightwave {
 
-void Instance::transformFrame(SurfaceEvent &surf, const Vector &wo) const {
+template <Instance::TransformKind Kind>
+void Instance::transformFrame(SurfaceEvent &surf) const {
     Frame shadingFrame = surf.shadingFrame();
 
     if (m_normal) {
@@ -21,15 +24,28 @@ void Instance::transformFrame(SurfaceEvent &surf, const Vector &wo) const {
 
         shadingFrame.normal = normal_vec;
     }
-    shadingFrame.normal =
-        m_transform->applyNormal(shadingFrame.normal).normalized();
-    shadingFrame.tangent =
-        m_transform->apply(shadingFrame.tangent).normalized();
+    if constexpr (Kind == TransformKind::General) {
+        // normals transform with the inverse transpose
+        shadingFrame.normal =
+            m_toObject.applyTranspose(shadingFrame.normal).normalized();
+    } else if constexpr (Kind != TransformKind::Identity) {
+        // ... which is the transform itself up to scaling for similarities
+        shadingFrame.normal = m_toWorld.apply(shadingFrame.normal).normalized();
+    }
+    if constexpr (Kind != TransformKind::Identity) {
+        shadingFrame.tangent = m_toWorld.apply(shadingFrame.tangent).normalized();
+    }
     surf.tangent        = shadingFrame.tangent;
     surf.geometryNormal = shadingFrame.normal;
     surf.shadingNormal  = surf.geometryNormal;
 }
 
+namespace {
+/// @brief Passes a transform kind as compile-time constant.
+template <Instance::TransformKind Kind>
+constexpr std::integral_constant<Instance::TransformKind, Kind> kind{};
+} // namespace
+
 inline void validateIntersection(const Intersection &its) {
     // use the following macros to make debugginer easier:
     // * assert_condition(condition, { ... });
@@ -57,57 +73,172 @@ inline void validateIntersection(const Intersection &its) {
     });
 }
 
-bool Instance::intersect(const Ray &worldRay, Intersection &its,
-                         Sampler &rng) const {
-    if (!m_transform && !m_normal) {
-        // fast path, if no transform is needed
-        const Ray localRay        = worldRay;
-        const bool wasIntersected = m_shape->intersect(localRay, its, rng);
-        if (wasIntersected) {
-            its.instance = this;
-            validateIntersection(its);
+template <Instance::TransformKind Kind, bool AlphaMask, bool NormalMap>
+bool Instance::intersectVariant(const Ray &worldRay, Intersection &its,
+                                Sampler &rng) const {
+    const float previousT = its.t;
+    // the distance in object coordinates per unit distance in world
+    // coordinates
+    float scale;
+
+    // Transform the ray
+    const Ray localRay = toObjectRay<Kind>(m_toObject, m_scale, worldRay, scale);
+    its.t *= scale;
+
+    const bool wasIntersected = m_intersected->intersect(localRay, its, rng);
+    if (!wasIntersected) {
+        its.t = previousT;
+        return false;
+    }
+    return completeVariant<Kind, AlphaMask, NormalMap>(
+        its, previousT, scale, rng);
+}
+
+template <Instance::TransformKind Kind, bool AlphaMask, bool NormalMap>
+bool Instance::completeVariant(Intersection &its, float previousT,
+                               float scale, Sampler &rng) const {
+    if constexpr (AlphaMask) {
+        // Evaluate the alpha channel at the intersection
+        const float alpha = m_alpha->evaluate(its.uv).r();
+        if (alpha < rng.next()) {
+            // Discard intersection
+            its.t = previousT;
+            return false;
         }
-        return wasIntersected;
     }
 
-    const float previousT = its.t;
-    Ray localRay;
+    its.instance         = this;
+    its.closure.prepared = false;
+    validateIntersection(its);
+    its.t /= scale;
 
-    // Transform the ray
-    localRay = m_transform->inverse(worldRay);
-    const float scale_t =
-        (localRay.direction.length() / worldRay.direction.length());
-    its.t              = its.t * scale_t;
-    localRay.direction = localRay.direction.normalized();
-
-    const bool wasIntersected = m_shape->intersect(localRay, its, rng);
-    if (wasIntersected) {
-        if (m_alpha) {
-            // Evaluate the alpha channel at the intersection
-            float alpha = m_alpha->evaluate(its.uv).r();
-            // std::cout << "Alpha value is " << alpha << '\n';
-            if (alpha < rng.next()) {
-                // Discard intersection
-                its.t = previousT;
-                return false;
+    if constexpr (Kind != TransformKind::Identity) {
+        its.position = m_toWorld.apply(its.position);
+    }
+    if constexpr (Kind != TransformKind::Identity || NormalMap) {
+        transformFrame<Kind>(its);
+    }
+    return true;
+}
+
+void Instance::specialize() {
+    // tolerance for rounding errors of rotation matrices
+    constexpr float Tolerance = 1e-5f;
+
+    m_kind     = TransformKind::Identity;
+    m_scale    = 1;
+    m_toWorld  = { .linear = Matrix3x3::identity(), .translation = Vector(0) };
+    m_toObject = m_toWorld;
+    if (m_transform) {
+        if (!m_transform->isAffine()) {
+            lightwave_throw("instances only support affine transforms");
+        }
+        m_toWorld  = m_transform->affine();
+        m_toObject = m_transform->affineInverse();
+
+        // a transform scales all lengths uniformly iff its columns are
+        // orthogonal and of equal length
+        const Matrix3x3 &linear = m_toWorld.linear;
+        const Matrix3x3 gram    = linear.transpose() * linear;
+        const float scale2      = gram(0, 0);
+        bool uniform            = true;
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 3; column++) {
+                const float expected = row == column ? scale2 : 0;
+                if (abs(gram(row, column) - expected) > Tolerance * scale2)
+                    uniform = false;
             }
         }
+        m_scale = sqrt(scale2);
 
-        its.instance = this;
-        validateIntersection(its);
-        its.t = its.t / scale_t;
+        if (!uniform) {
+            m_kind = TransformKind::General;
+        } else if (abs(m_scale - 1) > Tolerance) {
+            m_kind = TransformKind::UniformScale;
+        } else if (linear != Matrix3x3::identity() ||
+                   !m_toWorld.translation.isZero()) {
+            m_kind = TransformKind::Rigid;
+        }
+    }
 
-        its.position = m_transform->apply(its.position);
-        transformFrame(its, -localRay.direction);
-    } else {
-        its.t = previousT;
+    const auto select = [&](auto kind) {
+        constexpr TransformKind Kind = decltype(kind)::value;
+        const auto use = [&](auto alpha, auto normal) {
+            constexpr bool AlphaMask = decltype(alpha)::value;
+            constexpr bool NormalMap = decltype(normal)::value;
+            m_intersect = &Instance::intersectVariant<Kind, AlphaMask, NormalMap>;
+            m_complete  = &Instance::completeVariant<Kind, AlphaMask, NormalMap>;
+        };
+        // shapes that apply the alpha mask themselves need no alpha test here
+        if (m_alpha && !m_maskedShape) {
+            m_normal ? use(std::true_type(), std::true_type())
+                     : use(std::true_type(), std::false_type());
+        } else {
+            m_normal ? use(std::false_type(), std::true_type())
+                     : use(std::false_type(), std::false_type());
+        }
+    };
+    switch (m_kind) {
+    case TransformKind::Identity:
+        select(kind<TransformKind::Identity>);
+        break;
+    case TransformKind::Rigid:
+        select(kind<TransformKind::Rigid>);
+        break;
+    case TransformKind::UniformScale:
+        select(kind<TransformKind::UniformScale>);
+        break;
+    case TransformKind::General:
+        select(kind<TransformKind::General>);
+        break;
     }
+}
 
-    return wasIntersected;
+std::string Instance::variant() const {
+    static const char *const names[] = {
+        "identity", "rigid", "uniform scale", "general"
+    };
+    std::string result = names[int(m_kind)];
+    if (m_maskedShape)
+        result += ", opacity micromap";
+    else if (m_alpha)
+        result += ", alpha mask";
+    if (m_normal)
+        result += ", normal map";
+    return result;
+}
+
+InlinePrimitive Instance::inlinePrimitive() const {
+    if (m_alpha)
+        return {};
+
+    const InlinePrimitive primitive = m_shape->inlinePrimitive();
+    if (m_kind == TransformKind::Identity)
+        return primitive;
+
+    switch (primitive.type) {
+    case InlinePrimitive::Type::Sphere:
+        // spheres only stay spheres under similarity transforms
+        if (m_kind == TransformKind::General)
+            return {};
+        return InlinePrimitive::sphere(m_toWorld.apply(primitive.origin),
+                                       m_scale * sqrt(primitive.radius2),
+                                       m_scale * primitive.epsilon);
+    case InlinePrimitive::Type::Parallelogram:
+        // (for general transforms, the epsilon in world space depends on the
+        // direction of the ray, which we neglect)
+        return InlinePrimitive::parallelogram(
+            m_toWorld.apply(primitive.origin),
+            m_toWorld.apply(primitive.edge1),
+            m_toWorld.apply(primitive.edge2),
+            m_scale * primitive.epsilon);
+    default:
+        return {};
+    }
 }
 
 Bounds Instance::getBoundingBox() const {
-    if (!m_transform) {
+    if (m_kind == TransformKind::Identity) {
         // fast path
         return m_shape->getBoundingBox();
     }
@@ -125,25 +256,92 @@ Bounds Instance::getBoundingBox() const {
                 p[dim] = untransformedAABB.max()[dim];
             }
         }
-        p = m_transform->apply(p);
+        p = m_toWorld.apply(p);
         result.extend(p);
     }
     return result;
 }
 
 Point Instance::getCentroid() const {
-    if (!m_transform) {
+    if (m_kind == TransformKind::Identity) {
         // fast path
         return m_shape->getCentroid();
     }
 
-    return m_transform->apply(m_shape->getCentroid());
+    return m_toWorld.apply(m_shape->getCentroid());
+}
+
+void Instance::mergeInto(const ref<Shape> &merged) {
+    if (m_kind != TransformKind::Identity || m_alpha)
+        lightwave_throw("only untransformed instances without alpha masks can "
+                        "be merged");
+    m_shape       = merged;
+    m_intersected = merged.get();
+    m_merged      = true;
+    m_intersect   = &Instance::intersectMerged;
+}
+
+ref<Shape> Instance::selectDetail(const Point &eye, float errorPerDistance) {
+    const Bounds bounds = getBoundingBox();
+    if (errorPerDistance <= 0 || bounds.isUnbounded())
+        return nullptr;
+    const Point closest = elementwiseMin(elementwiseMax(eye, bounds.min()),
+                                         bounds.max());
+    const float distance = (closest - eye).length();
+    if (distance <= 0)
+        return nullptr; // the eye lies within the instance
+
+    // the largest factor by which the transform stretches lengths (bounded by
+    // the Frobenius norm for general transforms)
+    float stretch = 1;
+    if (m_kind == TransformKind::UniformScale) {
+        stretch = m_scale;
+    } else if (m_kind == TransformKind::General) {
+        float norm2 = 0;
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 3; column++)
+                norm2 += sqr(m_toWorld.linear(row, column));
+        }
+        stretch = sqrt(norm2);
+    }
+
+    const ref<Shape> level =
+        m_shape->withDetail(errorPerDistance * distance / stretch);
+    if (!level)
+        return nullptr;
+    ref<Shape> original = std::exchange(m_shape, level);
+    if (m_alpha)
+        m_maskedShape = m_shape->withAlphaMask(m_alpha);
+    m_intersected = m_maskedShape ? m_maskedShape.get() : m_shape.get();
+    return original;
 }
 
 AreaSample Instance::sampleArea(Sampler &rng) const {
     AreaSample sample = m_shape->sampleArea(rng);
-    transformFrame(sample, Vector());
-    sample.position = m_transform->apply(sample.position);
+    // the shape reports its pdf in object space, so account for how the
+    // transform stretches a surface element at the sampled point
+    switch (m_kind) {
+    case TransformKind::Identity:
+        if (m_normal)
+            transformFrame<TransformKind::Identity>(sample);
+        return sample;
+    case TransformKind::Rigid:
+        transformFrame<TransformKind::Rigid>(sample);
+        break;
+    case TransformKind::UniformScale:
+        sample.pdf /= m_scale * m_scale;
+        transformFrame<TransformKind::UniformScale>(sample);
+        break;
+    case TransformKind::General: {
+        const Frame local = Frame(sample.geometryNormal);
+        sample.pdf /= m_toWorld.apply(local.tangent)
+                          .cross(m_toWorld.apply(local.bitangent))
+                          .length();
+        transformFrame<TransformKind::General>(sample);
+        break;
+    }
+    }
+    sample.position = m_toWorld.apply(sample.position);
     return sample;
 }
 
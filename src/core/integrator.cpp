@@ -4,10 +4,13 @@
 
 #include <algorithm>
 #include <chrono>
+#include <optional>
 
 #include <lightwave/iterators.hpp>
 #include <lightwave/streaming.hpp>
 
+#include "visibility.hpp"
+
 namespace lightwave {
 
 void SamplingIntegrator::execute() {
@@ -21,24 +24,81 @@ void SamplingIntegrator::execute() {
 
     const float norm = 1.0f / m_sampler->samplesPerPixel();
 
+    const Vector2i blockSize(64);
+    Vector2 extent;
+    ref<VisibilityBuffer> visibility;
+    if (m_scene->camera()->rasterizationExtent(extent))
+        visibility = std::make_shared<VisibilityBuffer>(*m_scene, blockSize);
+    // blocks are rasterized for a limited number of samples per pixel at a
+    // time, which bounds the memory used by each thread
+    constexpr int MaxRasterizedSamples = 1 << 16;
+    const int samplesPerPixel = m_sampler->samplesPerPixel();
+    const int batchSize =
+        visibility ? std::clamp(MaxRasterizedSamples / blockSize.product(), 1,
+                                samplesPerPixel)
+                   : samplesPerPixel;
+
+    struct ThreadState {
+        ref<Sampler> sampler;
+        VisibilityBuffer::Tile visibility;
+        /// @brief The sums of the samples of each pixel in the block.
+        std::vector<Color> sums;
+    };
+
     Streaming stream{ *m_image };
     ProgressReporter progress{ resolution.product() };
-    for_each_parallel(BlockSpiral(resolution, Vector2i(64)), [&](auto block) {
-        auto sampler = m_sampler->clone();
-        for (auto pixel : block) {
-            Color sum;
-            for (int sample = 0; sample < m_sampler->samplesPerPixel();
-                 sample++) {
-                sampler->seed(pixel, sample);
-                auto cameraSample = m_scene->camera()->sample(pixel, *sampler);
-                sum += cameraSample.weight * Li(cameraSample.ray, *sampler);
+    // each thread reseeds its own sampler for every pixel, so there is no need
+    // to create a new sampler for every block
+    for_each_parallel_with_state(
+        BlockSpiral(resolution, blockSize),
+        [&] {
+            return ThreadState{ .sampler    = m_sampler->clone(),
+                                .visibility = {},
+                                .sums       = {} };
+        },
+        [&](auto block, ThreadState &state) {
+            Sampler &sampler = *state.sampler;
+            const Vector2i size = block.diagonal();
+            state.sums.assign(size.product(), Color(0));
+
+            for (int first = 0; first < samplesPerPixel; first += batchSize) {
+                const int last = std::min(first + batchSize, samplesPerPixel);
+                if (visibility) {
+                    visibility->rasterize(
+                        block, sampler, first, last - first, state.visibility);
+                }
+
+                for (auto pixel : block) {
+                    const Vector2i offset = pixel - block.min();
+                    Color &sum = state.sums[offset.y() * size.x() + offset.x()];
+                    for (int sample = first; sample < last; sample++) {
+                        sampler.seed(pixel, sample);
+                        auto cameraSample =
+                            m_scene->camera()->sample(pixel, sampler);
+                        std::optional<Intersection> its;
+                        if (visibility) {
+                            its = visibility->intersect(
+                                cameraSample.ray,
+                                state.visibility(pixel, sample),
+                                sampler);
+                        }
+                        sum += cameraSample.weight *
+                               (its ? LiAt(cameraSample.ray, *its, sampler)
+                                    : Li(cameraSample.ray, sampler));
+                    }
+                }
+            }
+
+            for (auto pixel : block) {
+                const Vector2i offset = pixel - block.min();
+                m_image->get(pixel) =
+                    norm * state.sums[offset.y() * size.x() + offset.x()];
             }
-            m_image->get(pixel) = norm * sum;
-        }
+            finishBlock();
 
-        progress += block.diagonal().product();
-        stream.updateBlock(block);
-    });
+            progress += block.diagonal().product();
+            stream.updateBlock(block);
+        });
     progress.finish();
 
     m_image->save();
@@ -0,0 +1,115 @@
+#include "lwmesh.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace lightwave::lwmesh {
+
+namespace {
+
+constexpr char Magic[8]     = { 'L', 'W', 'M', 'E', 'S', 'H', 0, 0 };
+constexpr uint32_t ByteOrder = 0x01020304;
+
+size_t align(size_t offset) {
+    return (offset + Alignment - 1) / Alignment * Alignment;
+}
+
+} // namespace
+
+uint64_t hash(const MappedFile &file) {
+    // FNV-1a over 64-bit words (with the size mixed in for the tail), which
+    // runs at memory bandwidth while reliably detecting modified files
+    constexpr uint64_t Prime = 0x100000001b3;
+    uint64_t result          = 0xcbf29ce484222325 ^ file.size();
+    const std::byte *data    = file.data();
+    const size_t words       = file.size() / sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        std::memcpy(&word, data + i * sizeof(uint64_t), sizeof(word));
+        result = (result ^ word) * Prime;
+        result ^= result >> 29;
+    }
+    for (size_t i = words * sizeof(uint64_t); i < file.size(); i++)
+        result = (result ^ uint64_t(data[i])) * Prime;
+    return result;
+}
+
+void write(const std::filesystem::path &path, uint64_t sourceHash,
+           uint32_t loaderVersion, std::initializer_list<SectionData> sections) {
+    if (sections.size() > MaxSections)
+        lightwave_throw("lwmesh files are limited to %d sections", MaxSections);
+
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.byteOrder    = ByteOrder;
+    header.version      = Version;
+    header.sourceHash    = sourceHash;
+    header.loaderVersion = loaderVersion;
+    header.sectionCount = sections.size();
+    size_t offset       = align(sizeof(Header));
+    int index           = 0;
+    for (const SectionData &section : sections) {
+        header.sections[index++] = { offset, section.count,
+                                     section.elementSize };
+        offset = align(offset + section.count * section.elementSize);
+    }
+
+    // the temporary name is unique, so that several processes can write the
+    // same file at once
+    std::filesystem::path temporary = path;
+    temporary += tfm::format(".%x.tmp", std::random_device()());
+    {
+        std::ofstream stream(temporary, std::ios::out | std::ios::binary);
+        if (!stream)
+            lightwave_throw("could not write \"%s\"", temporary.generic_string());
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        index = 0;
+        for (const SectionData &section : sections) {
+            stream.seekp(std::streamoff(header.sections[index++].offset));
+            stream.write(static_cast<const char *>(section.data),
+                         std::streamsize(section.count * section.elementSize));
+        }
+        // pad the file, so that the last section does not need special care
+        stream.seekp(std::streamoff(offset - 1));
+        stream.put(0);
+        if (!stream) {
+            stream.close();
+            std::filesystem::remove(temporary);
+            lightwave_throw("could not write \"%s\"", temporary.generic_string());
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary);
+        lightwave_throw("could not write \"%s\": %s",
+                        path.generic_string(),
+                        error.message());
+    }
+}
+
+Reader::Reader(const std::filesystem::path &path)
+    : m_file(std::make_shared<MappedFile>(path)) {
+    m_header = reinterpret_cast<const Header *>(m_file->data());
+    if (m_file->size() < sizeof(Header) ||
+        std::memcmp(m_header->magic, Magic, sizeof(Magic)) != 0)
+        lightwave_throw("\"%s\" is not an lwmesh file", path.generic_string());
+    if (m_header->byteOrder != ByteOrder || m_header->version != Version)
+        lightwave_throw("\"%s\" was written by an incompatible version",
+                        path.generic_string());
+    if (m_header->sectionCount > MaxSections)
+        lightwave_throw("\"%s\" is corrupted", path.generic_string());
+    for (int index = 0; index < sectionCount(); index++) {
+        const Section &section = m_header->sections[index];
+        // (written so that corrupted values cannot overflow)
+        if (section.offset > m_file->size() || section.elementSize == 0 ||
+            section.count > (m_file->size() - section.offset) /
+                                section.elementSize)
+            lightwave_throw("\"%s\" is truncated or corrupted",
+                            path.generic_string());
+    }
+}
+
+} // namespace lightwave::lwmesh
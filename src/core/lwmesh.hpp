@@ -0,0 +1,110 @@
+/**
+ * @file lwmesh.hpp
+ * @brief Contains the native binary mesh format (.lwmesh), which stores the
+ * arrays of a mesh (including its BVH) in their in-memory layout, so that they
+ * can be memory-mapped and used without parsing or rebuilding anything.
+ */
+
+#pragma once
+
+#include <lightwave/core.hpp>
+
+#include "buffer.hpp"
+
+#include <span>
+#include <type_traits>
+
+namespace lightwave::lwmesh {
+
+/// @brief The version of the format, which is increased whenever the layout
+/// of the file or of any of the stored types changes.
+static constexpr uint32_t Version = 2;
+/// @brief The maximum number of arrays stored in a file.
+static constexpr int MaxSections = 8;
+/// @brief The alignment of arrays within the file.
+static constexpr size_t Alignment = 64;
+
+/// @brief The location of an array within the file.
+struct Section {
+    uint64_t offset;
+    uint64_t count;
+    uint64_t elementSize;
+};
+
+/// @brief The start of every file, followed by the arrays.
+struct Header {
+    char magic[8];
+    /// @brief Detects files written on machines of different endianness.
+    uint32_t byteOrder;
+    uint32_t version;
+    /// @brief A hash of the file the mesh was converted from (see @ref hash ),
+    /// which tells whether a cached file is outdated.
+    uint64_t sourceHash;
+    /// @brief The version of the loader that converted the file, which tells
+    /// whether a cached file was converted by code that has changed since.
+    uint32_t loaderVersion;
+    uint32_t reserved;
+    uint64_t sectionCount;
+    Section sections[MaxSections];
+};
+
+/// @brief An array that is to be written to a file.
+struct SectionData {
+    const void *data;
+    size_t count;
+    size_t elementSize;
+
+    template <typename T>
+    SectionData(std::span<const T> elements)
+        : data(elements.data()), count(elements.size()),
+          elementSize(sizeof(T)) {
+        static_assert(std::is_trivially_copyable_v<T>);
+    }
+};
+
+/// @brief Computes a hash of the contents of a file (not suitable for
+/// cryptographic purposes).
+uint64_t hash(const MappedFile &file);
+
+/**
+ * @brief Writes a file containing the given arrays. The file is written under
+ * a temporary name and then renamed, so that concurrent readers never see
+ * partially written files.
+ */
+void write(const std::filesystem::path &path, uint64_t sourceHash,
+           uint32_t loaderVersion, std::initializer_list<SectionData> sections);
+
+/// @brief Provides access to the arrays of a file, which refer to the mapped
+/// file instead of copying its contents.
+class Reader {
+    ref<const MappedFile> m_file;
+    const Header *m_header;
+
+public:
+    /// @brief Opens a file, throwing if it is not a valid .lwmesh file of the
+    /// current version.
+    Reader(const std::filesystem::path &path);
+
+    uint64_t sourceHash() const { return m_header->sourceHash; }
+    uint32_t loaderVersion() const { return m_header->loaderVersion; }
+    int sectionCount() const { return int(m_header->sectionCount); }
+
+    /// @brief Returns the array stored in the given section, throwing if it
+    /// does not consist of elements of type @c T .
+    template <typename T> Buffer<T> section(int index) const {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (index >= sectionCount())
+            lightwave_throw("lwmesh file lacks section %d", index);
+        const Section &section = m_header->sections[index];
+        if (section.elementSize != sizeof(T) ||
+            section.offset % alignof(T) != 0) {
+            lightwave_throw("lwmesh section %d has unexpected layout", index);
+        }
+        return Buffer<T>(
+            m_file,
+            reinterpret_cast<const T *>(m_file->data() + section.offset),
+            section.count);
+    }
+};
+
+} // namespace lightwave::lwmesh
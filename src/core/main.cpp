@@ -1,11 +1,15 @@
 #include <lightwave/core.hpp>
+#include <lightwave/dispatch.hpp>
 #include <lightwave/logger.hpp>
 #include <lightwave/registry.hpp>
 #include <catch_amalgamated.hpp>
 
+#include "../shapes/mesh.hpp"
 #include "parser.hpp"
 
 #include <fstream>
+#include <string_view>
+#include <vector>
 
 #ifdef LW_OS_WINDOWS
 #include <cstdlib>
@@ -28,6 +32,29 @@ int runUnitTests(int argc, const char *argv[]) {
     return Catch::Session().run( argc, argv );
 }
 
+/// @brief Converts a PLY file to an .lwmesh file (which is written next to it
+/// unless another path is given), so that loading it skips parsing and
+/// building the BVH.
+int convertMesh(int argc, const char *argv[]) {
+    if (argc < 3 || argc > 4) {
+        logger(EError, "usage: %s --convert <mesh.ply> [<mesh.lwmesh>]", argv[0]);
+        return 1;
+    }
+    const std::filesystem::path input  = argv[2];
+    const std::filesystem::path output =
+        argc > 3 ? std::filesystem::path(argv[3])
+                 : std::filesystem::path(input).replace_extension(".lwmesh");
+
+    Properties properties;
+    properties.set<std::string>("filename", input.string());
+    properties.set<bool>("cache", false);
+    const auto mesh = std::static_pointer_cast<TriangleMesh>(
+        Registry::create("shape", "mesh", properties));
+    mesh->save(output, lwmesh::hash(MappedFile(input)));
+    logger(EInfo, "converted %s to %s", input, output);
+    return 0;
+}
+
 int main(int argc, const char *argv[]) {
 #ifdef LW_DEBUG
     logger(EWarn, "lightwave was compiled in Debug mode, expect rendering to "
@@ -50,7 +77,26 @@ int main(int argc, const char *argv[]) {
     setvbuf(stdout, nullptr, _IOFBF, 1000);
 #endif
 
+    // --isa=<level> overrides the instruction set used by kernels, and is
+    // removed before the remaining arguments are interpreted
+    std::string isa;
+    std::vector<const char *> arguments;
+    for (int i = 0; i < argc; i++) {
+        const std::string_view argument = argv[i];
+        if (argument.starts_with("--isa="))
+            isa = argument.substr(6);
+        else
+            arguments.push_back(argv[i]);
+    }
+    argc = int(arguments.size());
+    argv = arguments.data();
+
     try {
+        dispatch::select(isa);
+
+        if (argc > 1 && std::string_view(argv[1]) == "--convert")
+            return convertMesh(argc, argv);
+
         if (argc <= 1 || *argv[1] == '-') {
             logger(EInfo, "running unit tests since no scene path was given");
             return runUnitTests(argc, argv);
@@ -178,7 +178,7 @@ BsdfSample Intersection::sampleBsdf(Sampler &rng) const {
         return BsdfSample::invalid();
     assert_normalized(wo, {});
     auto bsdfSample =
-        instance->bsdf()->sample(uv, shadingFrame().toLocal(wo), rng);
+        instance->bsdf()->sample(bsdfClosure(), shadingFrame().toLocal(wo), rng);
     if (bsdfSample.isInvalid())
         return bsdfSample;
     assert_normalized(bsdfSample.wi, {
@@ -195,8 +195,18 @@ BsdfEval Intersection::evaluateBsdf(const Vector &wi) const {
 
     if (!instance || !instance->bsdf())
         return BsdfEval::invalid();
-    return instance->bsdf()->evaluate(
-        uv, shadingFrame().toLocal(wo), shadingFrame().toLocal(wi));
+    return instance->bsdf()->evaluate(bsdfClosure(),
+                                      shadingFrame().toLocal(wo),
+                                      shadingFrame().toLocal(wi));
+}
+
+const BsdfClosure &Intersection::bsdfClosure() const {
+    if (!closure.prepared) {
+        closure.uv       = uv;
+        closure.prepared = true;
+        instance->bsdf()->prepare(closure);
+    }
+    return closure;
 }
 
 Light *Intersection::light() const {
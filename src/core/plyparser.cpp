@@ -1,8 +1,18 @@
 #include "plyparser.hpp"
+#include "buffer.hpp"
+#include <lightwave/iterators.hpp>
 #include <lightwave/logger.hpp>
+#include <lightwave/parallel.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <climits>
-#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <string_view>
 
 namespace lightwave {
 
@@ -37,6 +47,10 @@ struct Header {
     int VertexPropCount   = 0;
     int IndElem           = -1;
     int MatElem           = -1;
+    /// @brief The sizes in bytes of the vertex count and of each vertex index
+    /// of faces in binary files.
+    int CountSize         = 1;
+    int IndexSize         = 4;
     bool SwitchEndianness = false;
     bool IsAscii          = false;
 
@@ -53,135 +67,263 @@ struct Header {
     [[nodiscard]] inline bool hasMaterials() const { return MatElem >= 0; }
 };
 
-static void readPlyContent(std::istream &stream, const Header &header,
-                           std::vector<Vector3i> &indices,
-                           std::vector<Vertex> &vertices) {
-    const auto readFloat = [&]() {
-        float val = 0;
-        stream.read(reinterpret_cast<char *>(&val), sizeof(val));
-        if (header.SwitchEndianness)
-            val = swap_endian<float>(val);
-        return val;
-    };
-
-    const auto readIdx = [&]() {
-        uint32_t val = 0;
-        stream.read(reinterpret_cast<char *>(&val), sizeof(val));
-        if (header.SwitchEndianness)
-            val = swap_endian<uint32_t>(val);
-        return val;
-    };
-
-    vertices.reserve(header.VertexCount);
-    if (!header.hasNormals())
-        lightwave_throw("no normals found");
-
-    for (int i = 0; i < header.VertexCount; ++i) {
-        float x = 0, y = 0, z = 0;
-        float nx = 0, ny = 0, nz = 0;
-        float u = 0, v = 0;
-
-        if (header.IsAscii) {
-            std::string line;
-            if (!std::getline(stream, line))
-                lightwave_throw("not enough vertices given");
+/// @brief The number of vertices or faces that are decoded by each thread at a
+/// time.
+static constexpr int ChunkSize = 16384;
+/// @brief The maximum number of properties per vertex.
+static constexpr int MaxVertexProperties = 64;
+
+/// @brief Invokes @c f for chunks of @code [0, count) @endcode in parallel,
+/// unless a single chunk suffices (avoiding the cost of starting threads).
+template <typename Function> static void forEachChunk(int count, Function f) {
+    if (count <= ChunkSize)
+        f(Range(0, count));
+    else
+        for_each_parallel(ChunkedRange(count, ChunkSize), f);
+}
 
-            std::stringstream sstream(line);
-            int elem = 0;
-            while (sstream) {
-                float val = 0;
-                sstream >> val;
-
-                if (header.XElem == elem)
-                    x = val;
-                else if (header.YElem == elem)
-                    y = val;
-                else if (header.ZElem == elem)
-                    z = val;
-                else if (header.NXElem == elem)
-                    nx = val;
-                else if (header.NYElem == elem)
-                    ny = val;
-                else if (header.NZElem == elem)
-                    nz = val;
-                else if (header.UElem == elem)
-                    u = val;
-                else if (header.VElem == elem)
-                    v = val;
-
-                elem++;
-            }
-        } else {
-            for (int elem = 0; elem < header.VertexPropCount; ++elem) {
-                float val = readFloat();
-                if (header.XElem == elem)
-                    x = val;
-                else if (header.YElem == elem)
-                    y = val;
-                else if (header.ZElem == elem)
-                    z = val;
-                else if (header.NXElem == elem)
-                    nx = val;
-                else if (header.NYElem == elem)
-                    ny = val;
-                else if (header.NZElem == elem)
-                    nz = val;
-                else if (header.UElem == elem)
-                    u = val;
-                else if (header.VElem == elem)
-                    v = val;
-            }
-        }
+/**
+ * @brief Collects the first error that occurs on any thread, so that it can be
+ * thrown once all threads have finished (exceptions cannot leave threads).
+ */
+class ParseError {
+    std::atomic<bool> m_failed = false;
+    std::mutex m_mutex;
+    std::string m_message;
+
+public:
+    void report(const std::string &message) {
+        if (m_failed.exchange(true))
+            return;
+        std::lock_guard lock(m_mutex);
+        m_message = message;
+    }
 
-        Vertex vertex;
-        vertex.position = { x, y, z };
-        vertex.normal   = Vector(nx, ny, nz).normalized();
-        vertex.uv       = Vector2(u, v);
-        vertices.push_back(vertex);
+    void check() const {
+        if (m_failed)
+            lightwave_throw("%s", m_message);
     }
+};
 
-    if (vertices.empty())
-        lightwave_throw("no vertices found");
+static Vertex makeVertex(const Header &header, const float *values) {
+    Vertex vertex;
+    vertex.position = { values[header.XElem],
+                        values[header.YElem],
+                        values[header.ZElem] };
+    // normals that are missing or cannot be normalized are left zero, and are
+    // computed from the faces instead (see computeNormals)
+    vertex.normal = Vector(0);
+    if (header.hasNormals()) {
+        const Vector normal(values[header.NXElem],
+                            values[header.NYElem],
+                            values[header.NZElem]);
+        const float length = normal.length();
+        if (length > 0 && std::isfinite(length))
+            vertex.normal = normal / length;
+    }
+    vertex.uv = header.hasUVs()
+                    ? Vector2(values[header.UElem], values[header.VElem])
+                    : Vector2(0);
+    return vertex;
+}
 
-    indices.resize(header.FaceCount);
-    size_t indicesIndex = 0;
+/// @brief Decodes an integer of the given size (in bytes) from a binary file.
+static inline uint32_t readInteger(const char *data, int size, bool swap) {
+    switch (size) {
+    case 1:
+        return uint8_t(*data);
+    case 2: {
+        uint16_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return swap ? swap_endian(value) : value;
+    }
+    default: {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return swap ? swap_endian(value) : value;
+    }
+    }
+}
 
-    if (header.IsAscii) {
-        for (int i = 0; i < header.FaceCount; ++i) {
-            std::string line;
-            if (!std::getline(stream, line))
-                lightwave_throw("not enough indices given");
+static void readBinaryContent(std::string_view body, const Header &header,
+                              std::vector<Vector3i> &indices,
+                              std::vector<Vertex> &vertices) {
+    // all elements have fixed size, as only triangles are supported
+    const size_t vertexStride = size_t(header.VertexPropCount) * sizeof(float);
+    const size_t faceStride   = header.CountSize + 3 * header.IndexSize;
+    const size_t faceStart    = vertexStride * header.VertexCount;
+    if (body.size() < faceStart + faceStride * header.FaceCount)
+        lightwave_throw("file is truncated");
+
+    ParseError error;
+    forEachChunk(header.VertexCount, [&](Range chunk) {
+        float values[MaxVertexProperties];
+        for (int i : chunk) {
+            std::memcpy(values, body.data() + i * vertexStride, vertexStride);
+            if (header.SwitchEndianness) {
+                for (int elem = 0; elem < header.VertexPropCount; elem++)
+                    values[elem] = swap_endian(values[elem]);
+            }
+            vertices[i] = makeVertex(header, values);
+        }
+    });
+    forEachChunk(header.FaceCount, [&](Range chunk) {
+        for (int i : chunk) {
+            const char *face = body.data() + faceStart + i * faceStride;
+            if (readInteger(face, header.CountSize,
+                            header.SwitchEndianness) != 3) {
+                error.report("only triangles supported");
+                return;
+            }
+            for (int elem = 0; elem < 3; elem++) {
+                indices[i][elem] = int(readInteger(
+                    face + header.CountSize + elem * header.IndexSize,
+                    header.IndexSize,
+                    header.SwitchEndianness));
+            }
+        }
+    });
+    error.check();
+}
 
-            std::stringstream sstream(line);
+/// @brief Skips the spaces and tabs (and carriage returns of Windows line
+/// endings) in front of the next number of a line.
+static inline const char *skipSpaces(const char *begin, const char *end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r'))
+        begin++;
+    return begin;
+}
 
-            uint32_t elems = 0;
-            sstream >> elems;
-            if (elems != 3)
-                lightwave_throw("only triangles supported");
+/// @brief Parses the next number of a line, returning false if there is none.
+template <typename T>
+static inline bool parseNumber(const char *&begin, const char *end, T &value) {
+    begin = skipSpaces(begin, end);
+    if (begin < end && *begin == '+')
+        begin++; // not accepted by std::from_chars
+    const auto [next, status] = std::from_chars(begin, end, value);
+    if (status != std::errc())
+        return false;
+    begin = next;
+    return true;
+}
 
-            for (uint32_t elem = 0; elem < elems; ++elem) {
-                sstream >> indices[indicesIndex][elem];
+static void readAsciiContent(std::string_view body, const Header &header,
+                             std::vector<Vector3i> &indices,
+                             std::vector<Vertex> &vertices) {
+    // locating the lines is a fast linear scan, after which they are parsed
+    // in parallel
+    const size_t lineCount = size_t(header.VertexCount) + header.FaceCount;
+    std::vector<std::string_view> lines;
+    lines.reserve(lineCount);
+    const char *position = body.data();
+    const char *end      = body.data() + body.size();
+    while (position < end && lines.size() < lineCount) {
+        const char *newline = static_cast<const char *>(
+            std::memchr(position, '\n', end - position));
+        const char *lineEnd = newline ? newline : end;
+        if (skipSpaces(position, lineEnd) != lineEnd)
+            lines.emplace_back(position, lineEnd - position);
+        position = newline ? newline + 1 : end;
+    }
+    if (lines.size() < size_t(header.VertexCount))
+        lightwave_throw("not enough vertices given");
+    if (lines.size() < lineCount)
+        lightwave_throw("too few faces (%d found, %d needed)",
+                        lines.size() - header.VertexCount,
+                        header.FaceCount);
+
+    ParseError error;
+    forEachChunk(header.VertexCount, [&](Range chunk) {
+        float values[MaxVertexProperties];
+        for (int i : chunk) {
+            const char *begin = lines[i].data();
+            const char *end   = begin + lines[i].size();
+            for (int elem = 0; elem < header.VertexPropCount; elem++) {
+                if (!parseNumber(begin, end, values[elem])) {
+                    error.report(tfm::format("invalid vertex %d", i));
+                    return;
+                }
             }
-            indicesIndex++;
+            vertices[i] = makeVertex(header, values);
         }
-    } else {
-        for (int i = 0; i < header.FaceCount; ++i) {
-            uint8_t elems = 0;
-            stream.read(reinterpret_cast<char *>(&elems), sizeof(elems));
-            if (elems != 3)
-                lightwave_throw("only triangles supported");
-
-            for (uint32_t elem = 0; elem < elems; ++elem) {
-                indices[indicesIndex][elem] = readIdx();
+    });
+    forEachChunk(header.FaceCount, [&](Range chunk) {
+        for (int i : chunk) {
+            const std::string_view line = lines[header.VertexCount + i];
+            const char *begin           = line.data();
+            const char *end             = begin + line.size();
+            int count                   = 0;
+            if (!parseNumber(begin, end, count) || count != 3) {
+                error.report("only triangles supported");
+                return;
+            }
+            for (int elem = 0; elem < 3; elem++) {
+                if (!parseNumber(begin, end, indices[i][elem])) {
+                    error.report(tfm::format("invalid face %d", i));
+                    return;
+                }
             }
-            indicesIndex++;
         }
+    });
+    error.check();
+}
+
+/// @brief Computes the normals of vertices that lack them (i.e., whose
+/// normals are zero), by averaging the normals of the adjacent triangles
+/// weighted by their area.
+static void computeNormals(const std::vector<Vector3i> &indices,
+                           std::vector<Vertex> &vertices) {
+    std::vector<Vector> sums(vertices.size(), Vector(0));
+    for (const Vector3i &triangle : indices) {
+        const Point &a = vertices[triangle[0]].position;
+        const Vector normal = (vertices[triangle[1]].position - a)
+                                  .cross(vertices[triangle[2]].position - a);
+        for (int i = 0; i < 3; i++)
+            sums[triangle[i]] += normal;
     }
+    forEachChunk(int(vertices.size()), [&](Range chunk) {
+        for (int i : chunk) {
+            if (vertices[i].normal.lengthSquared() > 0)
+                continue;
+            const float length = sums[i].length();
+            vertices[i].normal =
+                length > 0 ? sums[i] / length : Vector(0, 0, 1);
+        }
+    });
+}
 
-    if (indicesIndex != indices.size())
-        lightwave_throw("too few faces (%d found, %d needed)",
-                        indicesIndex,
-                        indices.size());
+static void readPlyContent(std::string_view body, const Header &header,
+                           std::vector<Vector3i> &indices,
+                           std::vector<Vertex> &vertices) {
+    if (header.VertexPropCount > MaxVertexProperties)
+        lightwave_throw("too many vertex properties");
+    vertices.resize(header.VertexCount);
+    indices.resize(header.FaceCount);
+    if (header.IsAscii)
+        readAsciiContent(body, header, indices, vertices);
+    else
+        readBinaryContent(body, header, indices, vertices);
+
+    for (const Vector3i &triangle : indices) {
+        for (int i = 0; i < 3; i++) {
+            if (triangle[i] < 0 || triangle[i] >= header.VertexCount)
+                lightwave_throw("vertex index %d out of range", triangle[i]);
+        }
+    }
+
+    if (!header.hasNormals()) {
+        logger(EInfo, "computing missing normals");
+        computeNormals(indices, vertices);
+    } else {
+        const auto degenerate =
+            std::count_if(vertices.begin(), vertices.end(), [](const Vertex &v) {
+                return !(v.normal.lengthSquared() > 0);
+            });
+        if (degenerate > 0) {
+            logger(EWarn, "computing %d degenerate normals", degenerate);
+            computeNormals(indices, vertices);
+        }
+    }
 
     if (!header.hasUVs()) {
         Bounds bbox;
@@ -204,22 +346,44 @@ static void readPlyContent(std::istream &stream, const Header &header,
 }
 
 static inline bool isAllowedVertIndType(const std::string &str) {
-    return str == "uchar" || str == "int" || str == "uint8_t" || str == "uint";
+    return str == "uchar" || str == "uint8" || str == "uint8_t" ||
+           str == "ushort" || str == "uint16" || str == "int" ||
+           str == "uint" || str == "uint32";
+}
+
+/// @brief The size in bytes of an integer type in binary files.
+static int integerSize(const std::string &type) {
+    if (type == "uchar" || type == "char" || type == "uint8" ||
+        type == "int8" || type == "uint8_t")
+        return 1;
+    if (type == "ushort" || type == "short" || type == "uint16" ||
+        type == "int16")
+        return 2;
+    if (type == "uint" || type == "int" || type == "uint32" || type == "int32")
+        return 4;
+    lightwave_throw("unsupported integer type '%s'", type);
 }
 
 void readPLY(const std::filesystem::path &path, std::vector<Vector3i> &indices,
              std::vector<Vertex> &vertices) {
     logger(EInfo, "loading mesh %s", path);
     try {
-        std::ifstream stream(path, std::ios::in | std::ios::binary);
-        if (!stream)
-            lightwave_throw("error opening file");
+        // the whole file is mapped, so that the content can be decoded
+        // without copying it into stream buffers first
+        const MappedFile file(path);
+        const std::string_view contents(
+            reinterpret_cast<const char *>(file.data()), file.size());
 
         // Header
+        const size_t headerEnd = contents.find("end_header");
+        const size_t bodyStart = contents.find('\n', headerEnd);
+        if (!contents.starts_with("ply") || headerEnd == contents.npos ||
+            bodyStart == contents.npos)
+            lightwave_throw("file is not in PLY format");
+        std::istringstream stream(std::string(contents.substr(0, headerEnd)));
+
         std::string magic;
         stream >> magic;
-        if (magic != "ply")
-            lightwave_throw("file is not in PLY format");
 
         std::string method;
         Header header;
@@ -276,28 +440,33 @@ void readPLY(const std::filesystem::path &path, std::vector<Vector3i> &indices,
                     std::string name;
                     sstream >> name;
                     if (!isAllowedVertIndType(countType)) {
-                        lightwave_throw(
-                            "only 'property list uchar int' is supported");
+                        lightwave_throw("unsupported list count type '%s'",
+                                        countType);
                         continue;
                     }
 
-                    if (name == "vertex_indices" || name == "vertex_index")
-                        header.IndElem = facePropCounter - 1;
+                    if (name == "vertex_indices" || name == "vertex_index") {
+                        header.IndElem   = facePropCounter - 1;
+                        header.CountSize = integerSize(countType);
+                        header.IndexSize = integerSize(indType);
+                    }
                 } else {
                     lightwave_throw("only float or list properties allowed");
                 }
-            } else if (action == "end_header")
-                break;
+            }
         }
 
         // Content
         if (!header.hasVertices() || !header.hasIndices() ||
             header.VertexCount <= 0 || header.FaceCount <= 0)
             lightwave_throw("does not contain valid mesh data");
+        if (facePropCounter != 1)
+            lightwave_throw("faces may only contain vertex indices");
 
         header.SwitchEndianness = (method == "binary_big_endian");
         header.IsAscii          = (method == "ascii");
-        readPlyContent(stream, header, indices, vertices);
+        readPlyContent(contents.substr(bodyStart + 1), header, indices,
+                       vertices);
     } catch (...) {
         lightwave_throw_nested("while parsing %s", path);
     }
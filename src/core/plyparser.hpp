@@ -6,6 +6,10 @@
 
 namespace lightwave {
 
+/// @brief The version of @ref readPLY , which is increased whenever it decodes
+/// files differently, so that meshes cached from PLY files are converted anew.
+static constexpr uint32_t PlyLoaderVersion = 2;
+
 void readPLY(const std::filesystem::path &path, std::vector<Vector3i> &indices,
              std::vector<Vertex> &vertices);
 
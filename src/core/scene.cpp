@@ -90,10 +90,41 @@ Scene::Scene(const Properties &properties) {
     m_background = properties.getOptionalChild<BackgroundLight>();
     m_lightSampling = std::make_shared<LightSampling>(properties.getChildren<Light>());
 
-    const std::vector<ref<Shape>> entities = properties.getChildren<Shape>();
-    if (entities.size() == 1) {
-        m_shape = entities[0];
+    m_entities = properties.getChildren<Shape>();
+
+    // choose the level of detail of each instance such that its error stays
+    // below the given number of pixels (only for top-level instances)
+    const float lodError = properties.get<float>("lodError", 1);
+    const float errorPerDistance = lodError * m_camera->pixelAngle();
+    if (errorPerDistance > 0) {
+        const Point eye = m_camera->position();
+        // the shapes that were replaced by coarser versions, which are kept
+        // alive until the levels that no instance selected have been released
+        std::vector<ref<Shape>> replaced;
+        std::vector<Instance *> instances;
+        for (const auto &entity : m_entities) {
+            if (const auto instance = std::dynamic_pointer_cast<Instance>(entity)) {
+                if (auto original = instance->selectDetail(eye, errorPerDistance))
+                    replaced.push_back(std::move(original));
+                instances.push_back(instance.get());
+            }
+        }
+        for (const auto &shape : replaced)
+            shape->releaseUnusedDetail();
+        for (Instance *instance : instances)
+            instance->shape()->releaseUnusedDetail();
+        const size_t simplified = replaced.size();
+        if (simplified > 0) {
+            logger(EInfo, "using coarser levels of detail for %d of %d shapes",
+                   simplified, m_entities.size());
+        }
+    }
+
+    if (m_entities.size() == 1) {
+        m_shape = m_entities[0];
     } else {
+        // the group also picks up options from the scene's properties (e.g.,
+        // "flatten" to merge small meshes into a single BVH)
         m_shape = std::static_pointer_cast<Shape>(
             Registry::create("shape", "group", properties));
     }
@@ -114,11 +145,15 @@ Intersection Scene::intersect(const Ray &ray, Sampler &rng) const {
 
     Intersection its(-ray.direction);
     m_shape->intersect(ray, its, rng);
+    completeIntersection(its);
+    return its;
+}
+
+void Scene::completeIntersection(Intersection &its) const {
     if (!its) {
         its.background = m_background.get();
     }
     its.lightProbability = m_lightSampling->probability(its.light());
-    return its;
 }
 
 bool Scene::intersect(const Ray &ray, float tMax, Sampler &rng) const {
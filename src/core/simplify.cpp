@@ -0,0 +1,434 @@
+#include "simplify.hpp"
+
+#include <array>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+namespace lightwave {
+
+namespace {
+
+/// @brief A symmetric 4x4 matrix that measures the (weighted) sum of squared
+/// distances of a point to a set of planes.
+struct Quadric {
+    /// @brief The upper triangle of the matrix, row by row.
+    std::array<double, 10> q {};
+
+    static Quadric plane(const Vector &normal, float offset, double weight) {
+        const double a = normal.x(), b = normal.y(), c = normal.z(),
+                     d = offset;
+        Quadric result;
+        result.q = { a * a, a * b, a * c, a * d, b * b,
+                     b * c, b * d, c * c, c * d, d * d };
+        for (double &value : result.q)
+            value *= weight;
+        return result;
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        for (size_t i = 0; i < q.size(); i++)
+            q[i] += other.q[i];
+        return *this;
+    }
+
+    double evaluate(const Point &p) const {
+        const double x = p.x(), y = p.y(), z = p.z();
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z +
+               2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+               q[7] * z * z + 2 * q[8] * z + q[9];
+    }
+
+    /// @brief Finds the point with the smallest error, returning false if it
+    /// is not unique (e.g., for flat regions).
+    bool minimize(Point &p) const {
+        // solve A p = -b by Cramer's rule
+        const double a00 = q[0], a01 = q[1], a02 = q[2], a11 = q[4],
+                     a12 = q[5], a22 = q[7];
+        const double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+        const double c00 = a11 * a22 - a12 * a12;
+        const double c01 = a02 * a12 - a01 * a22;
+        const double c02 = a01 * a12 - a02 * a11;
+        const double det = a00 * c00 + a01 * c01 + a02 * c02;
+        const double trace = a00 + a11 + a22;
+        if (!(std::abs(det) > 1e-9 * trace * trace * trace))
+            return false;
+        const double c11 = a00 * a22 - a02 * a02;
+        const double c12 = a01 * a02 - a00 * a12;
+        const double c22 = a00 * a11 - a01 * a01;
+        p = Point(float((c00 * b0 + c01 * b1 + c02 * b2) / det),
+                  float((c01 * b0 + c11 * b1 + c12 * b2) / det),
+                  float((c02 * b0 + c12 * b1 + c22 * b2) / det));
+        return true;
+    }
+};
+
+/// @brief An edge collapse that moves vertex @c to to @c target and removes
+/// vertex @c from .
+struct Collapse {
+    double cost;
+    int from, to;
+    /// @brief The versions of both vertices when the collapse was computed,
+    /// which tell whether it is outdated.
+    int fromVersion, toVersion;
+    Point target;
+    /// @brief The relative position of the target along the edge (0 at @c to
+    /// , 1 at @c from ), used to interpolate vertex attributes.
+    float blend;
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+/// @brief The smallest cosine between the normals of a triangle before and
+/// after a collapse, which rejects collapses that fold triangles over.
+constexpr float MinNormalCosine = 0.2f;
+
+/**
+ * @brief Simplifies meshes on their positions only: vertices that share their
+ * position (e.g., at texture seams or in flat shaded meshes) are welded, and
+ * each corner of a face refers to a position as well as to the vertex that
+ * provides its attributes.
+ */
+class Simplifier {
+    std::vector<Point> m_positions;
+    /// @brief The attributes of the vertices (their positions are unused).
+    std::vector<Vertex> m_attributes;
+    /// @brief The positions of the corners of each face.
+    std::vector<std::array<int, 3>> m_faces;
+    /// @brief The attributes of the corners of each face.
+    std::vector<std::array<int, 3>> m_corners;
+    std::vector<bool> m_faceAlive;
+    int m_aliveFaces;
+    /// @brief The faces around each position (may include faces that have
+    /// been removed since).
+    std::vector<std::vector<int>> m_vertexFaces;
+    std::vector<Quadric> m_quadrics;
+    std::vector<int> m_versions;
+    /// @brief Positions that must not move, as they lie on the boundary of
+    /// the mesh (see @ref simplifyMesh ).
+    std::vector<bool> m_locked;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>>
+        m_queue;
+    double m_maxCost = 0;
+
+    Vector faceNormal(const std::array<int, 3> &face, int moved,
+                      const Point &target) const {
+        Point p[3];
+        for (int i = 0; i < 3; i++) {
+            p[i] = face[i] == moved ? target : m_positions[face[i]];
+        }
+        return (p[1] - p[0]).cross(p[2] - p[0]);
+    }
+
+    std::vector<int> neighbors(int vertex) const {
+        std::vector<int> result;
+        for (int face : m_vertexFaces[vertex]) {
+            if (!m_faceAlive[face])
+                continue;
+            for (int other : m_faces[face]) {
+                if (other != vertex)
+                    result.push_back(other);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    void addCollapse(int a, int b) {
+        if (m_locked[a] && m_locked[b])
+            return;
+        if (m_locked[a])
+            std::swap(a, b);
+        // vertex a is free to move, and gets removed
+        Collapse collapse { .cost        = 0,
+                            .from        = a,
+                            .to          = b,
+                            .fromVersion = m_versions[a],
+                            .toVersion   = m_versions[b],
+                            .target      = m_positions[b],
+                            .blend       = 0 };
+
+        Quadric quadric = m_quadrics[a];
+        quadric += m_quadrics[b];
+        const Point pa = m_positions[a];
+        const Point pb = m_positions[b];
+        const Vector edge = pa - pb;
+        const float edgeLength2 = edge.lengthSquared();
+        collapse.cost = quadric.evaluate(pb);
+        if (!m_locked[b]) {
+            // try the optimal position, unless it lies far from the edge
+            Point optimal;
+            if (quadric.minimize(optimal) &&
+                (optimal - (pb + edge / 2)).lengthSquared() < edgeLength2) {
+                collapse.target = optimal;
+                collapse.cost   = quadric.evaluate(optimal);
+            } else {
+                for (float blend : { 0.5f, 1.f }) {
+                    const Point candidate = pb + blend * edge;
+                    const double cost     = quadric.evaluate(candidate);
+                    if (cost < collapse.cost) {
+                        collapse.target = candidate;
+                        collapse.cost   = cost;
+                    }
+                }
+            }
+            if (edgeLength2 > 0) {
+                collapse.blend = std::clamp(
+                    (collapse.target - pb).dot(edge) / edgeLength2, 0.f, 1.f);
+            }
+        }
+        collapse.cost = std::max(collapse.cost, 0.0);
+        m_queue.push(collapse);
+    }
+
+    bool isValid(const Collapse &collapse) const {
+        const int from = collapse.from, to = collapse.to;
+        // the link condition ensures that the mesh stays manifold: the only
+        // vertices adjacent to both are the ones opposite of the edge
+        const std::vector<int> fromNeighbors = neighbors(from);
+        const std::vector<int> toNeighbors   = neighbors(to);
+        std::vector<int> common;
+        std::set_intersection(fromNeighbors.begin(), fromNeighbors.end(),
+                              toNeighbors.begin(), toNeighbors.end(),
+                              std::back_inserter(common));
+        int shared = 0;
+        for (int face : m_vertexFaces[from]) {
+            if (!m_faceAlive[face])
+                continue;
+            const auto &vertices = m_faces[face];
+            if (std::find(vertices.begin(), vertices.end(), to) !=
+                vertices.end())
+                shared++;
+        }
+        if (shared == 0 || int(common.size()) != shared)
+            return false;
+
+        // no face may fold over
+        for (int vertex : { from, to }) {
+            for (int face : m_vertexFaces[vertex]) {
+                if (!m_faceAlive[face])
+                    continue;
+                const auto &vertices = m_faces[face];
+                if (std::find(vertices.begin(), vertices.end(),
+                              vertex == from ? to : from) != vertices.end())
+                    continue; // removed by the collapse
+                const Vector before =
+                    faceNormal(vertices, -1, collapse.target);
+                const Vector after =
+                    faceNormal(vertices, vertex, collapse.target);
+                const float lengths =
+                    std::sqrt(before.lengthSquared() * after.lengthSquared());
+                if (!(after.dot(before) > MinNormalCosine * lengths))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void apply(const Collapse &collapse) {
+        const int from = collapse.from, to = collapse.to;
+        m_positions[to] = collapse.target;
+
+        // the faces that are removed tell which attributes at the removed
+        // position continue (along the edge) in which attributes at the
+        // remaining one, and those are blended
+        std::vector<std::pair<int, int>> continued;
+        for (int face : m_vertexFaces[from]) {
+            if (!m_faceAlive[face])
+                continue;
+            const auto &vertices = m_faces[face];
+            const auto it = std::find(vertices.begin(), vertices.end(), to);
+            if (it == vertices.end())
+                continue;
+            const int fromAttributes =
+                m_corners[face][std::find(vertices.begin(), vertices.end(),
+                                          from) -
+                                vertices.begin()];
+            const int toAttributes = m_corners[face][it - vertices.begin()];
+            const bool known = std::any_of(
+                continued.begin(), continued.end(), [&](const auto &pair) {
+                    return pair.first == fromAttributes ||
+                           pair.second == toAttributes;
+                });
+            if (!known)
+                continued.emplace_back(fromAttributes, toAttributes);
+            m_faceAlive[face] = false;
+            m_aliveFaces--;
+        }
+        for (const auto &[fromAttributes, toAttributes] : continued) {
+            Vertex &vertex     = m_attributes[toAttributes];
+            const Vertex &gone = m_attributes[fromAttributes];
+            vertex.uv = (1 - collapse.blend) * vertex.uv + collapse.blend * gone.uv;
+            vertex.normal = (1 - collapse.blend) * vertex.normal +
+                            collapse.blend * gone.normal;
+            if (vertex.normal.lengthSquared() > 0)
+                vertex.normal = vertex.normal.normalized();
+        }
+
+        // the remaining faces around the removed position move to the other
+        // one, and keep their attributes unless they continue along the edge
+        for (int face : m_vertexFaces[from]) {
+            if (!m_faceAlive[face])
+                continue;
+            for (int i = 0; i < 3; i++) {
+                if (m_faces[face][i] != from)
+                    continue;
+                m_faces[face][i] = to;
+                for (const auto &[fromAttributes, toAttributes] : continued) {
+                    if (m_corners[face][i] == fromAttributes)
+                        m_corners[face][i] = toAttributes;
+                }
+            }
+            m_vertexFaces[to].push_back(face);
+        }
+        m_vertexFaces[from].clear();
+        m_quadrics[to] += m_quadrics[from];
+        m_versions[from]++;
+        m_versions[to]++;
+        m_maxCost = std::max(m_maxCost, collapse.cost);
+
+        for (int neighbor : neighbors(to))
+            addCollapse(to, neighbor);
+    }
+
+    SimplifiedMesh snapshot() const {
+        SimplifiedMesh result;
+        result.error = float(std::sqrt(m_maxCost));
+        // each pair of position and attributes becomes a vertex
+        std::unordered_map<uint64_t, int> remap;
+        for (size_t face = 0; face < m_faces.size(); face++) {
+            if (!m_faceAlive[face])
+                continue;
+            Vector3i triangle;
+            for (int i = 0; i < 3; i++) {
+                const int position   = m_faces[face][i];
+                const int attributes = m_corners[face][i];
+                const auto [it, inserted] = remap.emplace(
+                    (uint64_t(position) << 32) | uint32_t(attributes),
+                    int(result.vertices.size()));
+                if (inserted) {
+                    Vertex vertex   = m_attributes[attributes];
+                    vertex.position = m_positions[position];
+                    result.vertices.push_back(vertex);
+                }
+                triangle[i] = it->second;
+            }
+            result.indices.push_back(triangle);
+        }
+        return result;
+    }
+
+public:
+    Simplifier(std::span<const Vector3i> indices,
+               std::span<const Vertex> vertices)
+        : m_attributes(vertices.begin(), vertices.end()),
+          m_faces(indices.size()), m_corners(indices.size()),
+          m_faceAlive(indices.size(), true), m_aliveFaces(int(indices.size())) {
+        // weld vertices that share their position
+        struct PositionHash {
+            size_t operator()(const Point &p) const {
+                uint32_t bits[3];
+                std::memcpy(bits, &p, sizeof(bits));
+                return (size_t(bits[0]) * 73856093) ^
+                       (size_t(bits[1]) * 19349663) ^
+                       (size_t(bits[2]) * 83492791);
+            }
+        };
+        std::unordered_map<Point, int, PositionHash> welded;
+        std::vector<int> positionOf(vertices.size());
+        for (size_t vertex = 0; vertex < vertices.size(); vertex++) {
+            const auto [it, inserted] = welded.emplace(
+                vertices[vertex].position, int(m_positions.size()));
+            if (inserted)
+                m_positions.push_back(vertices[vertex].position);
+            positionOf[vertex] = it->second;
+        }
+        m_vertexFaces.resize(m_positions.size());
+        m_quadrics.resize(m_positions.size());
+        m_versions.resize(m_positions.size(), 0);
+        m_locked.resize(m_positions.size(), false);
+
+        // every vertex measures the distance to the planes of its faces
+        std::unordered_map<uint64_t, int> edgeFaces;
+        const auto edgeKey = [](int a, int b) {
+            return (uint64_t(std::min(a, b)) << 32) | uint32_t(std::max(a, b));
+        };
+        for (size_t face = 0; face < indices.size(); face++) {
+            for (int i = 0; i < 3; i++) {
+                m_corners[face][i] = indices[face][i];
+                m_faces[face][i]   = positionOf[indices[face][i]];
+            }
+            for (int i = 0; i < 3; i++) {
+                m_vertexFaces[m_faces[face][i]].push_back(int(face));
+                edgeFaces[edgeKey(m_faces[face][i],
+                                  m_faces[face][(i + 1) % 3])]++;
+            }
+
+            const Vector normal = faceNormal(m_faces[face], -1, Point());
+            if (!(normal.lengthSquared() > 0))
+                continue;
+            const Vector n = normal.normalized();
+            const Quadric quadric =
+                Quadric::plane(n, -n.dot(Vector(m_positions[m_faces[face][0]])), 1);
+            for (int i = 0; i < 3; i++)
+                m_quadrics[m_faces[face][i]] += quadric;
+        }
+
+        // edges that are not shared by exactly two faces lie on the boundary
+        // (or are non-manifold), and keep their vertices in place so that the
+        // outline of the mesh does not shrink
+        for (const auto &[key, faces] : edgeFaces) {
+            if (faces != 2) {
+                m_locked[key >> 32]        = true;
+                m_locked[key & 0xffffffff] = true;
+            }
+        }
+        for (const auto &[key, faces] : edgeFaces)
+            addCollapse(int(key >> 32), int(key & 0xffffffff));
+    }
+    /// @brief Collapses edges until at most the given number of triangles
+    /// remains, returning false if no further collapses are possible.
+    bool simplify(int triangleCount) {
+        while (m_aliveFaces > triangleCount) {
+            if (m_queue.empty())
+                return false;
+            const Collapse collapse = m_queue.top();
+            m_queue.pop();
+            if (collapse.fromVersion != m_versions[collapse.from] ||
+                collapse.toVersion != m_versions[collapse.to])
+                continue; // outdated
+            if (!isValid(collapse))
+                continue;
+            apply(collapse);
+        }
+        return true;
+    }
+
+    int aliveFaces() const { return m_aliveFaces; }
+
+    SimplifiedMesh result() const { return snapshot(); }
+};
+
+} // namespace
+
+std::vector<SimplifiedMesh>
+simplifyMesh(std::span<const Vector3i> indices,
+             std::span<const Vertex> vertices,
+             const std::vector<int> &triangleCounts) {
+    std::vector<SimplifiedMesh> levels;
+    Simplifier simplifier(indices, vertices);
+    int previousCount = int(indices.size());
+    for (int triangleCount : triangleCounts) {
+        const bool reached = simplifier.simplify(triangleCount);
+        if (simplifier.aliveFaces() < previousCount) {
+            previousCount = simplifier.aliveFaces();
+            levels.push_back(simplifier.result());
+        }
+        if (!reached)
+            break;
+    }
+    return levels;
+}
+
+} // namespace lightwave
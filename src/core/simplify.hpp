@@ -0,0 +1,33 @@
+#pragma once
+
+#include <lightwave/math.hpp>
+
+#include <span>
+#include <vector>
+
+namespace lightwave {
+
+/// @brief A simplified version of a triangle mesh.
+struct SimplifiedMesh {
+    std::vector<Vector3i> indices;
+    std::vector<Vertex> vertices;
+    /// @brief An estimate of the largest distance between the simplified and
+    /// the original surface.
+    float error;
+};
+
+/**
+ * @brief Simplifies a triangle mesh by quadric edge collapses (see "Surface
+ * Simplification Using Quadric Error Metrics" by Garland and Heckbert
+ * [1997]), returning one level for each of the given triangle counts (which
+ * must be decreasing). Levels that cannot be simplified further are omitted.
+ * @note Vertices that share their position (e.g., at texture seams or in flat
+ * shaded meshes) are welded, so that the mesh does not crack open, while
+ * vertices on boundary edges keep their position.
+ */
+std::vector<SimplifiedMesh>
+simplifyMesh(std::span<const Vector3i> indices,
+             std::span<const Vertex> vertices,
+             const std::vector<int> &triangleCounts);
+
+} // namespace lightwave
@@ -0,0 +1,163 @@
+/**
+ * @file vertexcompression.hpp
+ * @brief Contains compact encodings of vertex attributes, which trade a small
+ * loss of precision for meshes that need much less memory (see @ref
+ * TriangleMesh ).
+ */
+
+#pragma once
+
+#include <lightwave/math.hpp>
+
+#include <array>
+#include <cstring>
+
+namespace lightwave {
+
+/// @brief Converts a float to half precision (rounding to nearest even, and
+/// flushing values too small for half precision to zero).
+inline uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign     = (bits >> 16) & 0x8000;
+    const uint32_t absolute = bits & 0x7fffffff;
+    if (absolute >= 0x7f800000) // infinity or NaN
+        return uint16_t(sign | 0x7c00 | (absolute > 0x7f800000 ? 0x200 : 0));
+    if (absolute >= 0x477ff000) // overflows to infinity after rounding
+        return uint16_t(sign | 0x7c00);
+    if (absolute < 0x33000001) // underflows to zero
+        return uint16_t(sign);
+
+    int exponent      = int(absolute >> 23) - 127 + 15;
+    uint32_t mantissa = (absolute & 0x7fffff) | 0x800000;
+    // subnormal halfs shift the mantissa further
+    const int shift = exponent > 0 ? 13 : 14 - exponent;
+    exponent        = std::max(exponent, 0);
+    const uint32_t dropped  = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway  = 1u << (shift - 1);
+    uint32_t result         = mantissa >> shift;
+    if (dropped > halfway || (dropped == halfway && (result & 1)))
+        result++;
+    // (a mantissa that overflows on rounding correctly carries into the
+    // exponent)
+    result = exponent > 0 ? (uint32_t(exponent) << 10) + (result - 0x400)
+                          : result;
+    return uint16_t(sign | result);
+}
+
+/// @brief Converts a half precision value to float.
+inline float halfToFloat(uint16_t half) {
+    const uint32_t sign = uint32_t(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent == 0) {
+        // subnormal (or zero), which is exactly representable as float
+        const float value = float(mantissa) * 0x1p-24f;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bits |= sign;
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/**
+ * @brief Encodes a unit vector in 32 bits by projecting it onto an octahedron,
+ * which is unfolded into a square (see "A Survey of Efficient Representations
+ * for Independent Unit Vectors" by Cigolle et al. [2014]). The maximum angular
+ * error is about 0.00005 radians.
+ */
+inline uint32_t encodeOctahedral(const Vector &n) {
+    const float norm = abs(n.x()) + abs(n.y()) + abs(n.z());
+    if (!(norm > 0))
+        return encodeOctahedral(Vector(0, 0, 1));
+    float x = n.x() / norm, y = n.y() / norm;
+    if (n.z() < 0) {
+        // the lower half of the octahedron is folded over the diagonals
+        const float foldedX = (1 - abs(y)) * copysign(1.f, x);
+        const float foldedY = (1 - abs(x)) * copysign(1.f, y);
+        x                   = foldedX;
+        y                   = foldedY;
+    }
+    const auto quantize = [](float value) {
+        return uint32_t(std::lround((clamp(value, -1.f, 1.f) * 0.5f + 0.5f) *
+                                    65535));
+    };
+    return quantize(x) | (quantize(y) << 16);
+}
+
+/// @brief Decodes a unit vector encoded by @ref encodeOctahedral .
+inline Vector decodeOctahedral(uint32_t encoded) {
+    const float x = float(encoded & 0xffff) * (2.f / 65535) - 1;
+    const float y = float(encoded >> 16) * (2.f / 65535) - 1;
+    Vector n(x, y, 1 - abs(x) - abs(y));
+    if (n.z() < 0) {
+        const float t = -n.z();
+        n.x() += n.x() >= 0 ? -t : t;
+        n.y() += n.y() >= 0 ? -t : t;
+    }
+    return n.normalized();
+}
+
+/// @brief The attributes of a vertex that are only needed once a hit has been
+/// found, encoded in 8 bytes instead of 20.
+struct CompressedAttributes {
+    /// @brief The normal, see @ref encodeOctahedral .
+    uint32_t normal;
+    /// @brief The texture coordinates in half precision.
+    std::array<uint16_t, 2> uv;
+
+    static CompressedAttributes encode(const Vertex &vertex) {
+        return { .normal = encodeOctahedral(vertex.normal),
+                 .uv     = { floatToHalf(vertex.uv.x()),
+                             floatToHalf(vertex.uv.y()) } };
+    }
+
+    Vector2 decodeUV() const {
+        return { halfToFloat(uv[0]), halfToFloat(uv[1]) };
+    }
+};
+
+/**
+ * @brief Quantizes positions to 16 bits per axis within a bounding box, so
+ * that each position takes 6 bytes instead of 12. Vertices move by up to half
+ * a quantization step (see @ref maxError ), which is the same for all
+ * triangles sharing a vertex, so that meshes remain watertight.
+ */
+class PositionQuantization {
+    Point m_origin;
+    Vector m_step;
+
+public:
+    PositionQuantization() = default;
+    explicit PositionQuantization(const Bounds &bounds)
+        : m_origin(bounds.min()), m_step(bounds.diagonal() / 65535) {}
+
+    std::array<uint16_t, 3> encode(const Point &p) const {
+        std::array<uint16_t, 3> result;
+        for (int dim = 0; dim < 3; dim++) {
+            result[dim] =
+                m_step[dim] > 0
+                    ? uint16_t(std::lround(clamp(
+                          (p[dim] - m_origin[dim]) / m_step[dim], 0.f, 65535.f)))
+                    : 0;
+        }
+        return result;
+    }
+
+    Point decode(const std::array<uint16_t, 3> &q) const {
+        return { m_origin.x() + float(q[0]) * m_step.x(),
+                 m_origin.y() + float(q[1]) * m_step.y(),
+                 m_origin.z() + float(q[2]) * m_step.z() };
+    }
+
+    /// @brief The largest distance (per axis) that positions move.
+    Vector maxError() const { return m_step / 2; }
+};
+
+} // namespace lightwave
@@ -0,0 +1,288 @@
+#include "visibility.hpp"
+
+#include <lightwave/camera.hpp>
+#include <lightwave/parallel.hpp>
+#include <lightwave/registry.hpp>
+#include <lightwave/sampler.hpp>
+#include <lightwave/scene.hpp>
+#include <lightwave/profiler.hpp>
+
+#include "../shapes/mesh.hpp"
+
+#include <unordered_set>
+
+namespace lightwave {
+
+namespace {
+
+/// @brief Triangles are clipped at this depth in front of the camera, so that
+/// their vertices can be projected.
+constexpr float NearPlane = Epsilon;
+
+} // namespace
+
+VisibilityBuffer::VisibilityBuffer(const Scene &scene,
+                                   const Vector2i &blockSize)
+    : m_scene(&scene) {
+    Timer timer;
+    const Camera &camera = *scene.camera();
+    Vector2 extent;
+    if (!camera.rasterizationExtent(extent))
+        lightwave_throw("the camera does not support rasterization");
+
+    m_resolution = camera.resolution();
+    m_tileSize   = blockSize;
+    m_tileOrigin = (m_resolution - blockSize) / 2;
+    for (int dim = 0; dim < 2; dim++) {
+        m_firstTile[dim] = tileIndex(0, dim);
+        m_tileCount[dim] = tileIndex(m_resolution[dim] - 1, dim) -
+                           m_firstTile[dim] + 1;
+    }
+    m_tiles.resize(m_tileCount.product());
+
+    // instances of meshes are rasterized, everything else is traced
+    std::vector<ref<Shape>> remainder;
+    std::unordered_set<const TriangleMesh *> mergedMeshes;
+    for (const ref<Shape> &entity : scene.entities()) {
+        const auto instance = dynamic_cast<const Instance *>(entity.get());
+        const auto mesh =
+            instance ? dynamic_cast<const TriangleMesh *>(instance->shape())
+                     : nullptr;
+        if (!mesh || instance->alpha()) {
+            remainder.push_back(entity);
+            continue;
+        }
+        // meshes merged from several instances are rasterized only once
+        if (instance->isMerged() && !mergedMeshes.insert(mesh).second)
+            continue;
+        m_entities.push_back(
+            { instance, mesh, instance->compile(), instance->isMerged() });
+        addMesh(*camera.transform(), extent, uint32_t(m_entities.size() - 1));
+    }
+
+    if (remainder.size() == 1) {
+        m_remainder = remainder.front();
+    } else if (!remainder.empty()) {
+        Properties properties;
+        for (const ref<Shape> &shape : remainder)
+            properties.addChild(shape);
+        m_remainder = std::static_pointer_cast<Shape>(
+            Registry::create("shape", "group", properties));
+    }
+
+    logger(EInfo,
+           "prepared rasterization of %d triangles from %d meshes (%d shapes "
+           "traced) in %.1f ms",
+           m_triangles.size(),
+           m_entities.size(),
+           remainder.size(),
+           timer.getElapsedTime() * 1000);
+}
+
+void VisibilityBuffer::addMesh(const Transform &camera, const Vector2 &extent,
+                               uint32_t entity) {
+    const Entity &e = m_entities[entity];
+
+    // transform all vertices to camera coordinates
+    std::vector<Point> local(e.mesh->numberOfVertices());
+    const AffineMatrix &toWorld = e.instance->toWorld();
+    for_each_parallel(Range(0, int(local.size())), [&](int i) {
+        local[i] = camera.inverse(toWorld.apply(e.mesh->position(i)));
+    });
+
+    const Vector2 scale(m_resolution.x() / (2 * extent.x()),
+                        m_resolution.y() / (2 * extent.y()));
+    const auto project = [&](const Point &p) {
+        return Vector2((p.x() / p.z() + extent.x()) * scale.x(),
+                       (p.y() / p.z() + extent.y()) * scale.y());
+    };
+
+    for (int primitive = 0; primitive < e.mesh->numberOfTriangles();
+         primitive++) {
+        // clip the triangle at the near plane, which leaves up to four
+        // vertices
+        const Vector3i indices = e.mesh->triangle(primitive);
+        Point polygon[4];
+        int count = 0;
+        for (int i = 0; i < 3; i++) {
+            const Point &a = local[indices[i]];
+            const Point &b = local[indices[(i + 1) % 3]];
+            if (a.z() >= NearPlane)
+                polygon[count++] = a;
+            if ((a.z() >= NearPlane) != (b.z() >= NearPlane)) {
+                const float t = (NearPlane - a.z()) / (b.z() - a.z());
+                polygon[count++] = a + t * (b - a);
+            }
+        }
+        if (count < 3)
+            continue;
+
+        Vector2 screen[4];
+        float inverseDepth[4];
+        for (int i = 0; i < count; i++) {
+            screen[i]       = project(polygon[i]);
+            inverseDepth[i] = 1 / polygon[i].z();
+        }
+
+        for (int fan = 1; fan + 1 < count; fan++) {
+            const int corners[3] = { 0, fan, fan + 1 };
+            ScreenTriangle triangle;
+            float area = 0;
+            for (int i = 0; i < 3; i++) {
+                const Vector2 &a = screen[corners[i]];
+                const Vector2 &b = screen[corners[(i + 1) % 3]];
+                triangle.edges[i][0] = a.y() - b.y();
+                triangle.edges[i][1] = b.x() - a.x();
+                triangle.edges[i][2] = a.x() * b.y() - a.y() * b.x();
+                area += triangle.edges[i][2];
+            }
+            if (!(abs(area) > 0))
+                continue; // seen edge-on
+            if (area < 0) {
+                for (auto &edge : triangle.edges) {
+                    for (float &coefficient : edge)
+                        coefficient = -coefficient;
+                }
+                area = -area;
+            }
+
+            // each vertex is weighted by the edge function of the opposite
+            // edge (i.e., by its barycentric coordinate)
+            for (int k = 0; k < 3; k++) {
+                triangle.inverseDepth[k] = 0;
+                for (int i = 0; i < 3; i++) {
+                    triangle.inverseDepth[k] +=
+                        inverseDepth[corners[i]] *
+                        triangle.edges[(i + 1) % 3][k] / area;
+                }
+            }
+
+            Vector2 min = screen[corners[0]], max = min;
+            for (int i = 1; i < 3; i++) {
+                min = elementwiseMin(min, screen[corners[i]]);
+                max = elementwiseMax(max, screen[corners[i]]);
+            }
+            // (clamped before conversion, as vertices close to the near plane
+            // can project far outside the image)
+            const auto pixel = [&](float value, int dim) {
+                return int(std::clamp(
+                    std::floor(value), -1.f, float(m_resolution[dim])));
+            };
+            triangle.pixels = Bounds2i(Vector2i(0), m_resolution)
+                                  .clip(Bounds2i(Vector2i(pixel(min.x(), 0),
+                                                          pixel(min.y(), 1)),
+                                                 Vector2i(pixel(max.x(), 0) + 1,
+                                                          pixel(max.y(), 1) + 1)));
+            if (triangle.pixels.isEmpty())
+                continue;
+            triangle.entity    = entity;
+            triangle.primitive = uint32_t(primitive);
+
+            const uint32_t index = uint32_t(m_triangles.size());
+            m_triangles.push_back(triangle);
+            for (int y = tileIndex(triangle.pixels.min().y(), 1);
+                 y <= tileIndex(triangle.pixels.max().y() - 1, 1);
+                 y++) {
+                for (int x = tileIndex(triangle.pixels.min().x(), 0);
+                     x <= tileIndex(triangle.pixels.max().x() - 1, 0);
+                     x++) {
+                    m_tiles[(y - m_firstTile.y()) * m_tileCount.x() + x -
+                            m_firstTile.x()]
+                        .push_back(index);
+                }
+            }
+        }
+    }
+}
+
+void VisibilityBuffer::rasterize(const Bounds2i &block, Sampler &sampler,
+                                 int firstSample, int sampleCount,
+                                 Tile &tile) const {
+    PROFILE("Rasterize")
+
+    const Vector2i size = block.diagonal();
+    tile.block          = block;
+    tile.firstSample    = firstSample;
+    tile.sampleCount    = sampleCount;
+    tile.samples.assign(size.product() * sampleCount,
+                        { .inverseDepth = 0, .entity = None, .primitive = 0 });
+
+    // the sample positions that the camera will use
+    std::vector<Vector2> &positions = tile.positions;
+    positions.resize(tile.samples.size());
+    for (auto pixel : block) {
+        for (int sample = 0; sample < sampleCount; sample++) {
+            sampler.seed(pixel, firstSample + sample);
+            const Vector2i offset = pixel - block.min();
+            positions[(offset.y() * size.x() + offset.x()) * sampleCount +
+                      sample] = Vector2(pixel.cast<float>()) +
+                                Vector2(sampler.next2D());
+        }
+    }
+
+    const std::vector<uint32_t> &triangles =
+        m_tiles[(tileIndex(block.min().y(), 1) - m_firstTile.y()) *
+                    m_tileCount.x() +
+                tileIndex(block.min().x(), 0) - m_firstTile.x()];
+    for (uint32_t index : triangles) {
+        const ScreenTriangle &triangle = m_triangles[index];
+        const Bounds2i pixels          = block.clip(triangle.pixels);
+        for (int y = pixels.min().y(); y < pixels.max().y(); y++) {
+            for (int x = pixels.min().x(); x < pixels.max().x(); x++) {
+                const int first =
+                    ((y - block.min().y()) * size.x() + x - block.min().x()) *
+                    sampleCount;
+                for (int sample = first; sample < first + sampleCount;
+                     sample++) {
+                    const Vector2 &p = positions[sample];
+                    bool inside      = true;
+                    for (const auto &edge : triangle.edges) {
+                        inside &= edge[0] * p.x() + edge[1] * p.y() + edge[2] >=
+                                  0;
+                    }
+                    if (!inside)
+                        continue;
+                    const float inverseDepth =
+                        triangle.inverseDepth[0] * p.x() +
+                        triangle.inverseDepth[1] * p.y() +
+                        triangle.inverseDepth[2];
+                    Sample &result = tile.samples[sample];
+                    if (inverseDepth > result.inverseDepth) {
+                        result = { .inverseDepth = inverseDepth,
+                                   .entity       = triangle.entity,
+                                   .primitive    = triangle.primitive };
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::optional<Intersection> VisibilityBuffer::intersect(const Ray &ray,
+                                                        const Sample &sample,
+                                                        Sampler &rng) const {
+    Intersection its(-ray.direction);
+    if (sample.entity != None) {
+        const Entity &entity  = m_entities[sample.entity];
+        const float previousT = its.t;
+        float scale;
+        const Ray localRay = entity.compiled.toObjectRay(ray, scale);
+        its.t *= scale;
+        if (!entity.mesh->intersectPrimitive(int(sample.primitive), localRay,
+                                             its)) {
+            // the sample lies on the boundary of the triangle, where
+            // rasterization and ray tracing can disagree
+            return std::nullopt;
+        }
+        const Instance *instance =
+            entity.merged ? its.instance : entity.instance;
+        instance->completeIntersection(its, previousT, scale, rng);
+    }
+
+    if (m_remainder)
+        m_remainder->intersect(ray, its, rng);
+    m_scene->completeIntersection(its);
+    return its;
+}
+
+} // namespace lightwave
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <lightwave/core.hpp>
+#include <lightwave/instance.hpp>
+#include <lightwave/math.hpp>
+
+#include <optional>
+#include <vector>
+
+namespace lightwave {
+
+class TriangleMesh;
+
+/**
+ * @brief Computes primary visibility for pinhole cameras by rasterizing the
+ * triangle meshes of the scene instead of tracing camera rays through the BVH
+ * (see @ref Camera::rasterizationExtent ).
+ *
+ * At construction, all triangles are projected onto the image plane and binned
+ * into tiles that match the blocks the integrator renders. Each block then
+ * rasterizes the triangles of its tile at the exact (jittered) sample
+ * positions that the camera will use, which yields the closest triangle for
+ * each sample. The integrator then resolves each camera ray through @ref
+ * intersect , which only intersects that triangle, and passes the hit on to
+ * @ref SamplingIntegrator::LiAt . Shapes that cannot be rasterized (e.g.,
+ * spheres, nested groups or alpha-masked instances) are still traced for each
+ * camera ray.
+ */
+class VisibilityBuffer {
+public:
+    /// @brief Marks samples that are not covered by any triangle.
+    static constexpr uint32_t None = ~uint32_t(0);
+
+    /// @brief The closest triangle found for a sample.
+    struct Sample {
+        /// @brief The reciprocal of the depth (in camera coordinates), which
+        /// is zero if no triangle covers the sample.
+        float inverseDepth;
+        /// @brief The index of the instance (or @ref None ).
+        uint32_t entity;
+        /// @brief The index of the triangle within the mesh of the instance.
+        uint32_t primitive;
+    };
+
+    /// @brief A range of samples of all pixels within a block.
+    struct Tile {
+        Bounds2i block;
+        /// @brief The index of the first sample of each pixel.
+        int firstSample;
+        /// @brief The number of samples of each pixel.
+        int sampleCount;
+        std::vector<Sample> samples;
+        /// @brief The positions of the samples on the image plane.
+        std::vector<Vector2> positions;
+
+        const Sample &operator()(const Point2i &pixel, int sample) const {
+            const Vector2i offset = pixel - block.min();
+            return samples[(offset.y() * block.diagonal().x() + offset.x()) *
+                               sampleCount +
+                           sample - firstSample];
+        }
+    };
+
+private:
+    /// @brief An instance of a triangle mesh that is rasterized.
+    struct Entity {
+        const Instance *instance;
+        const TriangleMesh *mesh;
+        Instance::Compiled compiled;
+        /// @brief Whether the mesh was merged from several instances (see
+        /// @ref Instance::mergeInto ), in which case the mesh reports the
+        /// instance that was hit.
+        bool merged;
+    };
+
+    /// @brief A triangle projected onto the image plane (in pixel
+    /// coordinates).
+    struct ScreenTriangle {
+        /// @brief The coefficients (a, b, c) of the edge functions
+        /// @code a * x + b * y + c @endcode , which are non-negative inside.
+        float edges[3][3];
+        /// @brief The coefficients of the inverse depth, which is affine in
+        /// pixel coordinates.
+        float inverseDepth[3];
+        /// @brief The pixels whose samples might be covered.
+        Bounds2i pixels;
+        uint32_t entity;
+        uint32_t primitive;
+    };
+
+    const Scene *m_scene;
+    Vector2i m_resolution;
+    Vector2i m_tileSize;
+    /// @brief The pixel at which the tile with index zero begins.
+    Vector2i m_tileOrigin;
+    /// @brief The index of the first tile that overlaps the image.
+    Vector2i m_firstTile;
+    /// @brief The number of tiles along each axis.
+    Vector2i m_tileCount;
+
+    std::vector<Entity> m_entities;
+    std::vector<ScreenTriangle> m_triangles;
+    /// @brief The indices into @c m_triangles for each tile.
+    std::vector<std::vector<uint32_t>> m_tiles;
+    /// @brief The shapes that are traced for each camera ray (or null).
+    ref<Shape> m_remainder;
+
+    /// @brief Returns the index of the tile containing the given pixel along
+    /// one axis.
+    int tileIndex(int pixel, int dim) const {
+        const int offset = pixel - m_tileOrigin[dim];
+        return (offset >= 0 ? offset : offset - m_tileSize[dim] + 1) /
+               m_tileSize[dim];
+    }
+
+    /// @brief Projects and bins the triangles of a mesh instance.
+    void addMesh(const Transform &camera, const Vector2 &extent,
+                 uint32_t entity);
+
+public:
+    /**
+     * @brief Prepares rasterization for the camera of the given scene.
+     * @param blockSize The size of the blocks that will be rasterized, which
+     * are assumed to be laid out like @ref BlockSpiral does.
+     */
+    VisibilityBuffer(const Scene &scene, const Vector2i &blockSize);
+
+    /// @brief Finds the closest triangle for a range of samples of all pixels
+    /// of the given block.
+    void rasterize(const Bounds2i &block, Sampler &sampler, int firstSample,
+                   int sampleCount, Tile &tile) const;
+
+    /**
+     * @brief Finds the closest intersection of a camera ray from the sample
+     * that was rasterized for it, or returns nothing if the sample lies on the
+     * boundary of a triangle (in which case the ray needs to be traced).
+     */
+    std::optional<Intersection> intersect(const Ray &ray, const Sample &sample,
+                                          Sampler &rng) const;
+};
+
+} // namespace lightwave
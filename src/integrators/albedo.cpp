@@ -8,7 +8,11 @@ public:
         : SamplingIntegrator(properties) {}
 
     Color Li(const Ray &ray, Sampler &rng) override {
-        Intersection its = m_scene->intersect(ray, rng);
+        return LiAt(ray, m_scene->intersect(ray, rng), rng);
+    }
+
+    Color LiAt(const Ray &ray, const Intersection &its,
+               Sampler &rng) override {
         if (its) {
             // Sample the BSDF at the intersection.
             BsdfSample sample = its.sampleBsdf(rng);
@@ -26,7 +26,11 @@ public:
     }
 
     Color Li(const Ray &ray, Sampler &rng) override {
-        Intersection its = m_scene->intersect(ray, rng);
+        return LiAt(ray, m_scene->intersect(ray, rng), rng);
+    }
+
+    Color LiAt(const Ray &ray, const Intersection &its,
+               Sampler &rng) override {
 
         switch (m_variable) {
         case AovNormals:
@@ -36,7 +36,11 @@ public:
     }
 
     Color Li(const Ray &ray, Sampler &rng) override {
-        Intersection its = m_scene->intersect(ray, rng);
+        return LiAt(ray, m_scene->intersect(ray, rng), rng);
+    }
+
+    Color LiAt(const Ray &ray, const Intersection &its,
+               Sampler &rng) override {
 
         Vector d  = ray.direction;
         float fcc = 0.25f; // floor/ceil/sky color
@@ -11,7 +11,11 @@ public:
     }
     Color Li(const Ray &ray, Sampler &rng) override {
         // Determine if the ray intersects any surfaces in the scene.
-        Intersection its = m_scene->intersect(ray, rng);
+        return LiAt(ray, m_scene->intersect(ray, rng), rng);
+    }
+
+    Color LiAt(const Ray &ray, const Intersection &its,
+               Sampler &rng) override {
         if (its) {
             Color contribution;
             Color emission = its.evaluateEmission().value;
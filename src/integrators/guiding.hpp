@@ -0,0 +1,314 @@
+/**
+ * @brief Data structures for path guiding.
+ * @file guiding.hpp
+ * @see "Practical Path Guiding for Efficient Light-Transport Simulation"
+ * [Müller et al. 2017]
+ */
+
+#pragma once
+
+#include <lightwave/iterators.hpp>
+#include <lightwave/math.hpp>
+#include <lightwave/parallel.hpp>
+#include <lightwave/sampler.hpp>
+
+#include <array>
+#include <vector>
+
+namespace lightwave::guiding {
+
+/// @brief Maps a direction onto the unit square using the area preserving
+/// cylindrical mapping, i.e., a density on the square corresponds to a solid
+/// angle density that is smaller by a factor of @code 4 * Pi @endcode .
+inline Point2 directionToCanonical(const Vector &d) {
+    const float cosTheta = clamp(d.z(), -1.f, 1.f);
+    float phi            = std::atan2(d.y(), d.x());
+    if (phi < 0)
+        phi += 2 * Pi;
+    return { min(0.5f * (cosTheta + 1), 1 - Epsilon),
+             min(phi * Inv2Pi, 1 - Epsilon) };
+}
+
+/// @brief Inverse of @ref directionToCanonical .
+inline Vector canonicalToDirection(const Point2 &p) {
+    const float cosTheta = 2 * p.x() - 1;
+    const float sinTheta = safe_sqrt(1 - sqr(cosTheta));
+    const float phi      = 2 * Pi * p.y();
+    return { sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+}
+
+/**
+ * @brief A quadtree over the unit square that approximates the incident
+ * radiance of a region of space (the directional part of the SD-tree).
+ * Each node stores the energy of its four quadrants, which allows both
+ * sampling and evaluating the piecewise constant density it describes.
+ */
+class DTree {
+    /// @brief Quadrants are numbered as @code x + 2 * y @endcode .
+    struct Node {
+        std::array<float, 4> sum{};
+        /// @brief Index of the child node of each quadrant, or 0 for leaves.
+        std::array<uint32_t, 4> children{};
+
+        float total() const { return sum[0] + sum[1] + sum[2] + sum[3]; }
+    };
+
+    std::vector<Node> m_nodes;
+    /// @brief The number of samples that have been recorded.
+    float m_statisticalWeight = 0;
+
+    static int quadrant(Point2 &p) {
+        const int x = p.x() >= 0.5f;
+        const int y = p.y() >= 0.5f;
+        p           = { 2 * p.x() - x, 2 * p.y() - y };
+        return x + 2 * y;
+    }
+
+public:
+    DTree() : m_nodes(1) {}
+
+    /// @brief The total energy recorded in the tree.
+    float total() const { return m_nodes[0].total(); }
+    float statisticalWeight() const { return m_statisticalWeight; }
+    size_t nodeCount() const { return m_nodes.size(); }
+    size_t memoryUsage() const { return m_nodes.capacity() * sizeof(Node); }
+
+    /// @brief Splats a radiance estimate along all nodes that contain the
+    /// given direction. Safe to call from multiple threads concurrently.
+    void record(const Vector &direction, float radiance) {
+        atomicAdd(m_statisticalWeight, 1.f);
+        if (!(radiance > 0) || !std::isfinite(radiance))
+            return;
+
+        Point2 p       = directionToCanonical(direction);
+        uint32_t index = 0;
+        while (true) {
+            const int q = quadrant(p);
+            atomicAdd(m_nodes[index].sum[q], radiance);
+            if (!m_nodes[index].children[q])
+                break;
+            index = m_nodes[index].children[q];
+        }
+    }
+
+    /// @brief The solid angle density of sampling the given direction.
+    float pdf(const Vector &direction) const {
+        Point2 p       = directionToCanonical(direction);
+        float density  = Inv4Pi;
+        uint32_t index = 0;
+        while (true) {
+            const Node &node  = m_nodes[index];
+            const float total = node.total();
+            if (!(total > 0))
+                return density;
+            const int q = quadrant(p);
+            density *= 4 * node.sum[q] / total;
+            if (!node.children[q])
+                return density;
+            index = node.children[q];
+        }
+    }
+
+    /// @brief Samples a direction proportional to the recorded radiance.
+    Vector sample(Point2 rnd) const {
+        Point2 origin(0);
+        float size     = 1;
+        uint32_t index = 0;
+        while (true) {
+            const Node &node  = m_nodes[index];
+            const float total = node.total();
+            if (!(total > 0))
+                break;
+
+            // pick the horizontal half first, then the vertical half within
+            const float left = node.sum[0] + node.sum[2];
+            int x            = 0;
+            if (rnd.x() < left / total) {
+                rnd.x() = rnd.x() * total / left;
+            } else {
+                x       = 1;
+                rnd.x() = (rnd.x() - left / total) * total / (total - left);
+            }
+            const float column = node.sum[x] + node.sum[x + 2];
+            int y              = 0;
+            if (rnd.y() < node.sum[x] / column) {
+                rnd.y() = rnd.y() * column / node.sum[x];
+            } else {
+                y       = 1;
+                rnd.y() = (rnd.y() - node.sum[x] / column) * column /
+                          node.sum[x + 2];
+            }
+            rnd = { min(rnd.x(), 1 - Epsilon), min(rnd.y(), 1 - Epsilon) };
+
+            size *= 0.5f;
+            origin = { origin.x() + x * size, origin.y() + y * size };
+
+            const int q = x + 2 * y;
+            if (!node.children[q])
+                break;
+            index = node.children[q];
+        }
+        return canonicalToDirection(
+            { origin.x() + size * rnd.x(), origin.y() + size * rnd.y() });
+    }
+
+    /**
+     * @brief Builds an empty tree whose structure adapts to the energy
+     * recorded in @c previous : quadrants holding more than @c threshold of
+     * the total energy are subdivided, all others are collapsed.
+     */
+    static DTree refined(const DTree &previous, float threshold, int maxDepth) {
+        DTree result;
+        const float total = previous.total();
+        if (total > 0)
+            result.refineFrom(
+                previous, &previous.m_nodes[0], total, threshold, 1, maxDepth);
+        return result;
+    }
+
+    /// @brief Splits the recorded samples evenly between two copies of the
+    /// tree (used when a spatial region is subdivided).
+    void halveWeight() { m_statisticalWeight /= 2; }
+
+private:
+    /// @param source The corresponding node in @c previous , or @c nullptr if
+    /// the previous tree did not subdivide this far.
+    /// @param energy The energy of the quadrant this node covers.
+    void refineFrom(const DTree &previous, const Node *source, float energy,
+                    float threshold, int depth, int maxDepth) {
+        const uint32_t target = uint32_t(m_nodes.size()) - 1;
+        for (int q = 0; q < 4; q++) {
+            // quadrants below a node that did not exist in the previous tree
+            // inherit an even share of their parent's energy
+            const float quadrantEnergy = source ? source->sum[q] : energy / 4;
+            if (quadrantEnergy / previous.total() <= threshold ||
+                depth >= maxDepth)
+                continue;
+
+            m_nodes.emplace_back();
+            m_nodes[target].children[q] = uint32_t(m_nodes.size()) - 1;
+            const Node *child =
+                source && source->children[q]
+                    ? &previous.m_nodes[source->children[q]]
+                    : nullptr;
+            refineFrom(previous,
+                       child,
+                       quadrantEnergy,
+                       threshold,
+                       depth + 1,
+                       maxDepth);
+        }
+    }
+};
+
+/**
+ * @brief A binary tree that adaptively partitions the scene bounding box,
+ * storing a pair of directional trees in each leaf: one that is used for
+ * sampling and one that collects radiance estimates during the current pass.
+ */
+class STree {
+public:
+    struct Leaf {
+        /// @brief The distribution used for sampling during the current pass.
+        DTree sampling;
+        /// @brief Collects radiance estimates during the current pass.
+        DTree building;
+    };
+
+private:
+    struct Node {
+        /// @brief Index of the first child (the second one follows directly),
+        /// or 0 for leaves.
+        uint32_t children = 0;
+        uint32_t axis     = 0;
+        /// @brief Index into @c m_leaves for leaf nodes.
+        uint32_t leaf = 0;
+    };
+
+    Bounds m_bounds;
+    std::vector<Node> m_nodes;
+    std::vector<Leaf> m_leaves;
+
+    void subdivide(uint32_t index, float threshold) {
+        Leaf &leaf = m_leaves[m_nodes[index].leaf];
+        if (leaf.building.statisticalWeight() <= threshold)
+            return;
+
+        leaf.building.halveWeight();
+        const uint32_t first = uint32_t(m_nodes.size());
+        const uint32_t axis  = (m_nodes[index].axis + 1) % 3;
+        m_nodes[index].children = first;
+        m_nodes.push_back({ .children = 0,
+                            .axis     = axis,
+                            .leaf     = m_nodes[index].leaf });
+        m_nodes.push_back({ .children = 0,
+                            .axis     = axis,
+                            .leaf     = uint32_t(m_leaves.size()) });
+        m_leaves.push_back(m_leaves[m_nodes[index].leaf]);
+
+        subdivide(first, threshold);
+        subdivide(first + 1, threshold);
+    }
+
+public:
+    STree(const Bounds &bounds) {
+        // use a cube so that spatial splits stay well proportioned
+        const Vector extent = bounds.diagonal();
+        const float size =
+            max(max(extent.x(), extent.y()), max(extent.z(), Epsilon));
+        m_bounds = Bounds(bounds.min(), bounds.min() + Vector(size));
+        m_nodes.push_back({ .children = 0, .axis = 2, .leaf = 0 });
+        m_leaves.emplace_back();
+    }
+
+    /// @brief Finds the leaf whose region contains the given position.
+    Leaf &lookup(const Point &position) {
+        Vector p = (position - m_bounds.min()) / m_bounds.diagonal();
+        const Node *node = &m_nodes[0];
+        while (node->children) {
+            const uint32_t axis = (node->axis + 1) % 3;
+            const int child     = p[axis] >= 0.5f;
+            p[axis]             = clamp(2 * p[axis] - child, 0.f, 1.f);
+            node                = &m_nodes[node->children + child];
+        }
+        return m_leaves[node->leaf];
+    }
+
+    /**
+     * @brief Prepares the tree for the next training pass: the radiance
+     * collected so far becomes the new sampling distribution, regions that
+     * received many samples are subdivided and the directional trees are
+     * adapted to the collected energy.
+     * @param iteration The index of the pass that has just been completed.
+     */
+    void refine(int iteration, float spatialThreshold,
+                float directionalThreshold, int maxDepth) {
+        const float threshold =
+            spatialThreshold * std::sqrt(float(1 << iteration));
+        const size_t nodeCount = m_nodes.size();
+        for (uint32_t index = 0; index < nodeCount; index++) {
+            if (!m_nodes[index].children)
+                subdivide(index, threshold);
+        }
+
+        for_each_parallel(Range(0, int(m_leaves.size())), [&](int index) {
+            Leaf &leaf    = m_leaves[index];
+            leaf.sampling = std::move(leaf.building);
+            leaf.building =
+                DTree::refined(leaf.sampling, directionalThreshold, maxDepth);
+        });
+    }
+
+    size_t leafCount() const { return m_leaves.size(); }
+
+    /// @brief The memory occupied by the spatial and all directional trees.
+    size_t memoryUsage() const {
+        size_t bytes = m_nodes.capacity() * sizeof(Node) +
+                       m_leaves.capacity() * sizeof(Leaf);
+        for (const Leaf &leaf : m_leaves)
+            bytes += leaf.sampling.memoryUsage() + leaf.building.memoryUsage();
+        return bytes;
+    }
+};
+
+} // namespace lightwave::guiding
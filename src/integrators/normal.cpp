@@ -11,7 +11,11 @@ public:
         m_remap = properties.get<bool>("remap", true);
     }
     Color Li(const Ray &ray, Sampler &rng) override {
-        Intersection its = m_scene->intersect(ray, rng);
+        return LiAt(ray, m_scene->intersect(ray, rng), rng);
+    }
+
+    Color LiAt(const Ray &ray, const Intersection &its,
+               Sampler &rng) override {
         if (its) {
             Vector normal = its.shadingNormal;
             if (m_remap) {
@@ -1,27 +1,282 @@
 #include <lightwave.hpp>
 
+#include "guiding.hpp"
+#include "photonmap.hpp"
+#include "radiancecache.hpp"
+
 namespace lightwave {
 
+namespace {
+
+/// @brief Counters that summarize how much work paths have performed.
+struct PathStatistics {
+    int64_t paths                = 0;
+    int64_t bounces              = 0;
+    int64_t rouletteTerminations = 0;
+    /// @brief The number of bounces that paths terminated by Russian roulette
+    /// could at most have performed.
+    int64_t rouletteRaysSaved = 0;
+    /// @brief The number of camera rays that did not need to be traced since
+    /// split paths share them.
+    int64_t sharedPrimaryRays = 0;
+
+    /// @brief Adds the counters of @c other and resets them.
+    void merge(PathStatistics &other) {
+        atomicAdd(paths, other.paths);
+        atomicAdd(bounces, other.bounces);
+        atomicAdd(rouletteTerminations, other.rouletteTerminations);
+        atomicAdd(rouletteRaysSaved, other.rouletteRaysSaved);
+        atomicAdd(sharedPrimaryRays, other.sharedPrimaryRays);
+        other = {};
+    }
+};
+
+/// @brief The counters of the block that this thread currently renders, which
+/// are merged once the block is finished so that paths do not contend for
+/// shared counters.
+thread_local PathStatistics blockStatistics;
+
+} // namespace
+
 class PathTracerIntegrator : public SamplingIntegrator {
+    /// @brief Fraction of the total directional energy above which a quadrant
+    /// of a directional tree is subdivided.
+    static constexpr float DirectionalThreshold = 0.01f;
+    /// @brief Number of samples (scaled by the square root of the number of
+    /// passes) above which a spatial region is subdivided.
+    static constexpr float SpatialThreshold = 12000;
+    static constexpr int MaxDirectionalDepth = 20;
+    /// @brief Maximum number of path vertices that contribute to training and
+    /// caching.
+    static constexpr int MaxRecordedVertices = 32;
+
     int m_maxdepth;
 
-public:
-    PathTracerIntegrator(const Properties &properties)
-        : SamplingIntegrator(properties) {
-        m_maxdepth = properties.get<int>("depth", 2);
+    /// @brief Whether directions are sampled from a learned SD-tree in
+    /// addition to the Bsdf.
+    bool m_guiding;
+    /// @brief The number of training passes that precede the final render.
+    int m_guidingPasses;
+    /// @brief The probability of sampling the Bsdf instead of the guiding
+    /// distribution (one-sample MIS).
+    float m_bsdfSamplingFraction;
+    ref<guiding::STree> m_guide;
+    bool m_training = false;
+
+    /// @brief Whether secondary bounces off diffuse surfaces terminate into a
+    /// radiance cache.
+    bool m_caching;
+    /// @brief The number of cache cells along the longest scene axis.
+    int m_cacheResolution;
+    int m_cacheCapacity;
+    /// @brief The number of samples a cache cell needs before it is used.
+    int m_cacheMinSamples;
+    /// @brief The maximum relative standard error of a cache cell to be used.
+    float m_cacheMaxError;
+    /// @brief Optional file the cache is restored from and stored to, which
+    /// allows reusing it across the frames of an animation.
+    std::filesystem::path m_cacheFile;
+    ref<RadianceCache> m_cache;
+
+    /// @brief The number of photons emitted to render caustics, or 0 to leave
+    /// caustics to path tracing.
+    int m_photonCount;
+    /// @brief The maximum number of specular bounces of a photon.
+    int m_photonDepth;
+    /// @brief The gather radius for photon density estimation (0 picks a
+    /// radius relative to the scene size).
+    float m_photonRadius;
+    ref<PhotonMap> m_photons;
+
+    /// @brief Whether paths are terminated probabilistically based on their
+    /// throughput.
+    bool m_russianRoulette;
+    /// @brief The number of bounces before Russian roulette kicks in.
+    int m_rouletteDepth;
+    /// @brief The number of paths that continue from each primary hit.
+    int m_splits;
+
+    /// @brief Counters that summarize how much work paths have performed.
+    PathStatistics m_stats;
+    /// @brief Whether statistics are gathered, which is only the case while
+    /// Russian roulette or splitting are enabled.
+    bool m_gatherStats;
+
+    /// @brief A path vertex whose incident radiance will be recorded once the
+    /// path has been completed.
+    struct GuidedVertex {
+        guiding::DTree *tree;
+        Vector wi;
+        float pdf;
+        Color throughput;
+        Color contribution;
+    };
+
+    /// @brief A diffuse path vertex whose outgoing radiance will be inserted
+    /// into the radiance cache once the path has been completed.
+    struct CachedVertex {
+        Point position;
+        Vector normal;
+        Color throughput;
+        Color contribution;
+    };
+
+    /// @brief The vertices of a path that contribute to training and caching,
+    /// which are only allocated while either of them is enabled.
+    struct PathRecord {
+        std::array<GuidedVertex, MaxRecordedVertices> guided;
+        int guidedCount = 0;
+        std::array<CachedVertex, MaxRecordedVertices> cached;
+        int cachedCount = 0;
+    };
+
+    bool isDiffuse(const Intersection &its) const {
+        return its.instance->bsdf() && its.instance->bsdf()->isDiffuse();
     }
-    Color Li(const Ray &ray, Sampler &rng) override {
-        // Determine if the ray intersects any surfaces in the scene.
+    /// @brief Whether the Bsdf of a surface has lobes other than Dirac deltas,
+    /// i.e., whether it can be evaluated for directions it did not sample.
+    bool isSmooth(const Intersection &its) const {
+        return its.instance->bsdf() && !its.instance->bsdf()->isDelta();
+    }
+
+    /// @brief Samples the next path direction, either from the Bsdf or from the
+    /// guiding distribution, and reports the directional tree that the
+    /// resulting radiance estimate should be recorded in (if any).
+    BsdfSample sampleDirection(const Intersection &its, Sampler &rng,
+                               guiding::DTree *&record) const {
+        record = nullptr;
+        if (!m_guide || !isSmooth(its)) {
+            // Dirac delta lobes cannot be guided
+            return its.sampleBsdf(rng);
+        }
+
+        guiding::STree::Leaf &leaf = m_guide->lookup(its.position);
+        record                     = &leaf.building;
+        if (!(leaf.sampling.total() > 0))
+            return its.sampleBsdf(rng);
+
+        // the Bsdf is only sampled if it is chosen over the guide
+        const float alpha = m_bsdfSamplingFraction;
+        Vector wi;
+        if (rng.next() < alpha) {
+            const BsdfSample bsdfSample = its.sampleBsdf(rng);
+            if (bsdfSample.isInvalid())
+                return bsdfSample;
+            wi = bsdfSample.wi;
+        } else {
+            wi = leaf.sampling.sample(rng.next2D());
+        }
+
+        const BsdfEval bsdf = its.evaluateBsdf(wi);
+        const float pdf =
+            alpha * bsdf.pdf + (1 - alpha) * leaf.sampling.pdf(wi);
+        if (bsdf.isInvalid() || !(pdf > 0))
+            return BsdfSample::invalid();
+        return {
+            .wi     = wi,
+            .weight = bsdf.value / pdf,
+            .pdf    = pdf,
+        };
+    }
+
+    /// @brief Renders progressively larger sample counts, using the radiance
+    /// estimates of each pass to refine the guiding distribution of the next.
+    void train() {
+        const Vector2i resolution = m_scene->camera()->resolution();
+        m_guide = std::make_shared<guiding::STree>(m_scene->getBoundingBox());
+        m_training = true;
+
+        float baselineVariance = 0;
+        int sampleOffset       = m_sampler->samplesPerPixel();
+        for (int pass = 0; pass < m_guidingPasses; pass++) {
+            Timer passTimer;
+            const int spp  = 2 << pass;
+            float variance = 0;
+
+            for_each_parallel_with_state(
+                BlockSpiral(resolution, Vector2i(64)),
+                [&] { return m_sampler->clone(); },
+                [&](auto block, ref<Sampler> &sampler) {
+                    float blockVariance = 0;
+                    for (auto pixel : block) {
+                        double sum = 0, sumSquares = 0;
+                        for (int sample = 0; sample < spp; sample++) {
+                            sampler->seed(pixel, sampleOffset + sample);
+                            auto cameraSample =
+                                m_scene->camera()->sample(pixel, *sampler);
+                            const float value =
+                                (cameraSample.weight *
+                                 Li(cameraSample.ray, *sampler))
+                                    .luminance();
+                            sum += value;
+                            sumSquares += sqr(value);
+                        }
+                        blockVariance +=
+                            float((sumSquares - sum * sum / spp) / (spp - 1));
+                    }
+                    atomicAdd(variance, blockVariance);
+                    finishBlock();
+                });
+            sampleOffset += spp;
+
+            variance /= resolution.product();
+            if (pass == 0)
+                baselineVariance = variance;
+
+            m_guide->refine(pass,
+                            SpatialThreshold,
+                            DirectionalThreshold,
+                            MaxDirectionalDepth);
+            logger(EInfo,
+                   "guiding pass %d/%d (%d spp, %.1f s): pixel variance %g "
+                   "(%.2fx reduction), %d spatial regions, %.2f MiB",
+                   pass + 1,
+                   m_guidingPasses,
+                   spp,
+                   passTimer.getElapsedTime(),
+                   variance,
+                   variance > 0 ? baselineVariance / variance : 1.f,
+                   m_guide->leafCount(),
+                   m_guide->memoryUsage() / (1024.f * 1024.f));
+        }
+
+        m_training = false;
+    }
+
+    /// @brief Continues a path from a surface point it has reached, adding up
+    /// all radiance it gathers beyond the emission of that point.
+    /// @param path Receives the vertices to train and cache, which must be
+    /// given if guiding is being trained or the radiance cache is enabled.
+    Color continuePath(Intersection its, Sampler &rng, PathRecord *path) {
         Color throughput(1.0f);
-        Ray currentRay = ray;
-        int depth      = 0;
+        Ray currentRay;
+        int depth = 0;
         Color contribution(0.0f);
-        while (depth < m_maxdepth) {
-            Intersection its = m_scene->intersect(currentRay, rng);
-            contribution += throughput * its.evaluateEmission().value;
-            if (!its || depth >= m_maxdepth - 1) {
-                break;
+        // the number of specular bounces since the last non-specular vertex,
+        // or -1 if no such vertex exists yet
+        int specularSinceDiffuse = -1;
+
+        while (true) {
+            if (m_cache && isDiffuse(its)) {
+                Color cached;
+                if (depth > 0 && m_cache->lookup(its.position,
+                                                 its.shadingNormal,
+                                                 m_cacheMinSamples,
+                                                 m_cacheMaxError,
+                                                 cached)) {
+                    contribution += throughput * cached;
+                    break;
+                }
+                if (path->cachedCount < MaxRecordedVertices) {
+                    path->cached[path->cachedCount++] = {
+                        .position     = its.position,
+                        .normal       = its.shadingNormal,
+                        .throughput   = throughput,
+                        .contribution = contribution,
+                    };
+                }
             }
+
             LightSample lightSample = m_scene->sampleLight(rng);
             if (lightSample.probability > 0) {
                 DirectLightSample directSample =
@@ -42,22 +297,239 @@ public:
                 }
             }
 
-            BsdfSample bsdfSample = its.sampleBsdf(rng);
+            // caustics arriving at surfaces that are not perfectly specular
+            // are gathered from the photon map, regardless of whether the
+            // path can be continued
+            const bool smooth = isSmooth(its);
+            if (m_photons && smooth) {
+                // the camera path has depth + 1 segments, and photons with
+                // n bounces add another n + 1
+                contribution += throughput * m_photons->gather(
+                                                 its, m_maxdepth - depth - 2);
+            }
+
+            guiding::DTree *record = nullptr;
+            BsdfSample bsdfSample  = sampleDirection(its, rng, record);
             if (bsdfSample.isInvalid()) {
                 break;
             }
+            if (smooth) {
+                specularSinceDiffuse = 0;
+            } else if (specularSinceDiffuse >= 0) {
+                specularSinceDiffuse++;
+            }
             currentRay = Ray(its.position, bsdfSample.wi.normalized());
             throughput *= bsdfSample.weight;
             depth++;
+
+            if (m_training && record &&
+                path->guidedCount < MaxRecordedVertices) {
+                path->guided[path->guidedCount++] = {
+                    .tree         = record,
+                    .wi           = currentRay.direction,
+                    .pdf          = bsdfSample.pdf,
+                    .throughput   = throughput,
+                    .contribution = contribution,
+                };
+            }
+
+            if (m_russianRoulette && depth >= m_rouletteDepth) {
+                // paths whose throughput has dropped are unlikely to
+                // contribute much, so most of them are terminated early and
+                // the survivors are reweighted to remain unbiased
+                const float survival = min(
+                    std::max({ throughput.r(), throughput.g(), throughput.b() }),
+                    0.95f);
+                if (rng.next() >= survival) {
+                    blockStatistics.rouletteTerminations++;
+                    blockStatistics.rouletteRaysSaved += m_maxdepth - depth;
+                    break;
+                }
+                throughput /= survival;
+            }
+
+            its = m_scene->intersect(currentRay, rng);
+            // emission reached through a specular chain from a diffuse
+            // surface is a caustic, which the photon map already accounts for
+            if (!m_photons || specularSinceDiffuse <= 0) {
+                contribution += throughput * its.evaluateEmission().value;
+            }
+            if (!its || depth >= m_maxdepth - 1) {
+                break;
+            }
+        }
+        if (m_gatherStats) {
+            blockStatistics.paths++;
+            blockStatistics.bounces += depth;
+        }
+
+        if (path)
+            recordPath(*path, contribution);
+        return contribution;
+    }
+
+    /// @brief Trains and caches the vertices of a completed path, given its
+    /// total contribution.
+    void recordPath(const PathRecord &path, const Color &contribution) {
+        // Everything gathered after a vertex arrived along its sampled
+        // direction, which gives an estimate of its incident radiance.
+        for (int i = 0; i < path.guidedCount; i++) {
+            const GuidedVertex &vertex = path.guided[i];
+            const Color incident       = contribution - vertex.contribution;
+            Color radiance;
+            for (int channel = 0; channel < Color::NumComponents; channel++) {
+                if (vertex.throughput[channel] > 0)
+                    radiance[channel] =
+                        incident[channel] / vertex.throughput[channel];
+            }
+            vertex.tree->record(vertex.wi, radiance.mean() / vertex.pdf);
+        }
+        for (int i = 0; i < path.cachedCount; i++) {
+            const CachedVertex &vertex = path.cached[i];
+            const Color outgoing       = contribution - vertex.contribution;
+            Color radiance;
+            for (int channel = 0; channel < Color::NumComponents; channel++) {
+                if (vertex.throughput[channel] > 0)
+                    radiance[channel] =
+                        outgoing[channel] / vertex.throughput[channel];
+            }
+            m_cache->insert(vertex.position, vertex.normal, radiance);
+        }
+    }
+
+public:
+    PathTracerIntegrator(const Properties &properties)
+        : SamplingIntegrator(properties) {
+        m_maxdepth      = properties.get<int>("depth", 2);
+        m_guiding       = properties.get<bool>("guiding", false);
+        m_guidingPasses = properties.get<int>("guidingPasses", 4);
+        m_bsdfSamplingFraction =
+            properties.get<float>("bsdfSamplingFraction", 0.5f);
+        m_caching         = properties.get<bool>("cache", false);
+        m_cacheResolution = properties.get<int>("cacheResolution", 256);
+        m_cacheCapacity   = properties.get<int>("cacheCapacity", 1 << 20);
+        m_cacheMinSamples = properties.get<int>("cacheMinSamples", 16);
+        m_cacheMaxError   = properties.get<float>("cacheMaxError", 0.1f);
+        if (properties.has("cacheFile"))
+            m_cacheFile = properties.get<std::filesystem::path>("cacheFile");
+        m_photonCount  = properties.get<int>("photons", 0);
+        m_photonDepth  = properties.get<int>("photonDepth", 8);
+        m_photonRadius = properties.get<float>("photonRadius", 0);
+        m_russianRoulette = properties.get<bool>("russianRoulette", false);
+        m_rouletteDepth   = properties.get<int>("rrDepth", 3);
+        m_splits          = properties.get<int>("splits", 1);
+        if (m_splits < 1)
+            lightwave_throw("the number of splits must be positive");
+        m_gatherStats = m_russianRoulette || m_splits > 1;
+    }
+
+    void execute() override {
+        if (m_photonCount > 0) {
+            Timer photonTimer;
+            const float radius =
+                m_photonRadius > 0
+                    ? m_photonRadius
+                    : 0.01f * m_scene->getBoundingBox().diagonal().length();
+            m_photons = std::make_shared<PhotonMap>(
+                *m_scene, *m_sampler, m_photonCount, m_photonDepth, radius);
+            logger(EInfo,
+                   "traced %d photons in %.1f s, stored %d caustic photons "
+                   "(%.2f MiB, radius %g)",
+                   m_photonCount,
+                   photonTimer.getElapsedTime(),
+                   m_photons->size(),
+                   m_photons->memoryUsage() / (1024.f * 1024.f),
+                   radius);
+        }
+
+        if (m_caching) {
+            m_cache = std::make_shared<RadianceCache>(
+                m_scene->getBoundingBox(), m_cacheResolution, m_cacheCapacity);
+            if (!m_cacheFile.empty())
+                m_cache->load(m_cacheFile);
+        }
+
+        if (m_guiding && m_guidingPasses > 0)
+            train();
+        m_stats = {};
+        SamplingIntegrator::execute();
+
+        if (m_gatherStats) {
+            logger(EInfo,
+                   "traced %d paths with %.2f bounces on average, russian "
+                   "roulette terminated %d paths (saving up to %d rays), "
+                   "splitting shared %d camera rays",
+                   m_stats.paths,
+                   m_stats.paths ? float(m_stats.bounces) / m_stats.paths : 0.f,
+                   m_stats.rouletteTerminations,
+                   m_stats.rouletteRaysSaved,
+                   m_stats.sharedPrimaryRays);
+        }
+
+        if (m_cache) {
+            logger(EInfo,
+                   "radiance cache: %d cells in use, %d samples dropped, "
+                   "%.2f MiB",
+                   m_cache->occupancy(),
+                   m_cache->dropped(),
+                   m_cache->memoryUsage() / (1024.f * 1024.f));
+            if (!m_cacheFile.empty())
+                m_cache->save(m_cacheFile);
+        }
+    }
+
+    Color Li(const Ray &ray, Sampler &rng) override {
+        // Determine if the ray intersects any surfaces in the scene.
+        return LiAt(ray, m_scene->intersect(ray, rng), rng);
+    }
+
+    Color LiAt(const Ray &ray, const Intersection &its,
+               Sampler &rng) override {
+        Color contribution     = its.evaluateEmission().value;
+        if (!its || m_maxdepth <= 1) {
+            return contribution;
         }
+
+        // all split paths share the camera ray and its intersection
+        for (int split = 0; split < m_splits; split++) {
+            if (m_training || m_cache) {
+                PathRecord path;
+                contribution += continuePath(its, rng, &path) / m_splits;
+            } else {
+                contribution += continuePath(its, rng, nullptr) / m_splits;
+            }
+        }
+        if (m_gatherStats)
+            blockStatistics.sharedPrimaryRays += m_splits - 1;
         return contribution;
     }
+
+protected:
+    void finishBlock() override { m_stats.merge(blockStatistics); }
+
+public:
     std::string toString() const override {
         return tfm::format(
-            "DirectIntegrator[\n"
+            "PathTracerIntegrator[\n"
+            "  depth = %d,\n"
+            "  guiding = %s,\n"
+            "  cache = %s,\n"
+            "  photons = %d,\n"
+            "  russianRoulette = %s,\n"
+            "  splits = %d,\n"
             "  sampler = %s,\n"
             "  image = %s,\n"
             "]",
+            m_maxdepth,
+            m_guiding ? tfm::format("%d passes", m_guidingPasses) : "off",
+            m_caching ? tfm::format("%d cells per axis, error %g",
+                                    m_cacheResolution,
+                                    m_cacheMaxError)
+                      : "off",
+            m_photonCount,
+            m_russianRoulette ? tfm::format("from depth %d", m_rouletteDepth)
+                              : "off",
+            m_splits,
             indent(m_sampler),
             indent(m_image));
     }
@@ -65,4 +537,4 @@ public:
 
 } // namespace lightwave
 
-REGISTER_INTEGRATOR(PathTracerIntegrator, "pathtracer")
\ No newline at end of file
+REGISTER_INTEGRATOR(PathTracerIntegrator, "pathtracer")
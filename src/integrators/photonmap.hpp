@@ -0,0 +1,216 @@
+/**
+ * @brief A photon map that stores caustic photons for density estimation.
+ * @file photonmap.hpp
+ */
+
+#pragma once
+
+#include <lightwave/hash.hpp>
+#include <lightwave/iterators.hpp>
+#include <lightwave/light.hpp>
+#include <lightwave/math.hpp>
+#include <lightwave/parallel.hpp>
+#include <lightwave/sampler.hpp>
+#include <lightwave/scene.hpp>
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <vector>
+
+namespace lightwave {
+
+/**
+ * @brief Stores photons that have arrived at non-specular surfaces after one
+ * or more specular bounces (i.e., caustics), which path tracing struggles to
+ * find. Photons are sorted into a hashed grid whose cells are as large as the
+ * gather radius, so that a query only needs to visit the 27 neighboring cells.
+ */
+class PhotonMap {
+    struct Photon {
+        Point position;
+        /// @brief The direction the photon arrived from, pointing away from the
+        /// surface.
+        Vector wi;
+        Color flux;
+        /// @brief The number of specular bounces between the light and the
+        /// surface.
+        int bounces;
+    };
+
+    /// @brief The number of photons traced per parallel work item.
+    static constexpr int ChunkSize = 4096;
+
+    float m_radius;
+    std::vector<Photon> m_photons;
+    /// @brief For each hash cell, the index of its first photon (the photons of
+    /// a cell are stored contiguously).
+    std::vector<uint32_t> m_cellStart;
+
+    Vector3i cellOf(const Point &position) const {
+        return { int(std::floor(position.x() / m_radius)),
+                 int(std::floor(position.y() / m_radius)),
+                 int(std::floor(position.z() / m_radius)) };
+    }
+
+    size_t hashCell(const Vector3i &cell) const {
+        return hash::fnv1a(cell.x(), cell.y(), cell.z()) %
+               (m_cellStart.size() - 1);
+    }
+
+    /// @brief Traces a single photon and appends it to @c photons if it
+    /// reaches a non-specular surface through a specular chain.
+    static void tracePhoton(const Scene &scene, Sampler &rng, int maxDepth,
+                            std::vector<Photon> &photons) {
+        const LightSample lightSample = scene.sampleLight(rng);
+        if (!lightSample)
+            return;
+        const EmissionSample emission = lightSample.light->sampleEmission(
+            scene.getBoundingBox(), rng);
+        if (!emission)
+            return;
+
+        Ray ray    = emission.ray;
+        Color flux = emission.weight / lightSample.probability;
+        for (int depth = 0; depth < maxDepth; depth++) {
+            const Intersection its = scene.intersect(ray, rng);
+            if (!its)
+                return;
+
+            if (!its.instance->bsdf())
+                return;
+            if (!its.instance->bsdf()->isDelta()) {
+                // photons arriving directly from the light are handled by
+                // next event estimation instead
+                if (depth > 0) {
+                    photons.push_back({
+                        .position = its.position,
+                        .wi       = its.wo,
+                        .flux     = flux,
+                        .bounces  = depth,
+                    });
+                }
+                return;
+            }
+
+            const BsdfSample bsdfSample = its.sampleBsdf(rng);
+            if (bsdfSample.isInvalid())
+                return;
+
+            flux *= bsdfSample.weight;
+            ray = Ray(its.position, bsdfSample.wi.normalized());
+        }
+    }
+
+public:
+    /**
+     * @brief Emits photons from all lights of the scene in parallel. Each
+     * chunk of photons is traced into its own buffer, and the buffers are
+     * then concatenated at offsets given by a prefix sum over their sizes,
+     * which requires no locking.
+     * @param sampler A prototype that is cloned for each thread.
+     * @param radius The gather radius used for density estimation.
+     */
+    PhotonMap(const Scene &scene, const Sampler &sampler, int photonCount,
+              int maxDepth, float radius)
+        : m_radius(radius) {
+        const int chunkCount = (photonCount + ChunkSize - 1) / ChunkSize;
+        std::vector<std::vector<Photon>> buffers(chunkCount);
+        for_each_parallel_with_state(
+            ChunkedRange(0, photonCount, ChunkSize),
+            [&] { return sampler.clone(); },
+            [&](Range range, ref<Sampler> &rng) {
+                auto &buffer = buffers[*range.begin() / ChunkSize];
+                for (int index : range) {
+                    rng->seed(index);
+                    tracePhoton(scene, *rng, maxDepth, buffer);
+                }
+            });
+
+        std::vector<size_t> offsets(chunkCount + 1, 0);
+        for (int chunk = 0; chunk < chunkCount; chunk++)
+            offsets[chunk + 1] = offsets[chunk] + buffers[chunk].size();
+
+        std::vector<Photon> photons(offsets.back());
+        for_each_parallel(Range(0, chunkCount), [&](int chunk) {
+            const float scale = 1.f / photonCount;
+            size_t target     = offsets[chunk];
+            for (Photon photon : buffers[chunk]) {
+                photon.flux *= scale;
+                photons[target++] = photon;
+            }
+        });
+
+        // counting sort of the photons into the hashed grid
+        m_cellStart.assign(std::max(photons.size(), size_t(1)) + 1, 0);
+        std::vector<uint32_t> cells(photons.size());
+        for (size_t i = 0; i < photons.size(); i++) {
+            cells[i] = uint32_t(hashCell(cellOf(photons[i].position)));
+            m_cellStart[cells[i] + 1]++;
+        }
+        std::partial_sum(
+            m_cellStart.begin(), m_cellStart.end(), m_cellStart.begin());
+        std::vector<uint32_t> cursor(m_cellStart.begin(), m_cellStart.end());
+        m_photons.resize(photons.size());
+        for (size_t i = 0; i < photons.size(); i++)
+            m_photons[cursor[cells[i]]++] = photons[i];
+    }
+
+    size_t size() const { return m_photons.size(); }
+    size_t memoryUsage() const {
+        return m_photons.capacity() * sizeof(Photon) +
+               m_cellStart.capacity() * sizeof(uint32_t);
+    }
+
+    /**
+     * @brief Estimates the reflected caustic radiance at the given surface
+     * point from the photons within the gather radius.
+     * @param maxBounces Photons with more specular bounces are skipped, so
+     * that the combined paths do not exceed the depth of the camera paths.
+     */
+    Color gather(const Intersection &its, int maxBounces) const {
+        if (m_photons.empty())
+            return Color(0);
+
+        const Vector3i center = cellOf(its.position);
+        const Vector normal   = its.shadingNormal;
+        Color sum(0);
+        // neighboring grid cells can share a hash cell, which must only be
+        // visited once
+        std::array<size_t, 27> visited;
+        int visitedCount = 0;
+        for (int z = -1; z <= 1; z++) {
+            for (int y = -1; y <= 1; y++) {
+                for (int x = -1; x <= 1; x++) {
+                    const size_t cell =
+                        hashCell(center + Vector3i(x, y, z));
+                    if (std::find(visited.begin(),
+                                  visited.begin() + visitedCount,
+                                  cell) != visited.begin() + visitedCount)
+                        continue;
+                    visited[visitedCount++] = cell;
+
+                    for (uint32_t i = m_cellStart[cell];
+                         i < m_cellStart[cell + 1];
+                         i++) {
+                        const Photon &photon = m_photons[i];
+                        if (photon.bounces > maxBounces ||
+                            (photon.position - its.position).lengthSquared() >
+                            sqr(m_radius))
+                            continue;
+                        // the Bsdf evaluation includes the cosine term,
+                        // which density estimation must not apply
+                        const float cosTheta = abs(normal.dot(photon.wi));
+                        if (cosTheta < 1e-3f)
+                            continue;
+                        const BsdfEval bsdf = its.evaluateBsdf(photon.wi);
+                        sum += bsdf.value * photon.flux / cosTheta;
+                    }
+                }
+            }
+        }
+        return sum / (Pi * sqr(m_radius));
+    }
+};
+
+} // namespace lightwave
@@ -0,0 +1,267 @@
+/**
+ * @brief A hashed world-space grid that caches the radiance leaving diffuse
+ * surfaces.
+ * @file radiancecache.hpp
+ */
+
+#pragma once
+
+#include <lightwave/hash.hpp>
+#include <lightwave/logger.hpp>
+#include <lightwave/math.hpp>
+#include <lightwave/parallel.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace lightwave {
+
+/**
+ * @brief Caches the radiance leaving diffuse surfaces in a hashed grid, keyed
+ * by the quantized position and the dominant axis of the surface normal.
+ * Since the outgoing radiance of a Lambertian surface does not depend on the
+ * viewing direction, paths can terminate into the cache once a cell has
+ * collected enough samples to meet the requested error bound.
+ * Insertion and lookup are lock-free: cells are claimed with a compare and
+ * swap on their key, and radiance estimates are accumulated atomically.
+ */
+class RadianceCache {
+    struct Cell {
+        /// @brief The key of the cell, or 0 if the cell is unused.
+        std::atomic<uint64_t> key{ 0 };
+        Color radiance;
+        float luminanceSquared = 0;
+        float count            = 0;
+    };
+
+    /// @brief The maximum number of cells that are probed before giving up.
+    static constexpr int MaxProbes = 32;
+    static constexpr uint32_t FileMagic   = 0x4352574c; // "LWRC"
+    static constexpr uint32_t FileVersion = 1;
+
+    Point m_origin;
+    float m_cellSize;
+    size_t m_capacity;
+    std::unique_ptr<Cell[]> m_cells;
+    int64_t m_dropped = 0;
+
+    uint64_t key(const Point &position, const Vector &normal) const {
+        uint64_t key = 1; // distinguishes used cells from unused ones
+        for (int dim = 0; dim < 3; dim++) {
+            const float cell = (position[dim] - m_origin[dim]) / m_cellSize;
+            key = (key << 20) | (uint64_t(int64_t(std::floor(cell))) & 0xfffff);
+        }
+
+        int axis = 0;
+        for (int dim = 1; dim < 3; dim++) {
+            if (abs(normal[dim]) > abs(normal[axis]))
+                axis = dim;
+        }
+        return (key << 3) | (2 * axis + (normal[axis] < 0));
+    }
+
+    /// @brief Reads a value that other threads may be accumulating into.
+    static float load(float &value,
+                      std::memory_order order = std::memory_order_relaxed) {
+        return std::atomic_ref<float>(value).load(order);
+    }
+
+    size_t slot(uint64_t key) const {
+        return hash::fnv1a(key) & (m_capacity - 1);
+    }
+
+    /// @brief Finds the cell for the given key, optionally claiming an unused
+    /// cell if the key is not present yet.
+    Cell *find(uint64_t key, bool insert) {
+        size_t index = slot(key);
+        for (int probe = 0; probe < MaxProbes; probe++) {
+            Cell &cell       = m_cells[index];
+            uint64_t current = cell.key.load(std::memory_order_acquire);
+            if (current == key)
+                return &cell;
+            if (current == 0) {
+                if (!insert)
+                    return nullptr;
+                if (cell.key.compare_exchange_strong(current, key) ||
+                    current == key)
+                    return &cell;
+            }
+            index = (index + 1) & (m_capacity - 1);
+        }
+        return nullptr;
+    }
+
+public:
+    /// @param bounds The region of space that will be cached.
+    /// @param resolution The number of cells along the longest axis.
+    /// @param capacity The number of cells, rounded up to a power of two.
+    RadianceCache(const Bounds &bounds, int resolution, size_t capacity)
+        : m_origin(bounds.min()) {
+        const Vector extent = bounds.diagonal();
+        m_cellSize = max(max(extent.x(), extent.y()), max(extent.z(), Epsilon)) /
+                     resolution;
+        m_capacity = 1;
+        while (m_capacity < capacity)
+            m_capacity *= 2;
+        m_cells = std::make_unique<Cell[]>(m_capacity);
+    }
+
+    /// @brief Adds a radiance estimate for the given surface point.
+    void insert(const Point &position, const Vector &normal,
+                const Color &radiance) {
+        if (!std::isfinite(radiance))
+            return;
+
+        Cell *cell = find(key(position, normal), true);
+        if (!cell) {
+            atomicAdd(m_dropped, int64_t(1));
+            return;
+        }
+        atomicAdd(cell->radiance, radiance);
+        atomicAdd(cell->luminanceSquared, sqr(radiance.luminance()));
+        atomicAdd(cell->count, 1.f);
+    }
+
+    /**
+     * @brief Looks up the radiance leaving the given surface point.
+     * @param minSamples The number of samples a cell needs to be used.
+     * @param maxError The maximum standard error of the cached luminance,
+     * relative to its mean.
+     * @returns Whether a cell with sufficiently low error was found.
+     */
+    bool lookup(const Point &position, const Vector &normal, int minSamples,
+                float maxError, Color &radiance) {
+        Cell *cell = find(key(position, normal), false);
+        if (!cell)
+            return false;
+
+        // the count is incremented last by insert, hence reading it first
+        // guarantees that the sums include at least as many samples
+        const float count = load(cell->count, std::memory_order_acquire);
+        if (count < max(minSamples, 2))
+            return false;
+
+        Color sum;
+        for (int channel = 0; channel < Color::NumComponents; channel++)
+            sum[channel] = load(cell->radiance[channel]);
+        const float luminanceSquared = load(cell->luminanceSquared);
+
+        const Color mean          = sum / count;
+        const float meanLuminance = mean.luminance();
+        const float variance =
+            max(0.f, luminanceSquared / count - sqr(meanLuminance)) * count /
+            (count - 1);
+        if (variance / count > sqr(maxError * meanLuminance))
+            return false;
+
+        radiance = mean;
+        return true;
+    }
+
+    /// @brief The number of cells that hold data.
+    size_t occupancy() const {
+        size_t used = 0;
+        for (size_t index = 0; index < m_capacity; index++)
+            used += m_cells[index].key.load(std::memory_order_relaxed) != 0;
+        return used;
+    }
+    /// @brief The number of estimates that were discarded since no free cell
+    /// could be found.
+    int64_t dropped() const { return m_dropped; }
+    size_t memoryUsage() const { return m_capacity * sizeof(Cell); }
+
+    /// @brief Stores all used cells, e.g., to reuse them for the next frame of
+    /// an animation.
+    void save(const std::filesystem::path &path) const {
+        std::ofstream stream(path, std::ios::out | std::ios::binary);
+        if (!stream) {
+            logger(EError, "could not write radiance cache %s", path);
+            return;
+        }
+
+        const uint64_t used = occupancy();
+        stream.write((const char *) &FileMagic, sizeof(FileMagic));
+        stream.write((const char *) &FileVersion, sizeof(FileVersion));
+        stream.write((const char *) &m_origin, sizeof(m_origin));
+        stream.write((const char *) &m_cellSize, sizeof(m_cellSize));
+        stream.write((const char *) &used, sizeof(used));
+        for (size_t index = 0; index < m_capacity; index++) {
+            const Cell &cell   = m_cells[index];
+            const uint64_t key = cell.key.load(std::memory_order_relaxed);
+            if (!key)
+                continue;
+            stream.write((const char *) &key, sizeof(key));
+            stream.write((const char *) &cell.radiance, sizeof(cell.radiance));
+            stream.write((const char *) &cell.luminanceSquared,
+                         sizeof(cell.luminanceSquared));
+            stream.write((const char *) &cell.count, sizeof(cell.count));
+        }
+        logger(EInfo, "saved %d radiance cache cells to %s", used, path);
+    }
+
+    /// @brief Restores cells stored by @ref save . The grid of the stored
+    /// cache is adopted so that keys remain valid across frames. Incomplete
+    /// files leave the cache unchanged.
+    bool load(const std::filesystem::path &path) {
+        std::ifstream stream(path, std::ios::in | std::ios::binary);
+        if (!stream)
+            return false;
+
+        uint32_t magic, version;
+        uint64_t used;
+        stream.read((char *) &magic, sizeof(magic));
+        stream.read((char *) &version, sizeof(version));
+        if (!stream || magic != FileMagic || version != FileVersion) {
+            logger(EWarn, "ignoring incompatible radiance cache %s", path);
+            return false;
+        }
+        Point origin;
+        float cellSize;
+        stream.read((char *) &origin, sizeof(origin));
+        stream.read((char *) &cellSize, sizeof(cellSize));
+        stream.read((char *) &used, sizeof(used));
+
+        struct Record {
+            uint64_t key;
+            Color radiance;
+            float luminanceSquared, count;
+        };
+        // all records are read before the cache is modified, so that a
+        // truncated file cannot leave it partially overwritten
+        std::vector<Record> records;
+        for (uint64_t i = 0; i < used && stream; i++) {
+            Record record;
+            stream.read((char *) &record.key, sizeof(record.key));
+            stream.read((char *) &record.radiance, sizeof(record.radiance));
+            stream.read((char *) &record.luminanceSquared,
+                        sizeof(record.luminanceSquared));
+            stream.read((char *) &record.count, sizeof(record.count));
+            if (stream && record.key != 0)
+                records.push_back(record);
+        }
+        if (!stream || records.size() != used || !(cellSize > 0)) {
+            logger(EWarn,
+                   "ignoring truncated or corrupt radiance cache %s",
+                   path);
+            return false;
+        }
+
+        m_origin      = origin;
+        m_cellSize    = cellSize;
+        size_t loaded = 0;
+        for (const Record &record : records) {
+            if (Cell *cell = find(record.key, true)) {
+                cell->radiance         = record.radiance;
+                cell->luminanceSquared = record.luminanceSquared;
+                cell->count            = record.count;
+                loaded++;
+            }
+        }
+        logger(EInfo, "loaded %d radiance cache cells from %s", loaded, path);
+        return true;
+    }
+};
+
+} // namespace lightwave
@@ -56,6 +56,23 @@ public:
         return direct_light;
     }
 
+    EmissionSample sampleEmission(const Bounds &sceneBounds,
+                                  Sampler &rng) const override {
+        const AreaSample areaSample = m_instance->sampleArea(rng);
+        if (areaSample.pdf == 0)
+            return EmissionSample::invalid();
+
+        // cosine weighted directions cancel the foreshortening term
+        const Vector local = squareToCosineHemisphere(rng.next2D());
+        const Color emission =
+            m_instance->emission()->evaluate(areaSample.uv, local).value;
+        const Frame frame = areaSample.shadingFrame();
+        return {
+            .ray    = Ray(areaSample.position, frame.toWorld(local).normalized()),
+            .weight = emission * Pi / areaSample.pdf,
+        };
+    }
+
     bool canBeIntersected() const override { return false; }
 
     std::string toString() const override {
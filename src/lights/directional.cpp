@@ -22,6 +22,17 @@ public:
         return directLight;
     }
 
+    EmissionSample sampleEmission(const Bounds &sceneBounds,
+                                  Sampler &rng) const override {
+        float area;
+        const Ray ray = sampleParallelRay(
+            sceneBounds, -m_direction.normalized(), rng.next2D(), area);
+        return {
+            .ray    = ray,
+            .weight = m_intensity * area,
+        };
+    }
+
     bool canBeIntersected() const override { return false; }
 
     std::string toString() const override {
@@ -1,4 +1,5 @@
 #include <lightwave.hpp>
+#include <lightwave/fastmath.hpp>
 
 #include <vector>
 
@@ -24,8 +25,8 @@ public:
             localDirection = direction.normalized();
         }
 
-        float phi   = std::atan2(-localDirection.z(), localDirection.x());
-        float theta = safe_acos(localDirection.y());
+        float phi   = fast::atan2(-localDirection.z(), localDirection.x());
+        float theta = fast::acos(localDirection.y());
         float u     = (phi + Pi) * Inv2Pi;
         float v     = theta * InvPi;
 
@@ -52,6 +53,18 @@ public:
         };
     }
 
+    EmissionSample sampleEmission(const Bounds &sceneBounds,
+                                  Sampler &rng) const override {
+        const Vector direction = squareToUniformSphere(rng.next2D());
+        float area;
+        const Ray ray =
+            sampleParallelRay(sceneBounds, -direction, rng.next2D(), area);
+        return {
+            .ray    = ray,
+            .weight = evaluate(direction).value * 4 * Pi * area,
+        };
+    }
+
     std::string toString() const override {
         return tfm::format(
             "EnvironmentMap[\n"
@@ -26,6 +26,15 @@ public:
         };
     }
 
+    EmissionSample sampleEmission(const Bounds &sceneBounds,
+                                  Sampler &rng) const override {
+        // the intensity is power / 4 Pi, which the uniform density cancels
+        return {
+            .ray    = Ray(m_position, squareToUniformSphere(rng.next2D())),
+            .weight = m_power,
+        };
+    }
+
     bool canBeIntersected() const override { return false; }
 
     std::string toString() const override {
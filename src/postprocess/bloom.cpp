@@ -72,8 +72,8 @@ public:
     }
 
 private:
-    Image applyGaussianBlur(const Image &input, int width, int height,
-                            float radius) {
+    Image applyGaussianBlurImpl(const Image &input, int width, int height,
+                                float radius) {
         Image output(Point2i(width, height));
 
         int kernelSize = std::ceil(radius) * 2 + 1;
@@ -121,6 +121,10 @@ private:
 
         return output;
     }
+
+    LW_DISPATCH(Image, applyGaussianBlur,
+                (const Image &input, int width, int height, float radius),
+                (input, width, height, radius))
 };
 
 } // namespace lightwave
@@ -141,7 +141,7 @@ private:
 
     //     return output;
     // }
-    Image applyGlareFilter(const Image &input, int width, int height) {
+    Image applyGlareFilterImpl(const Image &input, int width, int height) {
         Image output(Point2i(width, height));
 
         // Define glare angles
@@ -176,6 +176,10 @@ private:
 
         return output;
     }
+
+    LW_DISPATCH(Image, applyGlareFilter,
+                (const Image &input, int width, int height),
+                (input, width, height))
 };
 
 } // namespace lightwave
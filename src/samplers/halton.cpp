@@ -16,17 +16,28 @@ class Halton : public Sampler {
     pcg32 m_pcg;
     float m_random;
     static constexpr int PrimeTableSize = 500;
-    std::vector<int> Primes;
-    std::vector<int> Permutations;
+
+    /// @brief Tables that only depend on the seed. They are built once and
+    /// shared by all clones, which keeps cloning cheap.
+    struct Tables {
+        std::vector<int> Primes;
+        /// @brief The offset of the permutation of each prime.
+        std::vector<int> primeSums;
+        std::vector<int> Permutations;
+        /// @brief The number of digits needed to saturate float precision for
+        /// each prime.
+        std::vector<int> digitCounts;
+    };
+    std::shared_ptr<const Tables> m_tables;
+
     int64_t haltonIndex = 0;
     int dimension       = 0;
-    int primeSum;
-    std::vector<int> primeSums;
 
 private:
-    std::vector<int> GeneratePermutations(const std::vector<int> &Primes,
-                                          const std::vector<int> &primeSums) {
-        std::mt19937 rng(m_seed);
+    static std::vector<int>
+    GeneratePermutations(uint64_t seed, const std::vector<int> &Primes,
+                         const std::vector<int> &primeSums) {
+        std::mt19937 rng(seed);
         std::vector<int> Permutations;
         Permutations.resize(primeSums.back());
 
@@ -44,7 +55,7 @@ private:
         return Permutations;
     }
 
-    std::vector<int> GeneratePrimes(int PrimeTableSize) {
+    static std::vector<int> GeneratePrimes(int PrimeTableSize) {
         // a table of bools will mark whether the number is prime or not
         std::vector<bool> isPrime(PrimeTableSize + 1, true);
         isPrime[0] = isPrime[1] = false; // 0 and 1 are not prime numbers.
@@ -66,12 +77,14 @@ private:
         return Primes;
     }
 
-    float OwenScrambledRadicalInverse(int baseIndex, int64_t a, int *perm) {
-        int base      = Primes[baseIndex];
+    float OwenScrambledRadicalInverse(int baseIndex, int64_t a,
+                                      const int *perm) const {
+        int base      = m_tables->Primes[baseIndex];
         float invBase = (float) 1 / (float) base, invBaseM = 1;
         uint64_t reversedDigits = 0;
         int digitIndex          = 0;
-        while (1 - invBaseM < 1) {
+        const int digitCount    = m_tables->digitCounts[baseIndex];
+        while (digitIndex < digitCount) {
             uint64_t next  = a / base;
             int digitValue = a - next * base;
             digitValue     = perm[digitValue];
@@ -83,8 +96,9 @@ private:
         return min(invBaseM * reversedDigits, 1 - Epsilon);
     }
 
-    float SampleDimension(int dimension, int index) {
-        int *perm = &Permutations[primeSums[dimension]];
+    float SampleDimension(int dimension, int index) const {
+        const int *perm =
+            &m_tables->Permutations[m_tables->primeSums[dimension]];
         return OwenScrambledRadicalInverse(dimension, index, perm);
     }
 
@@ -92,12 +106,25 @@ public:
     Halton(const Properties &properties) : Sampler(properties) {
         m_seed =
             properties.get<int>("seed", std::getenv("reference") ? 1337 : 420);
-        Primes = GeneratePrimes(PrimeTableSize);
-        primeSums.resize(Primes.size() + 1);
-        for (size_t i = 0; i < Primes.size(); ++i)
-            primeSums[i + 1] = primeSums[i] + Primes[i];
-        primeSum     = std::accumulate(Primes.begin(), Primes.end(), 0);
-        Permutations = GeneratePermutations(Primes, primeSums);
+        auto tables    = std::make_shared<Tables>();
+        tables->Primes = GeneratePrimes(PrimeTableSize);
+        tables->primeSums.resize(tables->Primes.size() + 1);
+        for (size_t i = 0; i < tables->Primes.size(); ++i)
+            tables->primeSums[i + 1] =
+                tables->primeSums[i] + tables->Primes[i];
+        tables->Permutations =
+            GeneratePermutations(m_seed, tables->Primes, tables->primeSums);
+        // this is counted with integers since unsafe math optimizations fold
+        // the equivalent float test (1 - invBaseM < 1) into one that never
+        // terminates in time
+        for (int base : tables->Primes) {
+            int digitCount = 0;
+            for (uint64_t range = 1; range < (uint64_t(1) << 24);
+                 range *= base)
+                digitCount++;
+            tables->digitCounts.push_back(digitCount);
+        }
+        m_tables = std::move(tables);
     }
 
     void seed(int sampleIndex) override {
@@ -119,8 +146,9 @@ public:
     }
 
     float next() override {
-        if (dimension >= (int) Primes.size()) {
-            dimension = dimension % (int) Primes.size();
+        const int primeCount = (int) m_tables->Primes.size();
+        if (dimension >= primeCount) {
+            dimension = dimension % primeCount;
         }
         float sample = SampleDimension(dimension, haltonIndex);
         dimension++;
@@ -0,0 +1,151 @@
+#include <lightwave.hpp>
+
+#include <array>
+
+// Reference:
+// "Parallel Random Numbers: As Easy as 1, 2, 3" [Salmon et al. 2011]
+namespace lightwave {
+
+/**
+ * @brief Generates random numbers with the counter-based Philox4x32-10
+ * generator. Every random number is a pure function of the pixel, the sample
+ * index and the dimension it is drawn for, so any part of a sample sequence
+ * can be generated directly without stepping through the numbers before it
+ * (e.g., to split sample ranges across machines or to resume renders).
+ */
+class Philox : public Sampler {
+public:
+    using Counter = std::array<uint32_t, 4>;
+    using Key     = std::array<uint32_t, 2>;
+
+    /// @brief The number of counters that @ref fill processes at once, which
+    /// allows the compiler to map them onto the lanes of vector registers.
+    static constexpr int Lanes = 8;
+
+private:
+    static constexpr uint32_t M0 = 0xd2511f53;
+    static constexpr uint32_t M1 = 0xcd9e8d57;
+    static constexpr uint32_t W0 = 0x9e3779b9;
+    static constexpr uint32_t W1 = 0xbb67ae85;
+    static constexpr int Rounds  = 10;
+
+    uint32_t m_seed;
+    Key m_key;
+    /// @brief The counter of the current sample, without the dimension.
+    Counter m_counter;
+    uint32_t m_dimension = 0;
+    /// @brief The four random numbers of the block that contains the current
+    /// dimension.
+    Counter m_block;
+
+    static float toUnitFloat(uint32_t x) {
+        return min(float(x >> 8) * 0x1p-24f, 1 - Epsilon);
+    }
+
+public:
+    /// @brief Produces four random 32-bit numbers for the given counter.
+    static Counter generate(Counter counter, Key key) {
+        for (int round = 0; round < Rounds; round++) {
+            const uint64_t product0 = uint64_t(M0) * counter[0];
+            const uint64_t product1 = uint64_t(M1) * counter[2];
+            counter = { uint32_t(product1 >> 32) ^ counter[1] ^ key[0],
+                        uint32_t(product1),
+                        uint32_t(product0 >> 32) ^ counter[3] ^ key[1],
+                        uint32_t(product0) };
+            key = { key[0] + W0, key[1] + W1 };
+        }
+        return counter;
+    }
+
+    Philox(const Properties &properties) : Sampler(properties) {
+        m_seed = properties.get<int>("seed",
+                                     std::getenv("reference") ? 1337 : 420);
+    }
+
+    void seed(int sampleIndex) override {
+        // sequences and pixels use different keys so they never overlap
+        m_key       = { m_seed, 1 };
+        m_counter   = { 0, uint32_t(sampleIndex), 0, 0 };
+        m_dimension = 0;
+    }
+
+    void seed(const Point2i &pixel, int sampleIndex) override {
+        m_key       = { m_seed, 0 };
+        m_counter   = { 0,
+                        uint32_t(sampleIndex),
+                        uint32_t(pixel.x()),
+                        uint32_t(pixel.y()) };
+        m_dimension = 0;
+    }
+
+    float next() override {
+        if (m_dimension % 4 == 0) {
+            Counter counter = m_counter;
+            counter[0]      = m_dimension / 4;
+            m_block         = generate(counter, m_key);
+        }
+        return toUnitFloat(m_block[m_dimension++ % 4]);
+    }
+
+    void fill(std::span<float> values) override {
+        size_t index = 0;
+        // finish the current block first
+        while (index < values.size() && m_dimension % 4 != 0)
+            values[index++] = next();
+
+        constexpr size_t BatchSize = 4 * Lanes;
+        while (values.size() - index >= BatchSize) {
+            // the rounds are written lane by lane (structure of arrays) so
+            // that all lanes are computed with the same vector instructions
+            uint32_t c0[Lanes], c1[Lanes], c2[Lanes], c3[Lanes];
+            for (int lane = 0; lane < Lanes; lane++) {
+                c0[lane] = m_dimension / 4 + lane;
+                c1[lane] = m_counter[1];
+                c2[lane] = m_counter[2];
+                c3[lane] = m_counter[3];
+            }
+            Key key = m_key;
+            for (int round = 0; round < Rounds; round++) {
+                for (int lane = 0; lane < Lanes; lane++) {
+                    const uint64_t product0 = uint64_t(M0) * c0[lane];
+                    const uint64_t product1 = uint64_t(M1) * c2[lane];
+                    const uint32_t next0 =
+                        uint32_t(product1 >> 32) ^ c1[lane] ^ key[0];
+                    const uint32_t next2 =
+                        uint32_t(product0 >> 32) ^ c3[lane] ^ key[1];
+                    c1[lane] = uint32_t(product1);
+                    c3[lane] = uint32_t(product0);
+                    c0[lane] = next0;
+                    c2[lane] = next2;
+                }
+                key = { key[0] + W0, key[1] + W1 };
+            }
+            for (int lane = 0; lane < Lanes; lane++) {
+                values[index + 4 * lane + 0] = toUnitFloat(c0[lane]);
+                values[index + 4 * lane + 1] = toUnitFloat(c1[lane]);
+                values[index + 4 * lane + 2] = toUnitFloat(c2[lane]);
+                values[index + 4 * lane + 3] = toUnitFloat(c3[lane]);
+            }
+            index += BatchSize;
+            m_dimension += BatchSize;
+        }
+
+        while (index < values.size())
+            values[index++] = next();
+    }
+
+    ref<Sampler> clone() const override {
+        return std::make_shared<Philox>(*this);
+    }
+
+    std::string toString() const override {
+        return tfm::format("Philox[\n"
+                           "  count = %d\n"
+                           "]",
+                           m_samplesPerPixel);
+    }
+};
+
+} // namespace lightwave
+
+REGISTER_SAMPLER(Philox, "philox")
@@ -0,0 +1,209 @@
+#include <lightwave.hpp>
+
+#include <array>
+
+// Reference:
+// "Practical Hash-based Owen Scrambling" [Burley 2020]
+// https://jcgt.org/published/0009/04/01/
+namespace lightwave {
+
+namespace {
+
+/// @brief The generator matrix of the second Sobol dimension (which uses the
+/// primitive polynomial x + 1), stored as one 32-bit column per bit of the
+/// sample index. Together with the van der Corput sequence as first
+/// dimension, it forms a (0,2)-sequence, i.e., every power of two prefix is
+/// stratified in 2D.
+constexpr std::array<uint32_t, 32> SobolMatrix = [] {
+    std::array<uint32_t, 32> matrix{};
+    matrix[0] = 1u << 31;
+    for (int bit = 1; bit < 32; bit++)
+        matrix[bit] = matrix[bit - 1] ^ (matrix[bit - 1] >> 1);
+    return matrix;
+}();
+
+/// @brief The products of the generator matrix with every byte of the sample
+/// index, so that a sample takes four lookups instead of a loop over bits.
+constexpr std::array<std::array<uint32_t, 256>, 4> SobolTable = [] {
+    std::array<std::array<uint32_t, 256>, 4> table{};
+    for (int byte = 0; byte < 4; byte++) {
+        for (int value = 0; value < 256; value++) {
+            for (int bit = 0; bit < 8; bit++) {
+                if (value & (1 << bit))
+                    table[byte][value] ^= SobolMatrix[8 * byte + bit];
+            }
+        }
+    }
+    return table;
+}();
+
+inline uint32_t reverseBits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+/// @brief A hash that only propagates changes from lower to higher bits, as
+/// needed for Owen scrambling of bit-reversed values.
+inline uint32_t laineKarrasPermutation(uint32_t x, uint32_t seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+/// @brief Owen scrambling: every bit is flipped depending on all more
+/// significant bits, which randomizes the sequence while keeping its
+/// stratification intact.
+inline uint32_t nestedUniformScramble(uint32_t x, uint32_t seed) {
+    return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+}
+
+inline uint32_t hashCombine(uint32_t seed, uint32_t value) {
+    return seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+/// @brief A 32-bit integer finalizer with good avalanche behavior.
+inline uint32_t mix(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/// @brief The second Sobol dimension (the first one is simply the bit
+/// reversed index).
+inline uint32_t sobol(uint32_t index) {
+    return SobolTable[0][index & 0xff] ^ SobolTable[1][(index >> 8) & 0xff] ^
+           SobolTable[2][(index >> 16) & 0xff] ^ SobolTable[3][index >> 24];
+}
+
+/// @brief Interleaves the bits of the coordinates, such that neighboring
+/// pixels (mostly) have neighboring indices.
+inline uint32_t morton(uint32_t x, uint32_t y) {
+    const auto spread = [](uint32_t v) {
+        v &= 0xffff;
+        v = (v | (v << 8)) & 0x00ff00ffu;
+        v = (v | (v << 4)) & 0x0f0f0f0fu;
+        v = (v | (v << 2)) & 0x33333333u;
+        v = (v | (v << 1)) & 0x55555555u;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+inline float toUnitFloat(uint32_t x) {
+    return min(float(x) * 0x1p-32f, 1 - Epsilon);
+}
+
+} // namespace
+
+/**
+ * @brief Generates an Owen-scrambled Sobol sequence. Since high-dimensional
+ * Sobol sequences converge poorly at low sample counts, every pair of
+ * dimensions draws from its own independently scrambled and shuffled 2D Sobol
+ * sequence instead ("padding"), so arbitrarily deep paths can be sampled
+ * without wrapping around.
+ *
+ * In blue noise mode, all pixels share one sequence instead: pixels are
+ * ordered along a randomly flipped Morton curve and each takes the next
+ * @c count samples. Since every aligned power of two block of samples is
+ * stratified, neighboring pixels receive complementary samples, which
+ * distributes the error as blue noise in screen space and makes low sample
+ * counts look much less noisy.
+ * @see "Screen-Space Blue-Noise Diffusion of Monte Carlo Sampling Error via
+ * Hierarchical Ordering of Pixels" [Ahmed and Wonka 2020]
+ */
+class Sobol : public Sampler {
+    uint32_t m_seed;
+    /// @brief The seed of the current pixel (or sequence).
+    uint32_t m_sequenceSeed = 0;
+    uint32_t m_index        = 0;
+    uint32_t m_dimension    = 0;
+    bool m_blueNoise;
+    /// @brief The number of samples reserved for each pixel in blue noise
+    /// mode (the sample count rounded up to a power of two).
+    uint32_t m_stride = 1;
+
+    /// @brief Draws a point of the padded 2D sequence for the next dimension.
+    Point2 sample2D() {
+        const uint32_t seed = mix(hashCombine(m_sequenceSeed, m_dimension++));
+        // shuffling the index decorrelates the dimensions from another
+        const uint32_t index = nestedUniformScramble(m_index, seed);
+        // for the first dimension, the bit reversals of the van der Corput
+        // sequence and of the scramble cancel out
+        return {
+            toUnitFloat(reverseBits(
+                laineKarrasPermutation(index, hashCombine(seed, 0)))),
+            toUnitFloat(
+                nestedUniformScramble(sobol(index), hashCombine(seed, 1))),
+        };
+    }
+
+public:
+    Sobol(const Properties &properties) : Sampler(properties) {
+        m_seed = properties.get<int>("seed",
+                                     std::getenv("reference") ? 1337 : 420);
+        m_blueNoise = properties.get<bool>("blueNoise", false);
+        while (m_stride < uint32_t(m_samplesPerPixel))
+            m_stride *= 2;
+    }
+
+    void seed(int sampleIndex) override {
+        m_sequenceSeed = mix(m_seed);
+        m_index        = sampleIndex;
+        m_dimension    = 0;
+    }
+
+    void seed(const Point2i &pixel, int sampleIndex) override {
+        m_dimension = 0;
+        if (!m_blueNoise) {
+            m_sequenceSeed =
+                uint32_t(hash::fnv1a(pixel.x(), pixel.y(), m_seed));
+            m_index = sampleIndex;
+            return;
+        }
+
+        // samples beyond the sample count (e.g., from additional rendering
+        // passes) continue in further sequences with the same layout
+        const uint32_t pass = uint32_t(sampleIndex) / m_stride;
+        m_sequenceSeed      = mix(hashCombine(m_seed, pass));
+        const uint32_t order =
+            nestedUniformScramble(morton(pixel.x(), pixel.y()), m_sequenceSeed);
+        const uint64_t index = uint64_t(order) * m_stride +
+                               uint32_t(sampleIndex) % m_stride;
+        // indices beyond the 2^32 points of the sequence continue in further
+        // independently scrambled sequences (every aligned block of samples
+        // still lies within one sequence)
+        m_index = uint32_t(index);
+        if (index >> 32)
+            m_sequenceSeed =
+                mix(hashCombine(m_sequenceSeed, uint32_t(index >> 32)));
+    }
+
+    float next() override { return sample2D().x(); }
+    Point2 next2D() override { return sample2D(); }
+
+    ref<Sampler> clone() const override {
+        return std::make_shared<Sobol>(*this);
+    }
+
+    std::string toString() const override {
+        return tfm::format("Sobol[\n"
+                           "  count = %d,\n"
+                           "  blueNoise = %s\n"
+                           "]",
+                           m_samplesPerPixel,
+                           m_blueNoise);
+    }
+};
+
+} // namespace lightwave
+
+REGISTER_SAMPLER(Sobol, "sobol")
@@ -1,10 +1,14 @@
 #pragma once
 
 #include <lightwave/core.hpp>
+#include <lightwave/dispatch.hpp>
 #include <lightwave/math.hpp>
 #include <lightwave/shape.hpp>
 
+#include "../core/buffer.hpp"
+
 #include <numeric>
+#include <utility>
 
 namespace lightwave {
 
@@ -29,6 +33,7 @@ namespace lightwave {
  * @see TriangleMesh
  */
 class AccelerationStructure : public Shape {
+protected:
     /// @brief The datatype used to index BVH nodes and the primitive index
     /// remapping.
     typedef int32_t NodeIndex;
@@ -71,8 +76,9 @@ class AccelerationStructure : public Shape {
         }
     };
 
+private:
     /// @brief A list of all BVH nodes.
-    std::vector<Node> m_nodes;
+    Buffer<Node> m_nodes;
     /**
      * @brief Mapping from internal @c NodeIndex to @c primitiveIndex as used by
      * all interface methods. For efficient storage, we assume that children of
@@ -82,7 +88,7 @@ class AccelerationStructure : public Shape {
      * 1 @endcode ), which allows us to translate from re-ordered (contiguous)
      * indices to the indices the user of this class expects.
      */
-    std::vector<int> m_primitiveIndices;
+    Buffer<int> m_primitiveIndices;
 
     /// @brief Returns the root BVH node.
     const Node &rootNode() const {
@@ -90,55 +96,9 @@ class AccelerationStructure : public Shape {
         return m_nodes.front();
     }
 
-    /**
-     * @brief Intersects a BVH node, recursing into children (for internal
-     * nodes), or intersecting all primitives (for leaf nodes).
-     */
-    bool intersectNode(const Node &node, const Ray &ray, Intersection &its,
-                       Sampler &rng) const {
-        // update the statistic tracking how many BVH nodes have been tested for
-        // intersection
-        its.stats.bvhCounter++;
-
-        bool wasIntersected = false;
-        if (node.isLeaf()) {
-            for (NodeIndex i = 0; i < node.primitiveCount; i++) {
-                // update the statistic tracking how many children have been
-                // tested for intersection
-                its.stats.primCounter++;
-                // test the child for intersection
-                wasIntersected |= intersect(
-                    m_primitiveIndices[node.leftFirst + i], ray, its, rng);
-            }
-        } else { // internal node
-            // test which bounding box is intersected first by the ray.
-            // this allows us to traverse the children in the order they are
-            // intersected in, which can help prune a lot of unnecessary
-            // intersection tests.
-            const auto leftT =
-                intersectAABB(m_nodes[node.leftChildIndex()].aabb, ray);
-            const auto rightT =
-                intersectAABB(m_nodes[node.rightChildIndex()].aabb, ray);
-            if (leftT < rightT) { // left child is hit first; test left child
-                                  // first, then right child
-                if (leftT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.leftChildIndex()], ray, its, rng);
-                if (rightT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.rightChildIndex()], ray, its, rng);
-            } else { // right child is hit first; test right child first, then
-                     // left child
-                if (rightT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.rightChildIndex()], ray, its, rng);
-                if (leftT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.leftChildIndex()], ray, its, rng);
-            }
-        }
-        return wasIntersected;
-    }
+    /// @brief The maximum depth of the BVH, which bounds the size of the
+    /// traversal stack.
+    static constexpr int MaxDepth = 64;
 
     /// @brief Performs a slab test to intersect a bounding box with a ray,
     /// returning Infinity in case the ray misses.
@@ -257,9 +217,10 @@ class AccelerationStructure : public Shape {
     }
 
     /// @brief Attempts to subdivide a given BVH node.
-    void subdivide(Node &parent) {
-        // only subdivide if enough children are available.
-        if (parent.primitiveCount <= 2) {
+    void subdivide(Node &parent, int depth) {
+        // only subdivide if enough children are available, and as long as the
+        // traversal stack can hold the tree.
+        if (parent.primitiveCount <= 2 || depth >= MaxDepth) {
             return;
         }
 
@@ -325,10 +286,10 @@ class AccelerationStructure : public Shape {
 
         // first, process the left child node (and all of its children)
         computeAABB(m_nodes[leftChildIndex]);
-        subdivide(m_nodes[leftChildIndex]);
+        subdivide(m_nodes[leftChildIndex], depth + 1);
         // then, process the right child node (and all of its children)
         computeAABB(m_nodes[rightChildIndex]);
-        subdivide(m_nodes[rightChildIndex]);
+        subdivide(m_nodes[rightChildIndex], depth + 1);
     }
 
 protected:
@@ -344,6 +305,99 @@ protected:
     /// @brief Returns the centroid of the given child.
     virtual Point getCentroid(int primitiveIndex) const = 0;
 
+    /**
+     * @brief Traverses the BVH front to back, calling @c intersectSlot for
+     * all primitives of the leaf nodes that are reached. Uses an explicit
+     * stack instead of recursion, so that the traversal can be compiled for
+     * different instruction sets (see @ref LW_DISPATCH ).
+     * @param intersectSlot Intersects the primitive stored at the given
+     * position of the leaf order (see @ref primitiveIndex ) and returns
+     * whether it was hit, in which case it must have updated @c its.t .
+     */
+    template <typename IntersectSlot>
+    bool traverseNodes(const Ray &ray, Intersection &its,
+                       IntersectSlot &&intersectSlot) const {
+        // the nodes that still need to be visited, and the distances at which
+        // the ray enters their bounding boxes
+        struct StackEntry {
+            NodeIndex node;
+            float t;
+        };
+        StackEntry stack[MaxDepth];
+        int stackSize = 0;
+
+        bool wasIntersected = false;
+        const Node *node    = &rootNode();
+        while (true) {
+            // update the statistic tracking how many BVH nodes have been
+            // tested for intersection
+            its.stats.bvhCounter++;
+
+            if (node->isLeaf()) {
+                for (NodeIndex i = 0; i < node->primitiveCount; i++) {
+                    // update the statistic tracking how many children have
+                    // been tested for intersection
+                    its.stats.primCounter++;
+                    // test the child for intersection
+                    wasIntersected |= intersectSlot(node->leftFirst + i);
+                }
+            } else { // internal node
+                // test which bounding box is intersected first by the ray.
+                // this allows us to traverse the children in the order they
+                // are intersected in, which can help prune a lot of
+                // unnecessary intersection tests.
+                NodeIndex first  = node->leftChildIndex();
+                NodeIndex second = node->rightChildIndex();
+                float firstT     = intersectAABB(m_nodes[first].aabb, ray);
+                float secondT    = intersectAABB(m_nodes[second].aabb, ray);
+                if (!(firstT < secondT)) {
+                    std::swap(first, second);
+                    std::swap(firstT, secondT);
+                }
+
+                if (firstT < its.t) {
+                    if (secondT < its.t)
+                        stack[stackSize++] = { second, secondT };
+                    node = &m_nodes[first];
+                    continue;
+                }
+            }
+
+            // continue with the next node that might still contain a closer
+            // intersection
+            do {
+                if (stackSize == 0)
+                    return wasIntersected;
+                stackSize--;
+            } while (!(stack[stackSize].t < its.t));
+            node = &m_nodes[stack[stackSize].node];
+        }
+    }
+
+    /// @brief Traverses the BVH, intersecting the children through @ref
+    /// intersect(int, const Ray &, Intersection &, Sampler &) const .
+    bool traverseImpl(const Ray &ray, Intersection &its, Sampler &rng) const {
+        return traverseNodes(ray, its, [&](int slot) {
+            return intersect(m_primitiveIndices[slot], ray, its, rng);
+        });
+    }
+
+    LW_DISPATCH(bool, traverse,
+                (const Ray &ray, Intersection &its, Sampler &rng) const,
+                (ray, its, rng))
+
+    /// @brief The child stored at the given position of the leaf order, in
+    /// which the primitives of each leaf node are contiguous.
+    int primitiveIndex(int slot) const { return m_primitiveIndices[slot]; }
+
+    /// @brief Whether the ray can hit any child closer than @c its.t .
+    bool mayIntersect(const Ray &ray, const Intersection &its) const {
+        if (m_primitiveIndices.empty())
+            return false; // exit early if no children exist
+        // test root bounding box for potential hit
+        return intersectAABB(rootNode().aabb, ray) < its.t;
+    }
+
     /// @brief Builds the acceleration structure.
     void buildAccelerationStructure() {
         Timer buildTimer;
@@ -357,7 +411,7 @@ protected:
         root.leftFirst      = 0;
         root.primitiveCount = numberOfPrimitives();
         computeAABB(root);
-        subdivide(root);
+        subdivide(root, 1);
 
         logger(EInfo,
                "built BVH with %ld nodes for %ld primitives in %.1f ms",
@@ -366,15 +420,69 @@ protected:
                buildTimer.getElapsedTime() * 1000);
     }
 
+    /// @brief Grows the bounding boxes of all BVH nodes, e.g., after the
+    /// children were moved slightly by quantization.
+    void expandBounds(const Vector &margin) {
+        for (Node &node : m_nodes)
+            node.aabb = Bounds(node.aabb.min() - margin,
+                               node.aabb.max() + margin);
+    }
+
+    /// @brief The BVH nodes, which can be stored together with @ref
+    /// primitiveOrder to skip building the acceleration structure later on.
+    const Buffer<Node> &nodes() const { return m_nodes; }
+    /// @brief The order in which leaf nodes refer to the children.
+    const Buffer<int> &primitiveOrder() const { return m_primitiveIndices; }
+
+    /**
+     * @brief Uses an acceleration structure that was previously built for the
+     * same children (see @ref nodes and @ref primitiveOrder ) instead of
+     * building one. Throws if the structure is inconsistent, so that corrupted
+     * files cannot cause out-of-bounds accesses during traversal.
+     */
+    void useAccelerationStructure(Buffer<Node> nodes,
+                                  Buffer<int> primitiveIndices) {
+        const int primitiveCount = numberOfPrimitives();
+        const auto invalid       = [] {
+            lightwave_throw("acceleration structure does not match the shape");
+        };
+        if (nodes.empty() || primitiveIndices.size() != size_t(primitiveCount))
+            invalid();
+        // only read through const references, since writable access would
+        // copy memory-mapped buffers
+        for (int index : std::as_const(primitiveIndices)) {
+            if (index < 0 || index >= primitiveCount)
+                invalid();
+        }
+        // children always follow their parents, which allows computing the
+        // depth of all nodes in a single pass (shapes without children only
+        // have an empty root node, which is never traversed)
+        std::vector<int> depth(nodes.size(), 1);
+        for (size_t i = 0; primitiveCount > 0 && i < nodes.size(); i++) {
+            const Node &node = std::as_const(nodes)[i];
+            if (node.isLeaf()) {
+                if (node.leftFirst < 0 || node.primitiveCount < 0 ||
+                    node.leftFirst > primitiveCount - node.primitiveCount)
+                    invalid();
+            } else {
+                if (node.leftFirst <= NodeIndex(i) ||
+                    size_t(node.leftFirst) + 1 >= nodes.size() ||
+                    depth[i] >= MaxDepth)
+                    invalid();
+                depth[node.leftFirst] = depth[node.leftFirst + 1] =
+                    depth[i] + 1;
+            }
+        }
+
+        m_nodes            = std::move(nodes);
+        m_primitiveIndices = std::move(primitiveIndices);
+    }
+
 public:
     bool intersect(const Ray &ray, Intersection &its,
                    Sampler &rng) const override {
-        if (m_primitiveIndices.empty())
-            return false; // exit early if no children exist
-        if (intersectAABB(rootNode().aabb, ray) < its.t) // test root
-                                                         // bounding box for
-                                                         // potential hit
-            return intersectNode(rootNode(), ray, its, rng);
+        if (mayIntersect(ray, its))
+            return traverse(ray, its, rng);
         return false;
     }
 
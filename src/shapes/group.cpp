@@ -1,6 +1,9 @@
 #include <lightwave.hpp>
 
 #include "accel.hpp"
+#include "mesh.hpp"
+
+#include <unordered_map>
 
 namespace lightwave {
 
@@ -13,6 +16,240 @@ namespace lightwave {
  */
 class Group final : public AccelerationStructure {
     std::vector<ref<Shape>> m_children;
+    /// @brief Instances that were merged into a single mesh by @ref flatten ,
+    /// which the merged mesh reports for hits.
+    std::vector<ref<Instance>> m_flattened;
+
+    /// @brief How a child is intersected during traversal.
+    enum class LeafKind : uint8_t {
+        /// @brief Through the virtual intersect of the child.
+        Generic,
+        /// @brief Through its @ref InlinePrimitive .
+        Inline,
+        /// @brief Through its @ref Instance::Compiled record.
+        Compiled,
+    };
+
+    /// @brief How a child is intersected, and where its data is stored.
+    struct Slot {
+        LeafKind kind;
+        /// @brief The index into @c m_inline or @c m_compiled (depending on
+        /// the kind), or into @c m_children for generic children.
+        uint32_t index;
+    };
+
+    /// @brief The slot of each child in the leaf order of the BVH (empty if
+    /// all children are intersected generically).
+    std::vector<Slot> m_slots;
+    /// @brief Descriptions of the children that are intersected inline, in
+    /// leaf order (so that the children of a leaf are contiguous in memory).
+    std::vector<InlinePrimitive> m_inline;
+    /// @brief Records of the instances among the children, in leaf order.
+    std::vector<Instance::Compiled> m_compiled;
+    /// @brief The shapes referred to by @c m_compiled .
+    std::vector<const Shape *> m_shapes;
+    /// @brief The instances referred to by @c m_compiled .
+    std::vector<const Instance *> m_instances;
+    /// @brief Whether any child is not intersected generically.
+    bool m_compiledAny = false;
+
+    /// @brief Intersects the shape of a compiled instance, which only needs to
+    /// access the instance itself for hits.
+    bool intersectCompiled(const Instance::Compiled &record, const Ray &ray,
+                           Intersection &its, Sampler &rng) const {
+        const float previousT = its.t;
+        float scale;
+        const Ray localRay = record.toObjectRay(ray, scale);
+        its.t *= scale;
+        if (!m_shapes[record.shape]->intersect(localRay, its, rng)) {
+            its.t = previousT;
+            return false;
+        }
+        return m_instances[record.instance]->completeIntersection(
+            its, previousT, scale, rng);
+    }
+
+    /**
+     * @brief Traverses the BVH, intersecting each child according to its @ref
+     * LeafKind . Inline tests only find the distance to the closest hit; the
+     * child that was hit closest then computes the full intersection once
+     * traversal is done.
+     */
+    bool traverseCompiledImpl(const Ray &ray, Intersection &its,
+                              Sampler &rng) const {
+        const float tMax = its.t;
+        int closestSlot  = -1;
+        const bool wasIntersected = traverseNodes(ray, its, [&](int slot) {
+            const Slot &entry = m_slots[slot];
+            switch (entry.kind) {
+            case LeafKind::Inline: {
+                const float t = m_inline[entry.index].intersect(ray, its.t);
+                if (!(t < its.t))
+                    return false;
+                its.t       = t;
+                closestSlot = slot;
+                return true;
+            }
+            case LeafKind::Compiled:
+                if (!intersectCompiled(m_compiled[entry.index], ray, its, rng))
+                    return false;
+                break;
+            default:
+                if (!m_children[entry.index]->intersect(ray, its, rng))
+                    return false;
+                break;
+            }
+            closestSlot = -1; // its now describes this child
+            return true;
+        });
+
+        if (closestSlot < 0)
+            return wasIntersected;
+
+        its.t = tMax;
+        if (m_children[primitiveIndex(closestSlot)]->intersect(ray, its, rng))
+            return true;
+        // the inline test and the child disagree due to rounding (e.g., at
+        // edges), fall back to regular traversal
+        return traverse(ray, its, rng);
+    }
+
+    LW_DISPATCH(bool, traverseCompiled,
+                (const Ray &ray, Intersection &its, Sampler &rng) const,
+                (ray, its, rng))
+
+    /**
+     * @brief Merges untransformed instances of small meshes into a single mesh
+     * with one BVH over all their triangles, which saves rays from traversing
+     * a BVH per mesh and passing through an instance in between.
+     * @param threshold The maximal number of triangles of meshes that are
+     * merged (0 disables merging). Meshes that are shared by several
+     * instances are never merged, so that instancing keeps saving memory.
+     */
+    void flatten(int threshold) {
+        if (threshold <= 0)
+            return;
+
+        // count how often each shape is instanced
+        std::unordered_map<const Shape *, int> instanceCounts;
+        for (const auto &child : m_children) {
+            if (const auto instance = dynamic_cast<Instance *>(child.get()))
+                instanceCounts[instance->shape()]++;
+        }
+
+        std::vector<TriangleMesh::Part> parts;
+        std::vector<ref<Shape>> remaining;
+        int triangles = 0;
+        for (const auto &child : m_children) {
+            const auto instance = std::dynamic_pointer_cast<Instance>(child);
+            const auto mesh =
+                instance ? dynamic_cast<const TriangleMesh *>(instance->shape())
+                         : nullptr;
+            if (!mesh ||
+                instance->transformKind() != Instance::TransformKind::Identity ||
+                instance->alpha() || instanceCounts[mesh] > 1 ||
+                mesh->numberOfTriangles() > threshold) {
+                remaining.push_back(child);
+                continue;
+            }
+            parts.push_back({ instance.get(), mesh });
+            m_flattened.push_back(instance);
+            triangles += mesh->numberOfTriangles();
+        }
+
+        if (parts.size() < 2) {
+            m_flattened.clear();
+            return; // nothing to be gained
+        }
+
+        const auto merged = std::make_shared<TriangleMesh>(parts);
+        // the instances no longer hold on to their original meshes, so that
+        // these are released instead of being kept in addition to the copy
+        for (const auto &instance : m_flattened)
+            instance->mergeInto(merged);
+        remaining.push_back(merged);
+        m_children = std::move(remaining);
+        logger(EInfo,
+               "flattened %d instances with %d triangles into a single mesh",
+               parts.size(),
+               triangles);
+    }
+
+    /// @brief The memory that the group allocates for its children, its BVH
+    /// and the compiled data.
+    size_t memoryUsage() const {
+        return m_children.capacity() * sizeof(ref<Shape>) +
+               m_flattened.capacity() * sizeof(ref<Instance>) +
+               nodes().size() * sizeof(Node) +
+               primitiveOrder().size() * sizeof(int) +
+               m_slots.capacity() * sizeof(Slot) +
+               m_inline.capacity() * sizeof(InlinePrimitive) +
+               m_compiled.capacity() * sizeof(Instance::Compiled) +
+               m_shapes.capacity() * sizeof(const Shape *) +
+               m_instances.capacity() * sizeof(const Instance *);
+    }
+
+    /**
+     * @brief Lays out the data needed to intersect the children in leaf order,
+     * so that traversal does not need to follow pointers to them: simple
+     * shapes become inline primitives, and instances become compiled records
+     * that refer to shapes and instances by index. Only the children of each
+     * kind occupy space in its array.
+     */
+    void compile() {
+        const size_t before = memoryUsage();
+        const int count     = int(m_children.size());
+        m_slots.resize(count);
+
+        std::unordered_map<const Shape *, uint32_t> shapeIndices;
+        for (int slot = 0; slot < count; slot++) {
+            const int child = primitiveIndex(slot);
+            const InlinePrimitive primitive =
+                m_children[child]->inlinePrimitive();
+            if (primitive.type != InlinePrimitive::Type::None) {
+                m_slots[slot] = { LeafKind::Inline, uint32_t(m_inline.size()) };
+                m_inline.push_back(primitive);
+                continue;
+            }
+
+            const auto instance =
+                dynamic_cast<const Instance *>(m_children[child].get());
+            if (!instance) {
+                m_slots[slot] = { LeafKind::Generic, uint32_t(child) };
+                continue;
+            }
+            const auto [it, inserted] = shapeIndices.try_emplace(
+                instance->intersectedShape(), uint32_t(m_shapes.size()));
+            if (inserted)
+                m_shapes.push_back(instance->intersectedShape());
+
+            Instance::Compiled record = instance->compile();
+            record.shape              = it->second;
+            record.instance           = uint32_t(m_instances.size());
+            m_slots[slot] = { LeafKind::Compiled, uint32_t(m_compiled.size()) };
+            m_compiled.push_back(record);
+            m_instances.push_back(instance);
+        }
+
+        m_compiledAny = !m_inline.empty() || !m_compiled.empty();
+        if (!m_compiledAny) {
+            // generic traversal does not need any of this
+            m_slots = {};
+            return;
+        }
+        m_inline.shrink_to_fit();
+        m_compiled.shrink_to_fit();
+        m_shapes.shrink_to_fit();
+        m_instances.shrink_to_fit();
+        logger(EInfo,
+               "compiled %d inline primitives and %d instances over %d "
+               "shapes (%.1f KiB allocated before compilation, %.1f KiB after)",
+               m_inline.size(),
+               m_compiled.size(),
+               m_shapes.size(),
+               before / 1024.f,
+               memoryUsage() / 1024.f);
+    }
 
 protected:
     int numberOfPrimitives() const override { return int(m_children.size()); }
@@ -33,12 +270,26 @@ protected:
 public:
     Group(const Properties &properties) {
         m_children = properties.getChildren<Shape>();
+        flatten(properties.get<int>("flatten", 0));
         buildAccelerationStructure();
+
+        compile();
+    }
+
+    bool intersect(const Ray &ray, Intersection &its,
+                   Sampler &rng) const override {
+        if (!m_compiledAny)
+            return AccelerationStructure::intersect(ray, its, rng);
+        if (mayIntersect(ray, its))
+            return traverseCompiled(ray, its, rng);
+        return false;
     }
 
     void markAsVisible() override {
         for (auto &child : m_children)
             child->markAsVisible();
+        for (auto &instance : m_flattened)
+            instance->markAsVisible();
     }
 
     AreaSample sampleArea(Sampler &rng) const override {
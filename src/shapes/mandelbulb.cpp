@@ -1,81 +1,43 @@
-#include <cmath>
-#include <lightwave.hpp>
-#include <memory>
-#include <vector>
+#include "sdf.hpp"
+
+#include <lightwave/fastmath.hpp>
 
 namespace lightwave {
 
-class MandelBulb : public Shape {
+class MandelBulb : public SignedDistanceField {
     int n; // Power exponent for the MandelBulb calculation
 
+    /// @brief Radius of a sphere around the origin that contains the surface.
+    float m_radius;
+
 public:
-    MandelBulb(const Properties &properties) {
+    MandelBulb(const Properties &properties)
+        : SignedDistanceField(properties, 300000) {
         n = properties.get<float>("n", 8);
+        // all points c with |c| > 2^(1/(n-1)) escape, since the magnitude of
+        // the iterates then grows with every iteration; the margin accounts
+        // for points that do not reach the bailout within the iteration limit
+        m_radius = 1.1f * std::pow(2.f, 1.f / std::max(n - 1, 1));
+        buildDistanceGrid();
     }
 
-    // https://iquilezles.org/articles/normalsSDF/
-    Vector computeNormal(const Point &p) const {
-        std::cout << "Computing normal at Point: (" << p[0] << ", " << p[1]
-                  << ", " << p[2] << ")" << std::endl;
-        const float h = 0.00001f; // Small step
-        return
-            // Vector(            // central differences
-            //     (getMandelbulbDistance(Point(p[0] + h, p[1], p[2])) -
-            //      getMandelbulbDistance(Point(p[0] - h, p[1], p[2]))) /
-            //         2,
-            //     (getMandelbulbDistance(Point(p[0], p[1] + h, p[2])) -
-            //      getMandelbulbDistance(Point(p[0], p[1] - h, p[2]))) /
-            //         2,
-            //     (getMandelbulbDistance(Point(p[0], p[1], p[2] + h)) -
-            //      getMandelbulbDistance(Point(p[0], p[1], p[2] - h))) /
-            //         2);
-
-            Vector( // forward differences (more efficient)
-                getMandelbulbDistance(Point(p[0] + h, p[1], p[2])),
-                getMandelbulbDistance(Point(p[0], p[1] + h, p[2])),
-                getMandelbulbDistance(Point(p[0], p[1], p[2] + h)));
-    }
-
-    bool intersect(const Ray &ray, Intersection &its,
-                   Sampler &rng) const override {
-        const int MAX_STEPS = 300000; // Number of steps for the SDF
-        const float MAX_DIST =
-            20.0f; // Maximum distance to consider an intersection
-        // const float Epsilon = 0.000001f;
-
-        Point currentPos    = ray.origin;
-        float totalDistance = 0;
-        float dist          = std::numeric_limits<float>::max();
-        for (int i = 0; i < MAX_STEPS && totalDistance < MAX_DIST; ++i) {
-            dist = getMandelbulbDistance(currentPos);
-            currentPos += ray.direction * dist;
-            totalDistance += abs(dist);
-            if (dist < Epsilon) {
-                break;
-            }
-        }
-        if (dist < Epsilon && totalDistance > Epsilon) {
-            its.position = currentPos;
-            its.t        = totalDistance;
-            its.geometryNormal =
-                Vector(currentPos)
-                    .normalized(); // computeNormal(currentPos).normalized();
-            its.shadingNormal = its.geometryNormal;
-
-            Vector up = { 0, 1, 0 };
-            if (abs(its.geometryNormal[1]) > 0.99f) {
-                up = { 1, 0, 0 }; // Use a horizontal vector if the normal is
-                                  // close
-            }
-            its.tangent = its.geometryNormal.cross(up).normalized();
-            return true;
-        }
-        return false;
+    bool clip(const Ray &ray, float &tNear, float &tFar) const override {
+        // the bounding sphere is tighter than the bounding box
+        const Vector oc = Vector(ray.origin);
+        const float b   = oc.dot(ray.direction);
+        const float c   = oc.lengthSquared() - sqr(m_radius);
+        const float discriminant = b * b - c;
+        if (discriminant < 0)
+            return false;
+        const float sqrtDiscriminant = std::sqrt(discriminant);
+        tNear = std::max(-b - sqrtDiscriminant, 0.f);
+        tFar  = -b + sqrtDiscriminant;
+        return tNear < tFar;
     }
 
     // Code modified from:
     // http://blog.hvidtfeldts.net/index.php/2011/09/distance-estimated-3d-fractals-v-the-mandelbulb-different-de-approximations/
-    float getMandelbulbDistance(const Point &p) const {
+    float distance(const Point &p) const override {
         Vector z = Vector(p);
         float dr = 1.0;
         float r  = 0.0;
@@ -89,38 +51,43 @@ public:
                 break;
 
             // Spherical coordinates
-            float theta = acos(z[0] / r);
-            float phi   = atan2(z[1], z[0]);
+            float theta = fast::acos(z[0] / r);
+            float phi   = fast::atan2(z[1], z[0]);
             // Update the distance
-            dr = pow(r, n - 1) * n * dr + 1.0;
+            const float rPow = fast::pow(r, n - 1);
+            dr               = rPow * n * dr + 1.0;
 
             // Scale and rotate the point
-            float zr = pow(r, n);
+            float zr = rPow * r;
             theta    = theta * n;
             phi      = phi * n;
 
             // Put in cartesian coordinates
-            z = zr * Vector(sin(theta) * cos(phi),
-                            sin(phi) * sin(theta),
-                            cos(theta));
+            float sinTheta, cosTheta, sinPhi, cosPhi;
+            fast::sincos(theta, sinTheta, cosTheta);
+            fast::sincos(phi, sinPhi, cosPhi);
+            z = zr * Vector(sinTheta * cosPhi, sinPhi * sinTheta, cosTheta);
             z += Vector(p);
         }
-        return 0.5f * log(r) * r / dr;
+        return 0.5f * fast::log(r) * r / dr;
     }
+    /// @brief The distance estimate may exceed the true distance away from
+    /// the surface.
+    bool isDistanceBound() const override { return false; }
 
     Bounds getBoundingBox() const override {
-        return Bounds(Point(-1, -1, -1), Point(1, 1, 1));
+        return Bounds(Point(-m_radius), Point(m_radius));
     }
 
-    Point getCentroid() const override { return Point(0, 0, 0); }
-
-    AreaSample sampleArea(Sampler &rng) const override{ NOT_IMPLEMENTED }
-
     std::string toString() const override {
-        return "mandelbulb";
+        return tfm::format("MandelBulb[\n"
+                           "  n = %d,\n"
+                           "  %s\n"
+                           "]",
+                           n, indent(tracingSettings()));
     }
 };
 
 } // namespace lightwave
 
-REGISTER_SHAPE(MandelBulb, "mandelbulb");
\ No newline at end of file
+REGISTER_SHAPE(MandelBulb, "mandelbulb");
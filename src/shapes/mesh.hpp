@@ -0,0 +1,904 @@
+/**
+ * @file mesh.hpp
+ * @brief Contains the TriangleMesh shape, which is shared with @ref Group so
+ * that it can merge small meshes.
+ */
+
+#pragma once
+
+#include <lightwave.hpp>
+
+#include "../core/lwmesh.hpp"
+#include "../core/plyparser.hpp"
+#include "../core/simplify.hpp"
+#include "../core/vertexcompression.hpp"
+#include "accel.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace lightwave {
+
+/**
+ * @brief Classifies the triangles of a mesh with respect to an alpha mask (aka
+ * opacity micromap), so that texture lookups are only needed in regions that
+ * are neither fully opaque nor fully transparent. Each triangle is subdivided
+ * into 16 micro-triangles, the states of which are packed into 32 bits.
+ * @note The classification is conservative: micro-triangles are classified
+ * from bounds on the alpha mask over their footprint in texture space (see
+ * @ref Texture::range ), and are left unknown wherever such bounds are not
+ * available (e.g., if a micro-triangle covers too many texels).
+ */
+class OpacityMicromap {
+public:
+    enum class State : uint32_t {
+        Transparent = 0,
+        Opaque      = 1,
+        /// @brief The alpha mask needs to be evaluated.
+        Unknown = 2,
+    };
+
+    /// @brief The number of segments each edge of a triangle is split into.
+    static constexpr int Subdivisions = 4;
+
+private:
+    /// @brief The alpha mask.
+    ref<Texture> m_alpha;
+    /// @brief The states of the micro-triangles of each triangle, two bits per
+    /// micro-triangle (see @ref microTriangle ).
+    std::vector<uint32_t> m_states;
+    /// @brief The number of micro-triangles in each state.
+    int m_counts[3] = {};
+
+    /**
+     * @brief The index of the micro-triangle containing the given barycentric
+     * coordinates. Micro-triangles are numbered row by row (along u), where
+     * each cell of a row consists of a lower and (except for the last cell)
+     * an upper triangle.
+     */
+    static int microTriangle(float u, float v) {
+        constexpr int N = Subdivisions;
+        const float su  = u * N;
+        const float sv  = v * N;
+        const int i     = std::clamp(int(su), 0, N - 1);
+        const int j     = std::clamp(int(sv), 0, N - 1 - i);
+        const bool upper = i + j < N - 1 && (su - i) + (sv - j) > 1;
+        return i * (2 * N - i) + 2 * j + upper;
+    }
+
+    static State classify(const std::optional<std::pair<float, float>> &range) {
+        if (!range)
+            return State::Unknown;
+        if (range->first >= 1)
+            return State::Opaque;
+        if (range->second <= 0)
+            return State::Transparent;
+        return State::Unknown;
+    }
+
+public:
+    OpacityMicromap(const ref<Texture> &alpha,
+                    std::span<const Vector3i> triangles,
+                    std::span<const Vertex> vertices)
+        : m_alpha(alpha) {
+        constexpr int N = Subdivisions;
+        m_states.resize(triangles.size());
+        if (const auto constant = alpha->constant()) {
+            const State state =
+                classify(std::make_pair(constant->r(), constant->r()));
+            uint32_t packed = 0;
+            for (int micro = 0; micro < N * N; micro++)
+                packed |= uint32_t(state) << (2 * micro);
+            std::fill(m_states.begin(), m_states.end(), packed);
+            m_counts[int(state)] = int(triangles.size()) * N * N;
+            return;
+        }
+
+        for (size_t triangle = 0; triangle < triangles.size(); triangle++) {
+            const Vector3i &indices = triangles[triangle];
+            // the texture coordinates of the corners of the micro-triangles
+            const auto corner = [&](int a, int b) {
+                return interpolateBarycentric(
+                    Vector2(float(a) / N, float(b) / N),
+                    vertices[indices[0]].uv,
+                    vertices[indices[1]].uv,
+                    vertices[indices[2]].uv);
+            };
+
+            uint32_t packed = 0;
+            for (int i = 0; i < N; i++) {
+                for (int j = 0; i + j < N; j++) {
+                    for (int upper = 0; upper < 2; upper++) {
+                        if (upper && i + j == N - 1)
+                            continue;
+                        // the bounding box of the micro-triangle in texture
+                        // space, slightly enlarged to account for rounding
+                        // errors in the barycentric coordinates of hits
+                        Bounds2 footprint = Bounds2::empty();
+                        footprint.extend(corner(i + upper, j + upper));
+                        footprint.extend(corner(i + 1, j));
+                        footprint.extend(corner(i, j + 1));
+                        constexpr float Margin = 1e-5f;
+                        const Vector2 margin =
+                            Vector2(Margin) + footprint.diagonal() * Margin;
+                        footprint = Bounds2(footprint.min() - margin,
+                                            footprint.max() + margin);
+
+                        const State state = classify(alpha->range(footprint));
+                        const int micro = i * (2 * N - i) + 2 * j + upper;
+                        packed |= uint32_t(state) << (2 * micro);
+                        m_counts[int(state)]++;
+                    }
+                }
+            }
+            m_states[triangle] = packed;
+        }
+    }
+
+    /// @brief The state of the region of a triangle that contains the given
+    /// barycentric coordinates.
+    State state(int triangle, float u, float v) const {
+        return State((m_states[triangle] >> (2 * microTriangle(u, v))) & 3);
+    }
+
+    /// @brief Stochastically decides whether a hit in a region of unknown state
+    /// passes the alpha mask (like @ref Instance does).
+    bool passes(const Point2 &uv, Sampler &rng) const {
+        return !(m_alpha->evaluate(uv).r() < rng.next());
+    }
+
+    std::string toString() const {
+        return tfm::format("OpacityMicromap[\n"
+                           "  opaque = %d,\n"
+                           "  transparent = %d,\n"
+                           "  unknown = %d,\n"
+                           "]",
+                           m_counts[int(State::Opaque)],
+                           m_counts[int(State::Transparent)],
+                           m_counts[int(State::Unknown)]);
+    }
+};
+
+/**
+ * @brief A shape consisting of many (potentially millions) of triangles, which
+ * share an index and vertex buffer. Since individual triangles are rarely
+ * needed (and would pose an excessive amount of overhead), collections of
+ * triangles are combined in a single shape.
+ */
+class TriangleMesh : public AccelerationStructure {
+    /**
+     * @brief The index buffer of the triangles.
+     * The n-th element corresponds to the n-th triangle, and each component of
+     * the element corresponds to one vertex index (into @c m_vertices ) of the
+     * triangle. This list will always contain as many elements as there are
+     * triangles.
+     */
+    Buffer<Vector3i> m_triangles;
+    /**
+     * @brief The vertex buffer of the triangles, indexed by m_triangles.
+     * Note that multiple triangles can share vertices, hence there can also be
+     * fewer than @code 3 * numTriangles @endcode vertices.
+     */
+    Buffer<Vertex> m_vertices;
+    /**
+     * @brief The storage of meshes with compressed vertex attributes (see @ref
+     * compress ), which replaces @c m_vertices (and @c m_triangles , if all
+     * vertex indices fit into 16 bits).
+     */
+    struct CompressedStorage {
+        bool enabled = false;
+        /// @brief The vertex indices of each triangle, or empty if they do not
+        /// fit into 16 bits.
+        std::vector<std::array<uint16_t, 3>> triangles;
+        /// @brief The positions at full precision, or empty if quantized.
+        std::vector<Point> positions;
+        /// @brief The quantized positions, or empty if not quantized.
+        std::vector<std::array<uint16_t, 3>> quantizedPositions;
+        PositionQuantization quantization;
+        /// @brief The attributes that are only decoded for the closest hit.
+        std::vector<CompressedAttributes> attributes;
+    } m_compressed;
+    /// @brief The file this mesh was loaded from, for logging and debugging
+    /// purposes.
+    std::filesystem::path m_originalPath;
+    /// @brief Whether to interpolate the normals from m_vertices, or report the
+    /// geometric normal instead.
+    bool m_smoothNormals;
+
+public:
+    /// @brief A mesh that is merged with others into a single mesh, together
+    /// with the instance it belongs to.
+    struct Part {
+        /// @brief The (untransformed) instance that is reported for hits.
+        const Instance *instance;
+        /// @brief The mesh that the triangles are copied from.
+        const TriangleMesh *mesh;
+    };
+
+private:
+    /// @brief For meshes that were merged from several parts: the instance and
+    /// whether to use smooth normals for each part.
+    struct PartInfo {
+        const Instance *instance;
+        bool smoothNormals;
+    };
+    /// @brief A coarser version of the mesh, used for objects that appear
+    /// small in the image (see @ref withDetail ).
+    struct Level {
+        /// @brief The largest distance from the original surface.
+        float error;
+        ref<TriangleMesh> mesh;
+        /// @brief Whether the mesh has its BVH (generated levels only build
+        /// it once they are selected).
+        mutable bool prepared;
+        /// @brief Whether the level was returned by @ref withDetail .
+        mutable bool selected = false;
+    };
+    /// @brief The levels of detail, ordered from finest to coarsest.
+    std::vector<Level> m_levels;
+    /// @brief Guards the preparation of levels in @ref withDetail .
+    mutable std::mutex m_levelMutex;
+    /// @brief The error of this mesh when it is used as an explicit level of
+    /// detail of another mesh (or negative if unspecified).
+    float m_error;
+
+    /// @brief Estimates the error of a level of detail as half its average
+    /// edge length, for levels that do not specify it.
+    float estimatedError() const {
+        if (m_error >= 0)
+            return m_error;
+        double total = 0;
+        for (int primitive = 0; primitive < numberOfTriangles(); primitive++) {
+            const Vector3i indices = triangle(primitive);
+            for (int i = 0; i < 3; i++) {
+                total += (position(indices[(i + 1) % 3]) - position(indices[i]))
+                             .length();
+            }
+        }
+        return numberOfTriangles() == 0
+                   ? 0
+                   : float(total / (6 * numberOfTriangles()));
+    }
+
+    /// @brief Loads explicit levels of detail from child meshes, and generates
+    /// further levels by simplification.
+    void buildLevels(const Properties &properties) {
+        for (const auto &child : properties.getChildren<TriangleMesh>())
+            m_levels.push_back({ child->estimatedError(), child, true });
+
+        const int generated = properties.get<int>("lods", 0);
+        const float ratio   = properties.get<float>("lodRatio", 0.25f);
+        if (generated > 0) {
+            if (!(ratio > 0 && ratio < 1))
+                lightwave_throw("lodRatio must lie within (0, 1), but is %g",
+                                ratio);
+            Timer timer;
+            std::vector<int> triangleCounts;
+            float count = float(numberOfTriangles());
+            for (int level = 0; level < generated; level++)
+                triangleCounts.push_back(int(count *= ratio));
+            for (SimplifiedMesh &level :
+                 simplifyMesh(m_triangles, m_vertices, triangleCounts)) {
+                m_levels.push_back(
+                    { level.error,
+                      std::make_shared<TriangleMesh>(std::move(level.indices),
+                                                     std::move(level.vertices),
+                                                     m_originalPath,
+                                                     m_smoothNormals),
+                      false });
+            }
+            logger(EInfo,
+                   "generated %d levels of detail in %.1f ms",
+                   m_levels.size(),
+                   timer.getElapsedTime() * 1000);
+        }
+
+        std::sort(m_levels.begin(),
+                  m_levels.end(),
+                  [](const Level &a, const Level &b) {
+                      return a.error < b.error;
+                  });
+    }
+
+    /// @brief The parts this mesh was merged from (empty for regular meshes).
+    std::vector<PartInfo> m_parts;
+    /// @brief The index into @c m_parts for each triangle (empty for regular
+    /// meshes).
+    std::vector<int> m_triangleParts;
+
+    inline void populate(SurfaceEvent &surf, const Point &position,
+                         Vector normal, Vector shadingNormal, Vector tangent,
+                         Point2 uv) const {
+        surf.position = position;
+        surf.uv = uv; // Incorrect, uv of a triangle but not of the whole mesh
+        surf.geometryNormal = normal;
+        surf.shadingNormal  = shadingNormal;
+        surf.tangent        = tangent;
+    }
+
+    /// @brief Moller-Trumbore intersection test of a triangle, which reports
+    /// the distance and barycentric coordinates of hits closer than @c tMax .
+    static bool intersectPositions(const Point &p1, const Point &p2,
+                                   const Point &p3, const Ray &ray, float tMax,
+                                   float &t, Vector2 &bary) {
+        // Edges of triangle
+        Vector e1           = p2 - p1;
+        Vector e2           = p3 - p1;
+        Vector ray_cross_e2 = ray.direction.cross(e2);
+        float det           = e1.dot(ray_cross_e2);
+
+        if (det > Epsilon && det < Epsilon)
+            return false;
+
+        float inv_det = 1.0f / det;
+        Vector s      = ray.origin - p1;
+        float u       = inv_det * s.dot(ray_cross_e2);
+
+        if (u < 0 || u > 1)
+            return false;
+
+        Vector s_cross_e1 = s.cross(e1);
+        float v           = inv_det * ray.direction.dot(s_cross_e1);
+        if (v < 0 || u + v > 1)
+            return false;
+
+        t    = inv_det * e2.dot(s_cross_e1);
+        bary = Vector2(u, v);
+        return t > Epsilon && t < tMax;
+        // Code reference from the wikipedia page of the
+        // Moller-Trumbore Algorithm
+        //  https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
+    }
+
+    /// @brief Whether a hit passes the alpha mask of an opacity micromap,
+    /// where @c uv computes the texture coordinates if the mask needs to be
+    /// evaluated.
+    template <typename UV>
+    static bool passesMask(const OpacityMicromap &micromap, int primitiveIndex,
+                           const Vector2 &bary, UV &&uv, Sampler &rng) {
+        const auto state = micromap.state(primitiveIndex, bary.x(), bary.y());
+        if (state == OpacityMicromap::State::Transparent)
+            return false;
+        return state != OpacityMicromap::State::Unknown ||
+               micromap.passes(uv(), rng);
+    }
+
+    /// @brief Fills in the surface attributes of a hit on a triangle with the
+    /// given vertices.
+    void completeHit(int primitiveIndex, const Ray &ray, float t,
+                     const Vector2 &bary, const Vertex &v1, const Vertex &v2,
+                     const Vertex &v3, Intersection &its) const {
+        its.t = t;
+
+        bool smoothNormals = m_smoothNormals;
+        if (!m_parts.empty()) {
+            const PartInfo &part = m_parts[m_triangleParts[primitiveIndex]];
+            smoothNormals        = part.smoothNormals;
+            its.instance         = part.instance;
+        }
+
+        Vector e1     = v2.position - v1.position;
+        Vector e2     = v3.position - v1.position;
+        Vector normal = e1.cross(e2).normalized();
+        Point2 uv     = interpolateBarycentric(bary, v1.uv, v2.uv, v3.uv);
+
+        Vector shadingNormal;
+        if (smoothNormals) {
+            Vector interpolatedNormal =
+                interpolateBarycentric(bary, v1.normal, v2.normal, v3.normal)
+                    .normalized();
+            shadingNormal = interpolatedNormal;
+        } else {
+            shadingNormal = normal;
+        }
+
+        Point intersectionPosition = ray.origin + t * ray.direction;
+
+        Vector2 uv0 = v1.uv;
+        Vector2 uv1 = v2.uv;
+        Vector2 uv2 = v3.uv;
+
+        Vector2 deltaUV1 = uv1 - uv0;
+        Vector2 deltaUV2 = uv2 - uv0;
+
+        float f = 1.0f / (deltaUV1[0] * deltaUV2[1] - deltaUV2[0] * deltaUV1[1]);
+        // fill intersection details
+        Vector tangent = (e1 * deltaUV2[1] - e2 * deltaUV1[1]) * f; // Tangent
+
+        populate(its, intersectionPosition, normal, shadingNormal, tangent, uv);
+    }
+
+    /// @brief Intersection of a single triangle, optionally discarding hits
+    /// that are transparent according to an opacity micromap.
+    template <bool Masked = false>
+    bool intersectTriangleImpl(int primitiveIndex, const Ray &ray,
+                               Intersection &its,
+                               const OpacityMicromap *micromap = nullptr,
+                               Sampler *rng = nullptr) const {
+        Vector3i triangleIndices = m_triangles[primitiveIndex];
+        Vertex v1                = m_vertices[triangleIndices[0]];
+        Vertex v2                = m_vertices[triangleIndices[1]];
+        Vertex v3                = m_vertices[triangleIndices[2]];
+
+        float t;
+        Vector2 bary;
+        if (!intersectPositions(
+                v1.position, v2.position, v3.position, ray, its.t, t, bary))
+            return false;
+        if constexpr (Masked) {
+            if (!passesMask(
+                    *micromap,
+                    primitiveIndex,
+                    bary,
+                    [&] {
+                        return interpolateBarycentric(
+                            bary, v1.uv, v2.uv, v3.uv);
+                    },
+                    *rng))
+                return false;
+        }
+        completeHit(primitiveIndex, ray, t, bary, v1, v2, v3, its);
+        return true;
+    }
+
+    /// @brief Tests a triangle of a compressed mesh, which only decodes its
+    /// positions (the remaining attributes are decoded by @ref
+    /// resolveCompressed once the closest hit is known).
+    template <bool Masked>
+    bool intersectCompressed(int primitiveIndex, const Ray &ray, float tMax,
+                             float &t, Vector2 &bary,
+                             const OpacityMicromap *micromap,
+                             Sampler *rng) const {
+        const Vector3i indices = triangle(primitiveIndex);
+        if (!intersectPositions(position(indices[0]),
+                                position(indices[1]),
+                                position(indices[2]),
+                                ray,
+                                tMax,
+                                t,
+                                bary))
+            return false;
+        if constexpr (Masked) {
+            const auto &attributes = m_compressed.attributes;
+            return passesMask(
+                *micromap,
+                primitiveIndex,
+                bary,
+                [&] {
+                    return interpolateBarycentric(
+                        bary,
+                        attributes[indices[0]].decodeUV(),
+                        attributes[indices[1]].decodeUV(),
+                        attributes[indices[2]].decodeUV());
+                },
+                *rng);
+        }
+        return true;
+    }
+
+    /// @brief Decodes the attributes of the closest hit on a compressed mesh.
+    void resolveCompressed(int primitiveIndex, const Ray &ray, float t,
+                           const Vector2 &bary, Intersection &its) const {
+        const Vector3i indices = triangle(primitiveIndex);
+        completeHit(primitiveIndex,
+                    ray,
+                    t,
+                    bary,
+                    vertex(indices[0]),
+                    vertex(indices[1]),
+                    vertex(indices[2]),
+                    its);
+    }
+
+    /// @brief Traverses the BVH of a compressed mesh, only resolving the
+    /// attributes of the closest hit.
+    template <bool Masked>
+    bool traverseCompressedNodes(const Ray &ray, Intersection &its,
+                                 Sampler &rng,
+                                 const OpacityMicromap *micromap) const {
+        int closest = -1;
+        Vector2 closestBary;
+        traverseNodes(ray, its, [&](int slot) {
+            const int primitive = primitiveIndex(slot);
+            float t;
+            Vector2 bary;
+            if (!intersectCompressed<Masked>(
+                    primitive, ray, its.t, t, bary, micromap, &rng))
+                return false;
+            its.t       = t;
+            closest     = primitive;
+            closestBary = bary;
+            return true;
+        });
+        if (closest < 0)
+            return false;
+        resolveCompressed(closest, ray, its.t, closestBary, its);
+        return true;
+    }
+
+    bool traverseCompressedImpl(const Ray &ray, Intersection &its, Sampler &rng,
+                                const OpacityMicromap *micromap) const {
+        return micromap ? traverseCompressedNodes<true>(ray, its, rng, micromap)
+                        : traverseCompressedNodes<false>(ray, its, rng, nullptr);
+    }
+
+    LW_DISPATCH(bool, traverseCompressed,
+                (const Ray &ray, Intersection &its, Sampler &rng,
+                 const OpacityMicromap *micromap) const,
+                (ray, its, rng, micromap))
+
+    LW_DISPATCH(bool, intersectTriangle,
+                (int primitiveIndex, const Ray &ray, Intersection &its) const,
+                (primitiveIndex, ray, its))
+
+    /// @brief Traverses the BVH, applying an opacity micromap to each hit.
+    bool traverseMaskedImpl(const Ray &ray, Intersection &its, Sampler &rng,
+                            const OpacityMicromap &micromap) const {
+        return traverseNodes(ray, its, [&](int slot) {
+            return intersectTriangleImpl<true>(
+                primitiveIndex(slot), ray, its, &micromap, &rng);
+        });
+    }
+
+    LW_DISPATCH(bool, traverseMasked,
+                (const Ray &ray, Intersection &its, Sampler &rng,
+                 const OpacityMicromap &micromap) const,
+                (ray, its, rng, micromap))
+
+    /// @brief The opacity micromaps built for alpha masks so far, which are
+    /// shared by all instances that use the same alpha mask.
+    mutable std::unordered_map<const Texture *, ref<OpacityMicromap>>
+        m_micromaps;
+    /// @brief Guards @c m_micromaps , as instances might be created
+    /// concurrently.
+    mutable std::mutex m_micromapMutex;
+
+protected:
+    int numberOfPrimitives() const override { return numberOfTriangles(); }
+
+    bool intersect(int primitiveIndex, const Ray &ray, Intersection &its,
+                   Sampler &rng) const override {
+        return intersectTriangle(primitiveIndex, ray, its);
+    }
+
+    Bounds getBoundingBox(int primitiveIndex) const override {
+        Vector3i indices = triangle(primitiveIndex);
+
+        Bounds box;
+        box.extend(position(indices[0]));
+        box.extend(position(indices[1]));
+        box.extend(position(indices[2]));
+        return box;
+    }
+
+    Point getCentroid(int primitiveIndex) const override {
+        Vector3i indices = triangle(primitiveIndex);
+        Point v1         = position(indices[0]);
+        Point v2         = position(indices[1]);
+        Point v3         = position(indices[2]);
+
+        float x = (v1[0] + v2[0] + v3[0]) / 3.0f;
+        float y = (v1[1] + v2[1] + v3[1]) / 3.0f;
+        float z = (v1[2] + v2[2] + v3[2]) / 3.0f;
+
+        return Point(x, y, z);
+    }
+
+    /**
+     * @brief Loads the mesh and its BVH from @c m_originalPath , which is
+     * either an .lwmesh file (see @ref save ) or a PLY file. For PLY files,
+     * caching can be enabled, in which case an .lwmesh file next to it serves
+     * as cache. The cache is used if it was written for the same contents of
+     * the PLY file by the same version of the loader, and (re)written
+     * otherwise.
+     */
+    void load(bool useCache);
+    /// @brief Adopts the arrays of an .lwmesh file, which remain in the
+    /// memory-mapped file.
+    void load(const lwmesh::Reader &reader);
+
+public:
+    TriangleMesh(const Properties &properties) {
+        m_originalPath  = properties.get<std::filesystem::path>("filename");
+        m_smoothNormals = properties.get<bool>("smooth", true);
+        m_error         = properties.get<float>("error", -1);
+        load(properties.get<bool>("cache", false));
+        buildLevels(properties);
+        if (properties.get<bool>("compress", false)) {
+            const bool quantize = properties.get<bool>("quantize", false);
+            compress(quantize);
+            for (const Level &level : m_levels) {
+                if (level.prepared)
+                    level.mesh->compress(quantize);
+            }
+        }
+    }
+
+    /// @brief Creates a mesh from the given buffers (e.g., a simplified level
+    /// of detail of another mesh).
+    /// @note The BVH is not built, which is left to the caller.
+    TriangleMesh(std::vector<Vector3i> triangles, std::vector<Vertex> vertices,
+                 const std::filesystem::path &originalPath, bool smoothNormals)
+        : m_triangles(std::move(triangles)), m_vertices(std::move(vertices)),
+          m_originalPath(originalPath), m_smoothNormals(smoothNormals),
+          m_error(-1) {}
+
+    /**
+     * @brief Merges untransformed meshes into a single mesh with one BVH over
+     * all their triangles, which reports the instance of the part that was hit
+     * (see @ref Instance::completeIntersection ).
+     */
+    TriangleMesh(const std::vector<Part> &parts) {
+        m_originalPath  = "(merged)";
+        m_smoothNormals = true;
+        m_error         = -1;
+        for (const Part &part : parts) {
+            const int vertexOffset = int(m_vertices.size());
+            for (int i = 0; i < part.mesh->numberOfVertices(); i++)
+                m_vertices.push_back(part.mesh->vertex(i));
+            for (int i = 0; i < part.mesh->numberOfTriangles(); i++) {
+                m_triangles.push_back(part.mesh->triangle(i) +
+                                      Vector3i(vertexOffset));
+                m_triangleParts.push_back(int(m_parts.size()));
+            }
+            m_parts.push_back({ part.instance, part.mesh->m_smoothNormals });
+        }
+        buildAccelerationStructure();
+    }
+
+    /// @brief Writes the mesh and its BVH to an .lwmesh file, recording the
+    /// hash of the file it was converted from (see @ref lwmesh::hash ) and
+    /// the version of the loader that converted it.
+    void save(const std::filesystem::path &path, uint64_t sourceHash = 0,
+              uint32_t loaderVersion = 0) const;
+
+    using AccelerationStructure::getBoundingBox;
+    using AccelerationStructure::getCentroid;
+
+    /**
+     * @brief Replaces the vertices by a compact encoding: normals are stored
+     * in 32 bits (see @ref encodeOctahedral ), texture coordinates in half
+     * precision, vertex indices in 16 bits where possible, and positions
+     * optionally in 16 bits per axis. Only positions are decoded during
+     * traversal, the remaining attributes are decoded for the closest hit.
+     */
+    void compress(bool quantizePositions);
+
+    /// @brief Whether the vertices are stored compressed (see @ref compress ).
+    bool isCompressed() const { return m_compressed.enabled; }
+    /// @brief The number of bytes used by the triangles and vertices.
+    size_t geometryMemory() const;
+
+    /// @brief The number of triangles of the mesh.
+    int numberOfTriangles() const {
+        return int(m_compressed.triangles.empty()
+                       ? m_triangles.size()
+                       : m_compressed.triangles.size());
+    }
+    /// @brief The number of vertices of the mesh.
+    int numberOfVertices() const {
+        return int(m_compressed.enabled ? m_compressed.attributes.size()
+                                        : m_vertices.size());
+    }
+    /// @brief The vertex indices of a triangle.
+    Vector3i triangle(int primitiveIndex) const {
+        if (m_compressed.triangles.empty())
+            return m_triangles[primitiveIndex];
+        const auto &indices = m_compressed.triangles[primitiveIndex];
+        return { indices[0], indices[1], indices[2] };
+    }
+    /// @brief The position of a vertex.
+    Point position(int index) const {
+        if (!m_compressed.enabled)
+            return m_vertices[index].position;
+        if (m_compressed.positions.empty())
+            return m_compressed.quantization.decode(
+                m_compressed.quantizedPositions[index]);
+        return m_compressed.positions[index];
+    }
+    /// @brief A vertex, which is decoded for compressed meshes.
+    Vertex vertex(int index) const {
+        if (!m_compressed.enabled)
+            return m_vertices[index];
+        const CompressedAttributes &attributes =
+            m_compressed.attributes[index];
+        return { .position = position(index),
+                 .uv       = attributes.decodeUV(),
+                 .normal   = decodeOctahedral(attributes.normal) };
+    }
+    /// @brief The vertex indices of each triangle (empty for compressed
+    /// meshes, see @ref triangle ).
+    const Buffer<Vector3i> &triangles() const { return m_triangles; }
+    /// @brief The vertices of the mesh (empty for compressed meshes, see @ref
+    /// vertex ).
+    const Buffer<Vertex> &vertices() const { return m_vertices; }
+    // the BVH is public for meshes, so that tests can check that a cached
+    // one stays memory-mapped
+    using AccelerationStructure::nodes;
+    using AccelerationStructure::primitiveOrder;
+
+    /// @brief Intersects a single triangle of the mesh (e.g., one that was
+    /// found by rasterization, see @ref VisibilityBuffer ).
+    bool intersectPrimitive(int primitiveIndex, const Ray &ray,
+                            Intersection &its) const {
+        if (m_compressed.enabled) {
+            float t;
+            Vector2 bary;
+            if (!intersectCompressed<false>(
+                    primitiveIndex, ray, its.t, t, bary, nullptr, nullptr))
+                return false;
+            resolveCompressed(primitiveIndex, ray, t, bary, its);
+            return true;
+        }
+        return intersectTriangle(primitiveIndex, ray, its);
+    }
+
+    /// @brief Intersects the mesh, discarding hits that are transparent
+    /// according to the given opacity micromap.
+    bool intersectMasked(const Ray &ray, Intersection &its, Sampler &rng,
+                         const OpacityMicromap &micromap) const {
+        PROFILE("Triangle mesh")
+        if (!mayIntersect(ray, its))
+            return false;
+        if (m_compressed.enabled)
+            return traverseCompressed(ray, its, rng, &micromap);
+        return traverseMasked(ray, its, rng, micromap);
+    }
+
+    /// @brief Returns the opacity micromap of the mesh for an alpha mask,
+    /// building it on first use.
+    ref<OpacityMicromap> micromap(const ref<Texture> &alpha) const {
+        std::lock_guard lock(m_micromapMutex);
+        auto &micromap = m_micromaps[alpha.get()];
+        if (!micromap) {
+            Timer timer;
+            if (m_compressed.enabled) {
+                std::vector<Vector3i> triangles(numberOfTriangles());
+                std::vector<Vertex> vertices(numberOfVertices());
+                for (size_t i = 0; i < triangles.size(); i++)
+                    triangles[i] = triangle(int(i));
+                for (size_t i = 0; i < vertices.size(); i++)
+                    vertices[i] = vertex(int(i));
+                micromap = std::make_shared<OpacityMicromap>(
+                    alpha, triangles, vertices);
+            } else {
+                micromap = std::make_shared<OpacityMicromap>(
+                    alpha, m_triangles, m_vertices);
+            }
+            logger(EInfo,
+                   "built opacity micromap for %d triangles in %.1f ms",
+                   numberOfTriangles(),
+                   timer.getElapsedTime() * 1000);
+        }
+        return micromap;
+    }
+
+    ref<Shape> withAlphaMask(const ref<Texture> &alpha) const override;
+
+    ref<Shape> withDetail(float error) const override {
+        std::lock_guard lock(m_levelMutex);
+        const Level *result = nullptr;
+        for (const Level &level : m_levels) {
+            if (level.error > error)
+                break;
+            result = &level;
+        }
+        if (!result)
+            return nullptr;
+        if (!result->prepared) {
+            result->mesh->buildAccelerationStructure();
+            if (m_compressed.enabled) {
+                // (positions are only kept at full precision if they were not
+                // quantized)
+                result->mesh->compress(m_compressed.positions.empty());
+            }
+            result->prepared = true;
+        }
+        result->selected = true;
+        return result->mesh;
+    }
+
+    void releaseUnusedDetail() override {
+        std::lock_guard lock(m_levelMutex);
+        std::erase_if(m_levels,
+                      [](const Level &level) { return !level.selected; });
+    }
+
+    bool intersect(const Ray &ray, Intersection &its,
+                   Sampler &rng) const override {
+        PROFILE("Triangle mesh")
+        const float previousT = its.t;
+        if (m_compressed.enabled) {
+            // (merged meshes are never compressed, hence there are no parts)
+            return mayIntersect(ray, its) &&
+                   traverseCompressed(ray, its, rng, nullptr);
+        }
+        if (!AccelerationStructure::intersect(ray, its, rng))
+            return false;
+        if (!m_parts.empty())
+            its.instance->completeIntersection(its, previousT, 1, rng);
+        return true;
+    }
+
+    AreaSample sampleArea(Sampler &rng) const override{
+        // only implement this if you need triangle mesh
+        // area light sampling for
+        // your rendering competition
+        NOT_IMPLEMENTED
+    }
+
+    std::string toString() const override {
+        if (!m_parts.empty()) {
+            return tfm::format("Mesh[\n"
+                               "  vertices = %d,\n"
+                               "  triangles = %d,\n"
+                               "  parts = %d\n"
+                               "]",
+                               numberOfVertices(),
+                               numberOfTriangles(),
+                               m_parts.size());
+        }
+        std::stringstream levels;
+        for (const Level &level : m_levels) {
+            levels << (&level == m_levels.data() ? "" : ", ")
+                   << level.mesh->numberOfTriangles() << " triangles (error "
+                   << level.error << ")";
+        }
+        return tfm::format(
+            "Mesh[\n"
+            "  vertices = %d,\n"
+            "  triangles = %d,\n"
+            "  levels = [%s],\n"
+            "  compressed = %s,\n"
+            "  filename = \"%s\"\n"
+            "]",
+            numberOfVertices(),
+            numberOfTriangles(),
+            levels.str(),
+            m_compressed.enabled ? "true" : "false",
+            m_originalPath.generic_string());
+    }
+};
+
+/**
+ * @brief A triangle mesh under an alpha mask, which discards transparent hits
+ * during traversal using an opacity micromap (see @ref Instance ).
+ */
+class MaskedTriangleMesh : public Shape {
+    /// @brief The mesh, which is kept alive by the instance.
+    const TriangleMesh *m_mesh;
+    ref<OpacityMicromap> m_micromap;
+
+public:
+    MaskedTriangleMesh(const TriangleMesh *mesh,
+                       const ref<OpacityMicromap> &micromap)
+        : m_mesh(mesh), m_micromap(micromap) {}
+
+    bool intersect(const Ray &ray, Intersection &its,
+                   Sampler &rng) const override {
+        return m_mesh->intersectMasked(ray, its, rng, *m_micromap);
+    }
+
+    Bounds getBoundingBox() const override { return m_mesh->getBoundingBox(); }
+
+    Point getCentroid() const override { return m_mesh->getCentroid(); }
+
+    AreaSample sampleArea(Sampler &rng) const override {
+        return m_mesh->sampleArea(rng);
+    }
+
+    std::string toString() const override {
+        return tfm::format("MaskedMesh[\n"
+                           "  mesh = %s,\n"
+                           "  micromap = %s,\n"
+                           "]",
+                           indent(m_mesh->toString()),
+                           indent(m_micromap->toString()));
+    }
+};
+
+inline ref<Shape> TriangleMesh::withAlphaMask(const ref<Texture> &alpha) const {
+    return std::make_shared<MaskedTriangleMesh>(this, micromap(alpha));
+}
+
+} // namespace lightwave
@@ -88,6 +88,11 @@ public:
         return sample;
     }
 
+    InlinePrimitive inlinePrimitive() const override {
+        return InlinePrimitive::parallelogram(
+            Point(-1, -1, 0), Vector(2, 0, 0), Vector(0, 2, 0));
+    }
+
     std::string toString() const override { return "Rectangle[]"; }
 };
 
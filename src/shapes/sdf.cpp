@@ -0,0 +1,243 @@
+#include "sdf.hpp"
+
+namespace lightwave {
+
+/// @brief A sphere described by its signed distance.
+class SdfSphere : public SignedDistanceField {
+    Point m_center;
+    float m_radius;
+
+public:
+    SdfSphere(const Properties &properties) : SignedDistanceField(properties) {
+        m_center = properties.get<Point>("center", Point(0));
+        m_radius = properties.get<float>("radius", 1);
+        buildDistanceGrid();
+    }
+
+    float distance(const Point &p) const override {
+        return (p - m_center).length() - m_radius;
+    }
+
+    Vector normal(const Point &p) const override { return p - m_center; }
+
+    Bounds getBoundingBox() const override {
+        return Bounds(m_center - Vector(m_radius), m_center + Vector(m_radius));
+    }
+
+    std::string toString() const override {
+        return tfm::format("SdfSphere[\n"
+                           "  center = %s,\n"
+                           "  radius = %g,\n"
+                           "  %s\n"
+                           "]",
+                           m_center,
+                           m_radius,
+                           indent(tracingSettings()));
+    }
+};
+
+/// @brief An axis-aligned box with optionally rounded edges, described by its
+/// signed distance.
+class SdfBox : public SignedDistanceField {
+    Point m_center;
+    /// @brief Half the extent of the box along each axis.
+    Vector m_size;
+    /// @brief The radius by which edges and corners are rounded.
+    float m_rounding;
+
+public:
+    SdfBox(const Properties &properties) : SignedDistanceField(properties) {
+        m_center   = properties.get<Point>("center", Point(0));
+        m_size     = properties.get<Vector>("size", Vector(1));
+        m_rounding = properties.get<float>("rounding", 0);
+        buildDistanceGrid();
+    }
+
+    float distance(const Point &p) const override {
+        // https://iquilezles.org/articles/distfunctions/
+        Vector q;
+        for (int dim = 0; dim < 3; dim++)
+            q[dim] = abs(p[dim] - m_center[dim]) - m_size[dim] + m_rounding;
+        return elementwiseMax(q, Vector(0)).length() +
+               std::min(q.maxComponent(), 0.f) - m_rounding;
+    }
+
+    Bounds getBoundingBox() const override {
+        return Bounds(m_center - m_size, m_center + m_size);
+    }
+
+    std::string toString() const override {
+        return tfm::format("SdfBox[\n"
+                           "  center = %s,\n"
+                           "  size = %s,\n"
+                           "  rounding = %g,\n"
+                           "  %s\n"
+                           "]",
+                           m_center,
+                           m_size,
+                           m_rounding,
+                           indent(tracingSettings()));
+    }
+};
+
+/// @brief A torus around the y-axis, described by its signed distance.
+class SdfTorus : public SignedDistanceField {
+    Point m_center;
+    /// @brief The distance from the center to the center of the tube.
+    float m_radius;
+    /// @brief The radius of the tube.
+    float m_thickness;
+
+public:
+    SdfTorus(const Properties &properties) : SignedDistanceField(properties) {
+        m_center    = properties.get<Point>("center", Point(0));
+        m_radius    = properties.get<float>("radius", 1);
+        m_thickness = properties.get<float>("thickness", 0.25f);
+        buildDistanceGrid();
+    }
+
+    float distance(const Point &p) const override {
+        const Vector d = p - m_center;
+        const float q  = Vector2(d.x(), d.z()).length() - m_radius;
+        return Vector2(q, d.y()).length() - m_thickness;
+    }
+
+    Bounds getBoundingBox() const override {
+        const Vector extent(m_radius + m_thickness, m_thickness,
+                            m_radius + m_thickness);
+        return Bounds(m_center - extent, m_center + extent);
+    }
+
+    std::string toString() const override {
+        return tfm::format("SdfTorus[\n"
+                           "  center = %s,\n"
+                           "  radius = %g,\n"
+                           "  thickness = %g,\n"
+                           "  %s\n"
+                           "]",
+                           m_center,
+                           m_radius,
+                           m_thickness,
+                           indent(tracingSettings()));
+    }
+};
+
+/**
+ * @brief Combines signed distance fields using constructive solid geometry,
+ * which yields a single shape (and hence a single BVH leaf) for the whole
+ * composition. The difference subtracts all further children from the first
+ * one. A positive @c smoothness blends the surfaces of children together.
+ */
+class Csg : public SignedDistanceField {
+    enum class Operation {
+        Union,
+        Intersection,
+        Difference,
+    };
+
+    Operation m_operation;
+    /// @brief The width of the region in which surfaces are blended.
+    float m_smoothness;
+    std::vector<ref<SignedDistanceField>> m_children;
+
+    /// @brief A smooth version of the minimum of two distances (see
+    /// https://iquilezles.org/articles/smin/ ).
+    float smoothMin(float a, float b) const {
+        if (m_smoothness <= 0)
+            return std::min(a, b);
+        const float h = std::max(m_smoothness - abs(a - b), 0.f) / m_smoothness;
+        return std::min(a, b) - h * h * m_smoothness * 0.25f;
+    }
+
+public:
+    Csg(const Properties &properties) : SignedDistanceField(properties) {
+        m_operation = properties.getEnum<Operation>(
+            "operation",
+            Operation::Union,
+            {
+                { "union", Operation::Union },
+                { "intersection", Operation::Intersection },
+                { "difference", Operation::Difference },
+            });
+        m_smoothness = properties.get<float>("smoothness", 0);
+        m_children   = properties.getChildren<SignedDistanceField>();
+        if (m_children.empty()) {
+            lightwave_throw(
+                "csg requires at least one signed distance field child");
+        }
+        buildDistanceGrid();
+    }
+
+    float distance(const Point &p) const override {
+        float result = m_children.front()->distance(p);
+        for (size_t i = 1; i < m_children.size(); i++) {
+            const float d = m_children[i]->distance(p);
+            switch (m_operation) {
+            case Operation::Union:
+                result = smoothMin(result, d);
+                break;
+            case Operation::Intersection:
+                result = -smoothMin(-result, -d);
+                break;
+            case Operation::Difference:
+                result = -smoothMin(-result, d);
+                break;
+            }
+        }
+        return result;
+    }
+    /// @brief Smooth intersections and differences enlarge distances, while
+    /// smooth unions only reduce them.
+    bool isDistanceBound() const override {
+        if (m_smoothness > 0 && m_operation != Operation::Union)
+            return false;
+        for (const auto &child : m_children) {
+            if (!child->isDistanceBound())
+                return false;
+        }
+        return true;
+    }
+
+    Bounds getBoundingBox() const override {
+        Bounds result = m_children.front()->getBoundingBox();
+        for (size_t i = 1; i < m_children.size(); i++) {
+            const Bounds child = m_children[i]->getBoundingBox();
+            switch (m_operation) {
+            case Operation::Union:
+                result.extend(child);
+                break;
+            case Operation::Intersection:
+                result = Bounds(elementwiseMax(result.min(), child.min()),
+                                elementwiseMin(result.max(), child.max()));
+                break;
+            case Operation::Difference:
+                break;
+            }
+        }
+        if (m_operation == Operation::Union) {
+            // blending can grow the surface by a quarter of the smoothness
+            const Vector margin(0.25f * m_smoothness);
+            result = Bounds(result.min() - margin, result.max() + margin);
+        }
+        return result;
+    }
+
+    std::string toString() const override {
+        std::stringstream oss;
+        oss << "Csg[" << std::endl
+            << "  smoothness = " << m_smoothness << "," << std::endl
+            << "  " << indent(tracingSettings()) << "," << std::endl
+            << "  children = {" << std::endl;
+        for (const auto &child : m_children)
+            oss << "    " << indent(child, 2) << "," << std::endl;
+        oss << "  }" << std::endl << "]";
+        return oss.str();
+    }
+};
+
+} // namespace lightwave
+
+REGISTER_SHAPE(SdfSphere, "sdfsphere")
+REGISTER_SHAPE(SdfBox, "sdfbox")
+REGISTER_SHAPE(SdfTorus, "sdftorus")
+REGISTER_SHAPE(Csg, "csg")
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <lightwave.hpp>
+
+namespace lightwave {
+
+/**
+ * @brief Parent class for shapes that are described implicitly by a signed
+ * distance function (e.g., fractals or CSG compositions of primitives), which
+ * are intersected by sphere tracing.
+ *
+ * To use this class, you will need to implement the following methods:
+ * - distance(p)      -- return a lower bound on the distance from @c p to the
+ * surface, which is negative inside the shape
+ * - getBoundingBox() -- return a bounding box that contains the surface
+ *
+ * Subclasses can provide analytic normals by overriding @c normal , and tighter
+ * bounding volumes by overriding @c clip . To support the baked distance grid,
+ * subclasses must call @c buildDistanceGrid at the end of their constructor.
+ *
+ * Tracing is controlled by the following properties:
+ * - @c relaxation -- over-relaxation factor for sphere tracing steps (1 for
+ * regular sphere tracing)
+ * - @c steps      -- maximum number of distance evaluations per ray
+ * - @c grid       -- resolution of the baked distance grid (0 to disable).
+ * This is experimental: no scene has been measured to render faster with it.
+ * It is ignored for shapes whose distances are only estimates (see @c
+ * isDistanceBound ), since its steps are not safe for them.
+ *
+ * @see MandelBulb
+ */
+class SignedDistanceField : public Shape {
+    /// @brief The factor by which sphere tracing steps are enlarged (see
+    /// "Enhanced Sphere Tracing" by Keinert et al. [2014]).
+    float m_relaxation;
+    /// @brief The maximum number of distance evaluations per ray.
+    int m_maxSteps;
+
+    /// @brief Resolution of the baked distance grid along each axis, or zero
+    /// if no grid is used.
+    int m_gridResolution;
+    /// @brief The region covered by the baked distance grid.
+    Bounds m_gridBounds;
+    /// @brief The extent of a single grid cell.
+    Vector m_cellSize;
+    /// @brief Lower bounds below which the exact distance is evaluated.
+    float m_gridThreshold = 0;
+    /// @brief Distances at the centers of all grid cells, which bound the
+    /// distance to the surface from below everywhere within the grid (after
+    /// subtracting the distance to the cell center).
+    std::vector<float> m_grid;
+
+    /// @brief Returns the center of the grid cell with the given indices.
+    Point cellCenter(int x, int y, int z) const {
+        return m_gridBounds.min() +
+               m_cellSize * Vector(x + 0.5f, y + 0.5f, z + 0.5f);
+    }
+
+    /// @brief Returns a lower bound for the unsigned distance from @c p to the
+    /// surface according to the baked grid.
+    float gridDistance(const Point &p) const {
+        int index[3];
+        for (int dim = 0; dim < 3; dim++) {
+            index[dim] = std::clamp(
+                int((p[dim] - m_gridBounds.min()[dim]) / m_cellSize[dim]),
+                0,
+                m_gridResolution - 1);
+        }
+        const float estimate =
+            m_grid[(index[2] * m_gridResolution + index[1]) * m_gridResolution +
+                   index[0]];
+        return abs(estimate) -
+               (p - cellCenter(index[0], index[1], index[2])).length();
+    }
+
+    /// @brief Fills in the intersection details for a hit at distance @c t .
+    void populate(Intersection &its, const Ray &ray, float t) const {
+        its.t        = t;
+        its.position = ray(t);
+        its.uv       = Point2(0);
+
+        Vector n = normal(its.position);
+        if (!(n.lengthSquared() > 0))
+            n = -ray.direction; // degenerate gradient
+        its.geometryNormal = n.normalized();
+        its.shadingNormal  = its.geometryNormal;
+        Vector bitangent;
+        buildOrthonormalBasis(its.geometryNormal, its.tangent, bitangent);
+    }
+
+protected:
+    SignedDistanceField(const Properties &properties, int defaultSteps = 1000) {
+        m_relaxation     = properties.get<float>("relaxation", 1.2f);
+        m_maxSteps       = properties.get<int>("steps", defaultSteps);
+        m_gridResolution = properties.get<int>("grid", 0);
+        if (m_relaxation < 1 || m_relaxation >= 2) {
+            lightwave_throw("relaxation must lie within [1, 2), but is %g",
+                            m_relaxation);
+        }
+    }
+
+    /// @brief Bakes the distance at the centers of all grid cells within the
+    /// bounding box (if enabled), which must be called once the subclass can
+    /// evaluate distances.
+    void buildDistanceGrid() {
+        if (m_gridResolution <= 0)
+            return;
+        if (!isDistanceBound()) {
+            logger(EWarn,
+                   "ignoring the distance grid, which requires distances that "
+                   "bound the distance to the surface");
+            m_gridResolution = 0;
+            return;
+        }
+
+        Timer timer;
+        m_gridBounds    = getBoundingBox();
+        m_cellSize      = m_gridBounds.diagonal() / m_gridResolution;
+        m_gridThreshold = m_cellSize.length();
+        m_grid.resize(size_t(m_gridResolution) * m_gridResolution *
+                      m_gridResolution);
+        for_each_parallel(Range(0, m_gridResolution), [&](int z) {
+            for (int y = 0; y < m_gridResolution; y++) {
+                for (int x = 0; x < m_gridResolution; x++) {
+                    m_grid[(z * m_gridResolution + y) * m_gridResolution + x] =
+                        distance(cellCenter(x, y, z));
+                }
+            }
+        });
+        logger(EInfo, "baked %d^3 distance grid in %.1fms", m_gridResolution,
+               timer.getElapsedTime() * 1000);
+    }
+
+    /// @brief Describes the tracing settings, for use in @c toString .
+    std::string tracingSettings() const {
+        return tfm::format("relaxation = %g,\n"
+                           "steps = %d,\n"
+                           "grid = %d",
+                           m_relaxation,
+                           m_maxSteps,
+                           m_gridResolution);
+    }
+
+public:
+    /// @brief Returns a lower bound on the distance from @c p to the surface,
+    /// which is negative for points inside the shape.
+    virtual float distance(const Point &p) const = 0;
+    /// @brief Whether @c distance never exceeds the true distance to the
+    /// surface. Distance estimates (e.g., of fractals) only guarantee this
+    /// close to the surface, which is enough for sphere tracing with sign
+    /// checks but not for the baked grid.
+    virtual bool isDistanceBound() const { return true; }
+
+    /// @brief Returns the (unnormalized) surface normal at @c p , which by
+    /// default is the gradient of the distance estimated with four samples
+    /// placed on a tetrahedron.
+    virtual Vector normal(const Point &p) const {
+        // https://iquilezles.org/articles/normalsSDF/
+        const float h = 0.5773f * Epsilon;
+        const Vector k0(+1, -1, -1), k1(-1, -1, +1), k2(-1, +1, -1),
+            k3(+1, +1, +1);
+        return k0 * distance(p + h * k0) + k1 * distance(p + h * k1) +
+               k2 * distance(p + h * k2) + k3 * distance(p + h * k3);
+    }
+
+    /**
+     * @brief Computes the parametric range [tNear, tFar] along the ray that
+     * lies within a volume containing the surface, returning false if it is
+     * missed. By default, the bounding box is used.
+     */
+    virtual bool clip(const Ray &ray, float &tNear, float &tFar) const {
+        const Bounds bounds = getBoundingBox();
+        const auto t1       = (bounds.min() - ray.origin) / ray.direction;
+        const auto t2       = (bounds.max() - ray.origin) / ray.direction;
+        tNear = std::max(elementwiseMin(t1, t2).maxComponent(), 0.f);
+        tFar  = elementwiseMax(t1, t2).minComponent();
+        return tNear < tFar;
+    }
+
+    bool intersect(const Ray &ray, Intersection &its,
+                   Sampler &rng) const override {
+        // only march within the bounding volume (which surfaces may touch),
+        // and stop at previous hits
+        float t, tFar;
+        if (!clip(ray, t, tFar))
+            return false;
+        tFar = std::min(tFar + Epsilon, its.t);
+
+        // rays that start on the surface (e.g., shadow rays) first need to
+        // leave it, after which we know whether they march inside or outside
+        float sign           = 0;
+        bool leaving         = false;
+        float omega          = m_relaxation;
+        float previousT      = t;
+        float stepLength     = 0;
+        float previousRadius = 0;
+        for (int i = 0; i < m_maxSteps; i++) {
+            if (t >= tFar) {
+                // relaxed steps may leave the range although the surface lies
+                // within it
+                if (omega == 1 || previousT + previousRadius >= tFar)
+                    return false;
+                t          = previousT + previousRadius;
+                stepLength = previousRadius;
+                omega      = 1;
+                continue;
+            }
+
+            if (m_gridResolution > 0) {
+                // take large conservative steps while far from the surface,
+                // and only evaluate the exact distance close to it
+                const float bound = gridDistance(ray(t));
+                if (bound > m_gridThreshold) {
+                    previousT  = t;
+                    stepLength = previousRadius = bound;
+                    t += bound;
+                    continue;
+                }
+            }
+
+            const float d      = distance(ray(t));
+            const float radius = abs(d);
+            if (omega > 1 && radius + previousRadius < stepLength) {
+                // the unbounding spheres of the last two steps do not overlap,
+                // hence the relaxed step might have skipped over the surface:
+                // fall back to regular sphere tracing from the last position
+                t          = previousT + previousRadius;
+                stepLength = previousRadius;
+                omega      = 1;
+                continue;
+            }
+
+            if (radius < Epsilon) {
+                if (sign == 0 && (leaving || t <= Epsilon)) {
+                    // still on the surface the ray started from
+                    leaving = true;
+                    t += Epsilon;
+                    continue;
+                }
+                if (t <= Epsilon)
+                    return false;
+                populate(its, ray, t);
+                return true;
+            }
+            if (sign == 0)
+                sign = d < 0 ? -1 : +1;
+
+            if (sign * d < 0) {
+                // the last step crossed the surface (as distances are not
+                // always exact bounds), which we locate by bisection
+                float near = previousT, far = t;
+                while (far - near > Epsilon) {
+                    const float mid = (near + far) / 2;
+                    (sign * distance(ray(mid)) > 0 ? near : far) = mid;
+                }
+                if (near <= Epsilon)
+                    return false;
+                populate(its, ray, near);
+                return true;
+            }
+
+            stepLength     = omega * radius;
+            previousRadius = radius;
+            previousT      = t;
+            t += stepLength;
+        }
+        return false;
+    }
+
+    Point getCentroid() const override { return getBoundingBox().center(); }
+
+    AreaSample sampleArea(Sampler &rng) const override{ NOT_IMPLEMENTED }
+};
+
+} // namespace lightwave
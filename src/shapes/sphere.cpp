@@ -91,6 +91,10 @@ public:
         return sample;
     }
 
+    InlinePrimitive inlinePrimitive() const override {
+        return InlinePrimitive::sphere(Point(0), radius);
+    }
+
     std::string toString() const override {
         return "Sphere[radius=" + std::to_string(radius) + "]";
     }
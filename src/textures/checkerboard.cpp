@@ -32,12 +32,25 @@ public:
         }
     }
 
+    std::optional<std::pair<float, float>> range(
+        const Bounds2 &region) const override {
+        // the region lies within a single check if it does not cross any of
+        // the grid lines
+        for (int dim = 0; dim < 2; dim++) {
+            if (std::floor(region.min()[dim] * scale[dim]) !=
+                std::floor(region.max()[dim] * scale[dim]))
+                return std::minmax(color0.r(), color1.r());
+        }
+        const float value = evaluate(region.center()).r();
+        return std::make_pair(value, value);
+    }
+
     std::string toString() const override {
         return tfm::format(
             "CheckerboardTexture[\n"
-            "  color0 = %s\n",
-            "  color1 = %s\n",
-            "  scale = %s\n",
+            "  color0 = %s,\n"
+            "  color1 = %s,\n"
+            "  scale = %s\n"
             "]",
             indent(color0),
             indent(color1),
@@ -12,6 +12,8 @@ public:
 
     Color evaluate(const Point2 &uv) const override { return m_value; }
 
+    std::optional<Color> constant() const override { return m_value; }
+
     std::string toString() const override {
         return tfm::format(
             "ConstantTexture[\n"
@@ -50,7 +50,7 @@ public:
         // clang-format on
     }
 
-    Color evaluate(const Point2 &uv) const override {
+    Color lookupImpl(const Point2 &uv) const {
         float u    = uv[0];
         float v    = -uv[1] + 1;
         int width  = m_image->resolution().x();
@@ -111,6 +111,60 @@ public:
         }
     }
 
+    LW_DISPATCH(Color, lookup, (const Point2 &uv) const, (uv))
+
+    Color evaluate(const Point2 &uv) const override { return lookup(uv); }
+
+    std::optional<std::pair<float, float>> range(
+        const Bounds2 &region) const override {
+        // regions covering more texels are reported as unknown, as visiting
+        // all of them would be more expensive than evaluating the texture
+        constexpr float MaxTexels = 1024;
+
+        const int width  = m_image->resolution().x();
+        const int height = m_image->resolution().y();
+        // the texels that lookup might read within the region (note that v
+        // is flipped)
+        float x0 = region.min().x() * width;
+        float x1 = region.max().x() * width;
+        float y0 = (1 - region.max().y()) * height;
+        float y1 = (1 - region.min().y()) * height;
+        if (m_filter == FilterMode::Bilinear) {
+            x0 -= 0.5f;
+            y0 -= 0.5f;
+            x1 += 0.5f;
+            y1 += 0.5f;
+        }
+        x0 = std::floor(x0);
+        y0 = std::floor(y0);
+        x1 = std::floor(x1);
+        y1 = std::floor(y1);
+        // (also rejects coordinates that are not finite or do not fit into
+        // integers)
+        constexpr float MaxCoordinate = 1 << 24;
+        if (!((x1 - x0 + 1) * (y1 - y0 + 1) <= MaxTexels &&
+              std::max(std::abs(x0), std::abs(x1)) < MaxCoordinate &&
+              std::max(std::abs(y0), std::abs(y1)) < MaxCoordinate))
+            return std::nullopt;
+
+        float min = Infinity, max = -Infinity;
+        for (int y = int(y0); y <= int(y1); y++) {
+            for (int x = int(x0); x <= int(x1); x++) {
+                const Point2i pixel =
+                    m_border == BorderMode::Clamp
+                        ? Point2i(clamp(x, width - 1), clamp(y, height - 1))
+                        : Point2i(repeat(x, width), repeat(y, height));
+                const float value = m_image->get(pixel).r();
+                min               = std::min(min, value);
+                max               = std::max(max, value);
+            }
+        }
+        // (only bilinear lookups apply the exposure)
+        if (m_filter == FilterMode::Bilinear)
+            return std::minmax(min * m_exposure, max * m_exposure);
+        return std::make_pair(min, max);
+    }
+
     std::string toString() const override {
         return tfm::format(
             "ImageTexture[\n"
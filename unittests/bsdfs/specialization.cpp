@@ -0,0 +1,69 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+using namespace lightwave;
+
+namespace {
+
+ref<Texture> constantTexture(const Color &value) {
+    Properties props;
+    props.set("value", value);
+    return std::dynamic_pointer_cast<Texture>(
+        Registry::create("texture", "constant", props));
+}
+
+/// @brief A texture that is not constant as far as the Bsdf can tell, but
+/// evaluates to the same value everywhere.
+ref<Texture> uniformCheckerboard(const Color &value) {
+    Properties props;
+    props.set("color0", value);
+    props.set("color1", value);
+    return std::dynamic_pointer_cast<Texture>(
+        Registry::create("texture", "checkerboard", props));
+}
+
+ref<Bsdf> principled(bool constantBaseColor, bool constantRoughness) {
+    const auto texture = [](bool constant, const Color &value) {
+        return constant ? constantTexture(value) : uniformCheckerboard(value);
+    };
+    Properties props;
+    props.set("baseColor", texture(constantBaseColor, Color(0.8f, 0.2f, 0.1f)));
+    props.set("roughness", texture(constantRoughness, Color(0.4f)));
+    props.set("metallic", constantTexture(Color(0.3f)));
+    props.set("specular", constantTexture(Color(0.5f)));
+    return std::dynamic_pointer_cast<Bsdf>(
+        Registry::create("bsdf", "principled", props));
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Constant Bsdf inputs are baked in", "[bsdf]" ) {
+    const auto constant = principled(true, true);
+    const auto mixed    = principled(false, true);
+    const auto textured = principled(false, false);
+
+    SECTION( "The variant is reported" ) {
+        REQUIRE_THAT( constant->toString(), Catch::Matchers::ContainsSubstring("variant   = constant,") );
+        REQUIRE_THAT( mixed->toString(), Catch::Matchers::ContainsSubstring("variant   = constant roughness, metallic, specular,") );
+        REQUIRE_THAT( textured->toString(), Catch::Matchers::ContainsSubstring("variant   = constant metallic, specular,") );
+    }
+
+    SECTION( "All variants evaluate to the same values" ) {
+        BsdfClosure closure;
+        closure.uv = Point2(0.3f, 0.7f);
+        const Vector wo = Vector(0.2f, -0.3f, 0.9f).normalized();
+        const Vector wi = Vector(-0.4f, 0.1f, 0.8f).normalized();
+
+        constant->prepare(closure);
+        const BsdfEval expected = constant->evaluate(closure, wo, wi);
+        REQUIRE( expected.value.mean() > 0 );
+        for (const auto &bsdf : { mixed, textured }) {
+            bsdf->prepare(closure);
+            const BsdfEval eval = bsdf->evaluate(closure, wo, wi);
+            REQUIRE( eval.value == expected.value );
+            REQUIRE( eval.pdf == expected.pdf );
+        }
+    }
+}
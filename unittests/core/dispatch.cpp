@@ -0,0 +1,86 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+using namespace lightwave;
+
+// clang-format off
+
+TEST_CASE( "Instruction set selection", "[dispatch]" ) {
+    const dispatch::Isa detected = dispatch::active();
+
+    SECTION( "Generic kernels are always supported" ) {
+        REQUIRE( dispatch::supported(dispatch::Isa::Generic) );
+        REQUIRE( dispatch::supported(dispatch::detect()) );
+    }
+
+    SECTION( "Levels can be selected by name" ) {
+        dispatch::select("generic");
+        REQUIRE( dispatch::active() == dispatch::Isa::Generic );
+        dispatch::select("avx512");
+        REQUIRE( dispatch::supported(dispatch::active()) );
+    }
+
+    SECTION( "Unknown levels are rejected" ) {
+        REQUIRE_THROWS( dispatch::select("sse9") );
+    }
+
+    dispatch::detail::activeIsa = detected;
+}
+
+TEST_CASE( "Kernels agree across instruction sets", "[dispatch]" ) {
+    Properties props { std::filesystem::path(__FILE__).parent_path() /
+                       "../../tests/meshes" };
+    props.set<std::string>("filename", "bunny.ply");
+    const auto mesh = std::dynamic_pointer_cast<Shape>(
+        Registry::create("shape", "mesh", props));
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    REQUIRE( mesh );
+
+    // shoot a grid of rays at the mesh from outside its bounds
+    const Bounds bounds = mesh->getBoundingBox();
+    const Point eye     = bounds.center() + Vector(0, 0, 2 * bounds.diagonal().length());
+    constexpr int Resolution = 64;
+
+    const auto render = [&](dispatch::Isa isa) {
+        dispatch::detail::activeIsa = isa;
+        std::vector<float> distances;
+        for (int y = 0; y < Resolution; y++) {
+            for (int x = 0; x < Resolution; x++) {
+                const Point target =
+                    bounds.min() + Vector((x + 0.5f) / Resolution,
+                                          (y + 0.5f) / Resolution, 0.5f) *
+                                       bounds.diagonal();
+                const Ray ray { eye, (target - eye).normalized() };
+                Intersection its;
+                distances.push_back(mesh->intersect(ray, its, *sampler)
+                                        ? its.t
+                                        : Infinity);
+            }
+        }
+        return distances;
+    };
+
+    const dispatch::Isa detected = dispatch::active();
+    const std::vector<float> reference = render(dispatch::Isa::Generic);
+    REQUIRE( std::count_if(reference.begin(), reference.end(),
+                           [](float t) { return t < Infinity; }) > 0 );
+
+    for (dispatch::Isa isa : { dispatch::Isa::AVX2, dispatch::Isa::AVX512 }) {
+        if (!dispatch::supported(isa))
+            continue;
+        const std::vector<float> distances = render(isa);
+        // fused multiply-adds round slightly differently, which may decide
+        // hits at the edges of triangles
+        int mismatches = 0;
+        for (size_t i = 0; i < reference.size(); i++) {
+            if (std::isinf(reference[i]) != std::isinf(distances[i]))
+                mismatches++;
+            else if (!std::isinf(reference[i]))
+                REQUIRE( distances[i] == Catch::Approx(reference[i]).epsilon(1e-4) );
+        }
+        REQUIRE( mismatches <= Resolution * Resolution / 1000 );
+    }
+
+    dispatch::detail::activeIsa = detected;
+}
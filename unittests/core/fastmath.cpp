@@ -0,0 +1,121 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/fastmath.hpp>
+
+#include <cmath>
+#include <functional>
+
+using namespace lightwave;
+
+namespace {
+
+/// @brief The maximum error of an approximation against a double precision
+/// reference over evenly spaced arguments in [lo, hi].
+double maxError(const std::function<float(float)> &approximation,
+                const std::function<double(double)> &reference, float lo,
+                float hi, bool relative) {
+    constexpr int Steps = 200000;
+    double error        = 0;
+    for (int i = 0; i <= Steps; i++) {
+        const float x         = lo + (hi - lo) * float(i) / Steps;
+        const double expected = reference(x);
+        double difference     = std::abs(approximation(x) - expected);
+        if (relative)
+            difference /= std::max(std::abs(expected), 1e-30);
+        error = std::max(error, difference);
+    }
+    return error;
+}
+
+} // namespace
+
+// the functions are overloaded, and hence need to be wrapped
+#define APPROX(f) [](float x) { return approx::f(x); }
+#define EXACT(f) [](double x) { return std::f(x); }
+
+// clang-format off
+
+TEST_CASE( "Fast trigonometric functions", "[math][fastmath]" ) {
+    SECTION( "sin" ) {
+        REQUIRE( maxError(APPROX(sin), EXACT(sin), -100, 100, false) < 2e-7 );
+    }
+    SECTION( "cos" ) {
+        REQUIRE( maxError(APPROX(cos), EXACT(cos), -100, 100, false) < 2e-7 );
+    }
+    SECTION( "sincos agrees with sin and cos" ) {
+        float s, c;
+        approx::sincos(2.5f, s, c);
+        REQUIRE( s == approx::sin(2.5f) );
+        REQUIRE( c == approx::cos(2.5f) );
+    }
+    SECTION( "atan" ) {
+        REQUIRE( maxError(APPROX(atan), EXACT(atan), -50, 50, false) < 3e-7 );
+    }
+    SECTION( "atan2" ) {
+        double error = 0;
+        for (int i = 0; i < 3600; i++) {
+            const double angle = 2 * M_PI * i / 3600;
+            for (float radius : { 1e-3f, 1.f, 1e3f }) {
+                const float x = float(radius * std::cos(angle));
+                const float y = float(radius * std::sin(angle));
+                error = std::max(error, std::abs(approx::atan2(y, x) -
+                                                 std::atan2(double(y), x)));
+            }
+        }
+        REQUIRE( error < 3e-7 );
+        REQUIRE( approx::atan2(0, 0) == 0 );
+        REQUIRE( approx::atan2(0, -1) == Catch::Approx(Pi) );
+        REQUIRE( approx::atan2(1, 0) == Catch::Approx(Pi2) );
+        REQUIRE( approx::atan2(-1, 0) == Catch::Approx(-Pi2) );
+    }
+    SECTION( "acos" ) {
+        REQUIRE( maxError(APPROX(acos), EXACT(acos), -1, 1, false) < 5e-7 );
+        REQUIRE( approx::acos(1.5f) == 0 );
+        REQUIRE( approx::acos(-1.5f) == Catch::Approx(Pi) );
+    }
+}
+
+TEST_CASE( "Fast exponential functions", "[math][fastmath]" ) {
+    SECTION( "exp" ) {
+        REQUIRE( maxError(APPROX(exp), EXACT(exp), -87, 88, true) < 4e-7 );
+        REQUIRE( approx::exp(-100) == 0 );
+        REQUIRE( approx::exp(100) == Infinity );
+    }
+    SECTION( "log" ) {
+        REQUIRE( maxError(APPROX(log), EXACT(log), 0.1f, 10, false) < 4e-7 );
+        REQUIRE( maxError(APPROX(log), EXACT(log), 10, 1e6f, true) < 4e-7 );
+        REQUIRE( maxError(APPROX(log), EXACT(log), 1e-30f, 1e-28f, true) < 4e-7 );
+        // denormal arguments
+        REQUIRE( approx::log(1e-40f) == Catch::Approx(std::log(1e-40)) );
+        REQUIRE( approx::log(0) == -Infinity );
+        REQUIRE( std::isnan(approx::log(-1)) );
+        REQUIRE( approx::log(Infinity) == Infinity );
+    }
+    SECTION( "pow" ) {
+        for (float y : { -3.f, 0.5f, 7.f, 8.f }) {
+            const auto reference = [&](double x) { return std::pow(x, y); };
+            const auto approximation = [&](float x) {
+                return approx::pow(x, y);
+            };
+            // the error of exp(y log x) grows with the magnitude of y log x
+            const double bound = 4e-7 * (1 + std::abs(y) * std::log(10.));
+            REQUIRE( maxError(approximation, reference, 0.1f, 10, true) < bound );
+        }
+        REQUIRE( approx::pow(0, 2) == 0 );
+        REQUIRE( approx::pow(0, 0) == 1 );
+        REQUIRE( approx::pow(0, -1) == Infinity );
+    }
+}
+
+TEST_CASE( "Fast batch functions", "[math][fastmath]" ) {
+    std::vector<float> x(1000), result(1000);
+    for (size_t i = 0; i < x.size(); i++)
+        x[i] = 0.01f * float(i) + 0.001f;
+
+    // vectorized code may round slightly differently
+    approx::sin(x, result);
+    for (size_t i = 0; i < x.size(); i++)
+        REQUIRE( result[i] == Catch::Approx(approx::sin(x[i])).margin(1e-6) );
+    approx::log(x, result);
+    for (size_t i = 0; i < x.size(); i++)
+        REQUIRE( result[i] == Catch::Approx(approx::log(x[i])).margin(1e-6) );
+}
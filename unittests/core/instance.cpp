@@ -0,0 +1,114 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+using namespace lightwave;
+
+namespace {
+
+ref<Instance> instance(const char *shape, const ref<Transform> &transform) {
+    const Properties empty;
+    Properties props;
+    props.addChild(Registry::create("shape", shape, empty));
+    if (transform)
+        props.addChild(transform);
+    return std::dynamic_pointer_cast<Instance>(
+        Registry::create("instance", "default", props));
+}
+
+ref<Instance> sphereInstance(const ref<Transform> &transform) {
+    return instance("sphere", transform);
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Instances specialize for their transform", "[instance]" ) {
+    const Properties empty;
+    auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", empty));
+    auto transform = std::make_shared<Transform>();
+
+    // rays along the z-axis towards the center of the transformed sphere
+    const auto distance = [&](const Instance &instance, const Point &center) {
+        Intersection its;
+        const Ray ray { center - Vector(0, 0, 10), Vector(0, 0, 1) };
+        return instance.intersect(ray, its, *sampler) ? its.t : Infinity;
+    };
+
+    SECTION( "No transform" ) {
+        const auto instance = sphereInstance(nullptr);
+        REQUIRE( instance->variant() == "identity" );
+        REQUIRE( distance(*instance, Point(0)) == Catch::Approx(9).epsilon(1e-4) );
+    }
+
+    SECTION( "Rigid transforms" ) {
+        transform->rotate(Vector(1, 2, 3), 0.7f);
+        transform->translate(Vector(1, 2, 3));
+        const auto instance = sphereInstance(transform);
+        REQUIRE( instance->variant() == "rigid" );
+        REQUIRE( distance(*instance, Point(1, 2, 3)) == Catch::Approx(9).epsilon(1e-4) );
+    }
+
+    SECTION( "Uniform scaling" ) {
+        transform->scale(Vector(2));
+        transform->rotate(Vector(0, 1, 0), 1.2f);
+        const auto instance = sphereInstance(transform);
+        REQUIRE( instance->variant() == "uniform scale" );
+        REQUIRE( distance(*instance, Point(0)) == Catch::Approx(8).epsilon(1e-4) );
+    }
+
+    SECTION( "Non-uniform scaling" ) {
+        transform->scale(Vector(1, 1, 3));
+        const auto instance = sphereInstance(transform);
+        REQUIRE( instance->variant() == "general" );
+        REQUIRE( distance(*instance, Point(0)) == Catch::Approx(7).epsilon(1e-4) );
+    }
+}
+
+TEST_CASE( "Groups intersect simple instances inline", "[instance]" ) {
+    const Properties empty;
+    auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", empty));
+
+    // spheres and rectangles under all kinds of transforms
+    std::vector<ref<Instance>> children;
+    Properties props;
+    for (int i = 0; i < 24; i++) {
+        auto transform = std::make_shared<Transform>();
+        transform->scale(i % 3 == 2 ? Vector(0.3f, 0.5f, 0.4f) : Vector(0.1f + 0.05f * (i % 4)));
+        transform->rotate(Vector(1, 2, 3), 0.3f * i);
+        transform->translate(Vector(i % 5 - 2.f, i / 5 - 2.f, 0.1f * i));
+        children.push_back(instance(i % 2 ? "rectangle" : "sphere", transform));
+        props.addChild(children.back());
+    }
+    const auto group = std::dynamic_pointer_cast<Shape>(
+        Registry::create("shape", "group", props));
+
+    int hits = 0;
+    for (int y = 0; y < 48; y++) {
+        for (int x = 0; x < 48; x++) {
+            const Point origin(0.2f, -0.1f, -10);
+            const Point target((x + 0.5f) / 12 - 2, (y + 0.5f) / 12 - 2, 1);
+            const Ray ray { origin, (target - origin).normalized() };
+
+            Intersection expected;
+            for (const auto &child : children)
+                child->intersect(ray, expected, *sampler);
+            Intersection its;
+            const bool wasIntersected = group->intersect(ray, its, *sampler);
+
+            REQUIRE( wasIntersected == (expected.instance != nullptr) );
+            if (wasIntersected) {
+                // the group inlines intersection into its traversal kernels,
+                // which round differently (e.g., using fused multiply-adds),
+                // most notably for grazing hits of sheared spheres
+                REQUIRE( its.instance == expected.instance );
+                REQUIRE( its.t == Catch::Approx(expected.t).epsilon(1e-4) );
+                REQUIRE( its.uv.x() == Catch::Approx(expected.uv.x()).margin(1e-3) );
+                hits++;
+            }
+        }
+    }
+    REQUIRE( hits > 100 );
+}
@@ -0,0 +1,212 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+#include <lightwave/fastmath.hpp>
+
+#include <random>
+
+using namespace lightwave;
+
+namespace {
+
+/// @brief Color with 16-byte aligned, four float storage, to compare against
+/// the packed three float layout of @c Color .
+struct alignas(16) PaddedColor {
+    std::array<float, 4> data {};
+
+    PaddedColor() = default;
+    explicit PaddedColor(const Color &c) : data({ c.r(), c.g(), c.b(), 0 }) {}
+
+    friend PaddedColor operator*(const PaddedColor &a, const PaddedColor &b) {
+        PaddedColor result;
+        for (int i = 0; i < 4; i++)
+            result.data[i] = a.data[i] * b.data[i];
+        return result;
+    }
+    friend PaddedColor operator*(const PaddedColor &a, float b) {
+        PaddedColor result;
+        for (int i = 0; i < 4; i++)
+            result.data[i] = a.data[i] * b;
+        return result;
+    }
+    PaddedColor &operator+=(const PaddedColor &other) {
+        for (int i = 0; i < 4; i++)
+            data[i] += other.data[i];
+        return *this;
+    }
+};
+
+} // namespace
+
+// run with: Rayquazing --benchmark-samples 20 "[math]"
+TEST_CASE( "Vector math kernels", "[.][benchmark][math]" ) {
+    constexpr int Count = 4096;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+    const auto randomVector = [&] {
+        return Vector(uniform(rng), uniform(rng), uniform(rng));
+    };
+
+    std::vector<Vector> a(Count), b(Count), c(Count);
+    std::vector<Bounds> boxes(Count);
+    std::vector<Ray> rays(Count);
+    std::vector<Color> colors(Count), weights(Count), accumulator(Count);
+    std::vector<PaddedColor> paddedColors(Count), paddedWeights(Count),
+        paddedAccumulator(Count);
+    std::vector<Vector4> homogeneous(Count);
+    for (int i = 0; i < Count; i++) {
+        a[i] = randomVector();
+        b[i] = randomVector();
+        c[i] = randomVector();
+        const Point corner = Point(randomVector());
+        boxes[i] = Bounds(corner, corner + Vector(0.5f));
+        rays[i]  = Ray(Point(randomVector() * 4.f), randomVector().normalized());
+        colors[i]  = Color(a[i]);
+        weights[i] = Color(b[i]);
+        paddedColors[i]  = PaddedColor(colors[i]);
+        paddedWeights[i] = PaddedColor(weights[i]);
+        homogeneous[i] = Vector4(a[i], 1);
+    }
+    const Matrix4x4 matrix { 0.9f, 0.1f, 0.2f, 1.f,  -0.1f, 0.8f, 0.3f, 2.f,
+                             0.2f, -0.3f, 0.7f, 3.f,  0.f,   0.f,  0.f,  1.f };
+
+    BENCHMARK( "slab test" ) {
+        float hits = 0;
+        for (int i = 0; i < Count; i++) {
+            const Ray &ray = rays[i];
+            const auto t1  = (boxes[i].min() - ray.origin) / ray.direction;
+            const auto t2  = (boxes[i].max() - ray.origin) / ray.direction;
+            const float tNear = elementwiseMin(t1, t2).maxComponent();
+            const float tFar  = elementwiseMax(t1, t2).minComponent();
+            hits += tNear <= tFar && tFar > 0;
+        }
+        return hits;
+    };
+
+    BENCHMARK( "Moller-Trumbore" ) {
+        float hits = 0;
+        for (int i = 0; i < Count; i++) {
+            const Ray &ray    = rays[i];
+            const Vector e1   = b[i] - a[i];
+            const Vector e2   = c[i] - a[i];
+            const Vector p    = ray.direction.cross(e2);
+            const float inv   = 1 / e1.dot(p);
+            const Vector s    = ray.origin - Point(a[i]);
+            const float u     = inv * s.dot(p);
+            const Vector q    = s.cross(e1);
+            const float v     = inv * ray.direction.dot(q);
+            const float t     = inv * e2.dot(q);
+            hits += u >= 0 && v >= 0 && u + v <= 1 && t > 0;
+        }
+        return hits;
+    };
+
+    BENCHMARK( "normalize, dot and cross" ) {
+        float sum = 0;
+        for (int i = 0; i < Count; i++) {
+            const Vector n = a[i].cross(b[i]).normalized();
+            sum += n.dot(c[i]) + (a[i] * 2.f - b[i]).lengthSquared();
+        }
+        return sum;
+    };
+
+    BENCHMARK( "color multiply-add" ) {
+        for (int i = 0; i < Count; i++)
+            accumulator[i] += colors[i] * weights[i] * 0.5f;
+        return accumulator[Count - 1].r();
+    };
+
+    BENCHMARK( "padded color multiply-add" ) {
+        for (int i = 0; i < Count; i++)
+            paddedAccumulator[i] += paddedColors[i] * paddedWeights[i] * 0.5f;
+        return paddedAccumulator[Count - 1].data[0];
+    };
+
+    // path throughput: every product depends on the previous one
+    BENCHMARK( "color throughput chain" ) {
+        Color throughput(1);
+        for (int i = 0; i < Count; i++)
+            throughput = throughput * weights[i] * 1.5f;
+        return throughput.r();
+    };
+
+    BENCHMARK( "padded color throughput chain" ) {
+        PaddedColor throughput(Color(1));
+        for (int i = 0; i < Count; i++)
+            throughput = throughput * paddedWeights[i] * 1.5f;
+        return throughput.data[0];
+    };
+
+    BENCHMARK( "matrix times vector" ) {
+        Vector4 sum;
+        for (int i = 0; i < Count; i++)
+            sum += matrix * homogeneous[i];
+        return sum.x();
+    };
+}
+
+// run with: Rayquazing --benchmark-samples 20 "[fastmath]"
+TEST_CASE( "Transcendental functions", "[.][benchmark][fastmath]" ) {
+    constexpr int Count = 4096;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+
+    std::vector<float> x(Count), y(Count), positive(Count), result(Count);
+    for (int i = 0; i < Count; i++) {
+        x[i]        = uniform(rng);
+        y[i]        = uniform(rng);
+        positive[i] = 4 * std::abs(uniform(rng)) + 1e-3f;
+    }
+
+    // the typical mix of an environment map lookup and a mandelbulb step
+    const auto kernel = [&](auto atan2, auto acos, auto sin, auto cos,
+                            auto pow, auto log) {
+        float sum = 0;
+        for (int i = 0; i < Count; i++) {
+            const float phi   = 8 * atan2(y[i], x[i]);
+            const float theta = 8 * acos(x[i]);
+            sum += sin(theta) * cos(phi) + pow(positive[i], 7.f) +
+                   log(positive[i]);
+        }
+        return sum;
+    };
+
+    BENCHMARK( "std" ) {
+        return kernel([](float y, float x) { return std::atan2(y, x); },
+                      [](float x) { return safe_acos(x); },
+                      [](float x) { return std::sin(x); },
+                      [](float x) { return std::cos(x); },
+                      [](float x, float y) { return std::pow(x, y); },
+                      [](float x) { return std::log(x); });
+    };
+
+    BENCHMARK( "approx" ) {
+        return kernel([](float y, float x) { return approx::atan2(y, x); },
+                      [](float x) { return approx::acos(x); },
+                      [](float x) { return approx::sin(x); },
+                      [](float x) { return approx::cos(x); },
+                      [](float x, float y) { return approx::pow(x, y); },
+                      [](float x) { return approx::log(x); });
+    };
+
+    BENCHMARK( "std::sin batch" ) {
+        for (int i = 0; i < Count; i++)
+            result[i] = std::sin(x[i]);
+        return result[Count - 1];
+    };
+
+    BENCHMARK( "approx::sin batch" ) {
+        approx::sin(x, result);
+        return result[Count - 1];
+    };
+
+    BENCHMARK( "std::exp batch" ) {
+        for (int i = 0; i < Count; i++)
+            result[i] = std::exp(x[i]);
+        return result[Count - 1];
+    };
+
+    BENCHMARK( "approx::exp batch" ) {
+        approx::exp(x, result);
+        return result[Count - 1];
+    };
+}
@@ -0,0 +1,177 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+#include "../../src/core/plyparser.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <fstream>
+
+using namespace lightwave;
+
+namespace {
+
+const std::filesystem::path meshDirectory =
+    std::filesystem::path(__FILE__).parent_path() / "../../tests/meshes";
+
+struct Mesh {
+    std::vector<Vector3i> indices;
+    std::vector<Vertex> vertices;
+};
+
+Mesh read(const std::filesystem::path &path) {
+    Mesh mesh;
+    readPLY(path, mesh.indices, mesh.vertices);
+    return mesh;
+}
+
+/// @brief Writes a mesh in the given PLY format, optionally without normals
+/// or with other integer types for the vertex indices of faces.
+void write(const std::filesystem::path &path, const Mesh &mesh,
+           const std::string &format, bool normals = true,
+           const std::string &countType = "uchar",
+           const std::string &indexType = "int") {
+    std::ofstream stream(path, std::ios::out | std::ios::binary);
+    stream << "ply\nformat " << format << " 1.0\n"
+           << "comment written by the unit tests\n"
+           << "element vertex " << mesh.vertices.size() << "\n"
+           << "property float x\nproperty float y\nproperty float z\n";
+    if (normals)
+        stream << "property float nx\nproperty float ny\nproperty float nz\n";
+    stream << "property float s\nproperty float t\n"
+           << "element face " << mesh.indices.size() << "\n"
+           << "property list " << countType << " " << indexType
+           << " vertex_indices\nend_header\n";
+
+    const auto writeBinary = [&](auto value) {
+        auto bytes = std::bit_cast<std::array<char, sizeof(value)>>(value);
+        if (format == "binary_big_endian")
+            std::reverse(bytes.begin(), bytes.end());
+        stream.write(bytes.data(), bytes.size());
+    };
+    const auto writeInteger = [&](const std::string &type, int value) {
+        if (type == "uchar")
+            writeBinary(uint8_t(value));
+        else if (type == "ushort" || type == "uint16")
+            writeBinary(uint16_t(value));
+        else
+            writeBinary(int32_t(value));
+    };
+    stream.precision(9);
+    for (const Vertex &vertex : mesh.vertices) {
+        std::vector<float> values = { vertex.position.x(), vertex.position.y(),
+                                      vertex.position.z() };
+        if (normals)
+            values.insert(values.end(), { vertex.normal.x(), vertex.normal.y(),
+                                          vertex.normal.z() });
+        values.insert(values.end(), { vertex.uv.x(), vertex.uv.y() });
+        for (float value : values) {
+            if (format == "ascii")
+                stream << value << " ";
+            else
+                writeBinary(value);
+        }
+        if (format == "ascii")
+            stream << "\n";
+    }
+    for (const Vector3i &triangle : mesh.indices) {
+        if (format == "ascii") {
+            stream << "3 " << triangle.x() << " " << triangle.y() << " "
+                   << triangle.z() << "\r\n";
+        } else {
+            writeInteger(countType, 3);
+            for (int i = 0; i < 3; i++)
+                writeInteger(indexType, triangle[i]);
+        }
+    }
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "PLY files are read identically in all formats", "[ply]" ) {
+    const Mesh reference = read(meshDirectory / "bunny.ply");
+    REQUIRE( reference.indices.size() == 28808 );
+    REQUIRE( reference.vertices.size() == 14559 );
+
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "lightwave-ply-test.ply";
+    for (const std::string format : { "ascii", "binary_big_endian" }) {
+        CAPTURE( format );
+        write(path, reference, format);
+        const Mesh mesh = read(path);
+        REQUIRE( mesh.indices.size() == reference.indices.size() );
+        REQUIRE( mesh.vertices.size() == reference.vertices.size() );
+        int mismatches = 0;
+        for (size_t i = 0; i < mesh.indices.size(); i++)
+            mismatches += mesh.indices[i] != reference.indices[i];
+        for (size_t i = 0; i < mesh.vertices.size(); i++) {
+            const Vertex &a = mesh.vertices[i], &b = reference.vertices[i];
+            mismatches += a.position != b.position || a.uv != b.uv ||
+                          (a.normal - b.normal).length() > 1e-6f;
+        }
+        REQUIRE( mismatches == 0 );
+    }
+
+    // truncated files are rejected
+    write(path, reference, "binary_little_endian");
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    REQUIRE_THROWS( read(path) );
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Missing normals are computed from the faces", "[ply]" ) {
+    const Mesh reference = read(meshDirectory / "icosphere.ply");
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "lightwave-ply-normals.ply";
+    write(path, reference, "ascii", false);
+    const Mesh mesh = read(path);
+    std::filesystem::remove(path);
+
+    // the icosphere has smooth normals that point outwards (which differ
+    // slightly from computed ones at texture seams, where vertices are split)
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        CAPTURE( i );
+        REQUIRE( mesh.vertices[i].normal.dot(reference.vertices[i].normal) >
+                 0.9f );
+    }
+}
+
+TEST_CASE( "Faces may use 16-bit integers", "[ply]" ) {
+    const Mesh reference = read(meshDirectory / "bunny.ply");
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "lightwave-ply-16bit.ply";
+    for (const std::string format : { "binary_little_endian",
+                                      "binary_big_endian" }) {
+        for (const auto &[countType, indexType] :
+             { std::pair("ushort", "ushort"), std::pair("uint16", "uint16"),
+               std::pair("ushort", "int"), std::pair("uchar", "ushort") }) {
+            CAPTURE( format, countType, indexType );
+            write(path, reference, format, true, countType, indexType);
+            const Mesh mesh = read(path);
+            REQUIRE( mesh.indices == reference.indices );
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Degenerate normals are computed from the faces", "[ply]" ) {
+    Mesh reference = read(meshDirectory / "icosphere.ply");
+    Mesh degenerate = reference;
+    for (size_t i = 0; i < degenerate.vertices.size(); i += 3)
+        degenerate.vertices[i].normal = Vector(0);
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "lightwave-ply-degenerate.ply";
+    write(path, degenerate, "binary_little_endian");
+    const Mesh mesh = read(path);
+    std::filesystem::remove(path);
+
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        CAPTURE( i );
+        const Vector &normal = mesh.vertices[i].normal;
+        REQUIRE( std::abs(normal.length() - 1) < 1e-5f );
+        REQUIRE( normal.dot(reference.vertices[i].normal) > 0.9f );
+    }
+}
@@ -0,0 +1,28 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+#include "../../src/core/plyparser.hpp"
+
+using namespace lightwave;
+
+// run with: Rayquazing --benchmark-samples 20 "[ply]"
+TEST_CASE( "PLY loading", "[.][benchmark][ply]" ) {
+    const std::filesystem::path directory =
+        std::filesystem::path(__FILE__).parent_path() / "../../tests/meshes";
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".ply")
+            paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+    REQUIRE( !paths.empty() );
+
+    for (const auto &path : paths) {
+        BENCHMARK( path.filename().string() ) {
+            std::vector<Vector3i> indices;
+            std::vector<Vertex> vertices;
+            readPLY(path, indices, vertices);
+            return indices.size();
+        };
+    }
+}
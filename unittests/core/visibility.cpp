@@ -0,0 +1,99 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+#include "../../src/core/visibility.hpp"
+
+using namespace lightwave;
+
+namespace {
+
+ref<Object> instance(const ref<Object> &shape, const ref<Transform> &transform) {
+    Properties props;
+    props.addChild(shape);
+    if (transform)
+        props.addChild(transform);
+    return Registry::create("instance", "default", props);
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Rasterized camera rays agree with traced ones", "[visibility]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+
+    Properties meshProps { std::filesystem::path(__FILE__).parent_path() /
+                           "../../tests/meshes" };
+    meshProps.set<std::string>("filename", "bunny.ply");
+    const auto mesh = std::dynamic_pointer_cast<Shape>(
+        Registry::create("shape", "mesh", meshProps));
+    const Bounds bounds = mesh->getBoundingBox();
+    const float size = bounds.diagonal().length();
+
+    // the camera looks at the bunny from close by, so that some triangles
+    // need to be clipped, and a sphere (which is traced) occludes parts of it
+    const auto cameraTransform = std::make_shared<Transform>();
+    const Vector center(bounds.center());
+    cameraTransform->lookat(center + Vector(0.1f, 0.2f, -0.6f) * size, center,
+                            Vector(0, 1, 0));
+    Properties cameraProps;
+    cameraProps.set<int>("width", 100);
+    cameraProps.set<int>("height", 70);
+    cameraProps.set<float>("fov", 60);
+    cameraProps.set<std::string>("fovAxis", "x");
+    cameraProps.set<bool>("rasterize", true);
+    cameraProps.addChild(cameraTransform);
+
+    const auto meshTransform = std::make_shared<Transform>();
+    meshTransform->rotate(Vector(0, 1, 0), 0.3f);
+    const auto sphereTransform = std::make_shared<Transform>();
+    sphereTransform->scale(Vector(0.1f * size));
+    sphereTransform->translate(center + Vector(0.1f, 0, -0.3f) * size);
+
+    Properties sceneProps;
+    sceneProps.addChild(Registry::create("camera", "perspective", cameraProps));
+    sceneProps.addChild(instance(mesh, meshTransform));
+    sceneProps.addChild(instance(Registry::create("shape", "sphere", Properties()),
+                                 sphereTransform));
+    const auto scene = std::dynamic_pointer_cast<Scene>(
+        Registry::create("scene", "default", sceneProps));
+    const Camera &camera = *scene->camera();
+
+    const Vector2i blockSize(32);
+    const VisibilityBuffer visibility(*scene, blockSize);
+    constexpr int SamplesPerPixel = 2;
+    int meshHits = 0, sphereHits = 0, misses = 0, mismatches = 0;
+    VisibilityBuffer::Tile tile;
+    for (auto block : BlockSpiral(camera.resolution(), blockSize)) {
+        // (rasterized one sample at a time, like for large sample counts)
+        for (int sample = 0; sample < SamplesPerPixel; sample++) {
+            visibility.rasterize(block, *sampler, sample, 1, tile);
+            for (auto pixel : block) {
+                sampler->seed(pixel, sample);
+                const Ray ray = camera.sample(pixel, *sampler).ray;
+                const Intersection expected = scene->intersect(ray, *sampler);
+                const Intersection its =
+                    visibility.intersect(ray, tile(pixel, sample), *sampler)
+                        .value_or(expected);
+
+                if (!expected) {
+                    misses++;
+                } else if (expected.instance->shape() == mesh.get()) {
+                    meshHits++;
+                } else {
+                    sphereHits++;
+                }
+                // samples on the edges of triangles may hit either triangle
+                if (its.instance != expected.instance ||
+                    std::abs(its.t - expected.t) > 1e-4f * size)
+                    mismatches++;
+            }
+        }
+    }
+    CAPTURE( meshHits, sphereHits, misses, mismatches );
+    REQUIRE( meshHits > 1000 );
+    REQUIRE( sphereHits > 100 );
+    REQUIRE( misses > 100 );
+    REQUIRE( mismatches < 0.001f * (meshHits + sphereHits + misses) );
+}
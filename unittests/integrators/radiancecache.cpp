@@ -0,0 +1,38 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+#include "../../src/integrators/radiancecache.hpp"
+
+using namespace lightwave;
+
+TEST_CASE( "Truncated radiance caches leave the cache unchanged", "[radiancecache]" ) {
+    const Bounds bounds(Point(0), Point(1));
+    const Point position(0.5f);
+    const Vector normal(0, 0, 1);
+    Color radiance;
+
+    RadianceCache stored(bounds, 16, 1024);
+    for (int i = 0; i < 4; i++) {
+        stored.insert(position, normal, Color(0.5f));
+        stored.insert(Point(0.1f), normal, Color(0.25f));
+    }
+    const auto path = std::filesystem::temp_directory_path() /
+                      "lightwave-radiancecache-test.lwrc";
+    stored.save(path);
+
+    RadianceCache complete(bounds, 16, 1024);
+    REQUIRE( complete.load(path) );
+    REQUIRE( complete.occupancy() == 2 );
+    REQUIRE( complete.lookup(position, normal, 2, 1, radiance) );
+    CHECK( radiance.r() == Catch::Approx(0.5f) );
+
+    // cut the last record in half
+    const auto size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size - 10);
+    RadianceCache truncated(bounds, 16, 1024);
+    truncated.insert(position, normal, Color(1));
+    REQUIRE( !truncated.load(path) );
+    CHECK( truncated.occupancy() == 1 );
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,57 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+using namespace lightwave;
+
+// run with: Rayquazing --benchmark-samples 20 "[benchmark]"
+TEST_CASE( "Sampler setup overhead per tile", "[.][benchmark]" ) {
+    // small tiles make the cost of setting up a sampler for each tile visible
+    constexpr int TileSize = 8;
+    const Properties props;
+
+    for (const std::string name : { "independent", "halton", "sobol" }) {
+        const auto prototype = std::dynamic_pointer_cast<Sampler>(
+            Registry::create("sampler", name, props));
+        REQUIRE( prototype );
+        auto reused = prototype->clone();
+
+        const auto seedTile = [](Sampler &sampler) {
+            float sum = 0;
+            for (int y = 0; y < TileSize; y++) {
+                for (int x = 0; x < TileSize; x++) {
+                    sampler.seed(Point2i(x, y), 0);
+                    sum += sampler.next();
+                }
+            }
+            return sum;
+        };
+
+        BENCHMARK( name + ": clone per tile" ) {
+            auto sampler = prototype->clone();
+            return seedTile(*sampler);
+        };
+        BENCHMARK( name + ": reseed per tile" ) {
+            return seedTile(*reused);
+        };
+    }
+}
+
+TEST_CASE( "Batch sample generation", "[.][benchmark]" ) {
+    const Properties props;
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "philox", props));
+    REQUIRE( sampler );
+    std::vector<float> values(1024);
+
+    BENCHMARK( "philox: next" ) {
+        sampler->seed(Point2i(1, 2), 3);
+        for (float &value : values)
+            value = sampler->next();
+        return values.back();
+    };
+    BENCHMARK( "philox: fill" ) {
+        sampler->seed(Point2i(1, 2), 3);
+        sampler->fill(values);
+        return values.back();
+    };
+}
@@ -0,0 +1,63 @@
+#include <catch_amalgamated.hpp>
+#include <samplers/sobol.cpp>
+
+#include <set>
+
+using namespace lightwave;
+
+TEST_CASE( "Sobol tests", "[sobol]" ) {
+    const Properties props;
+    Sobol sampler { props };
+
+    SECTION( "Sobol is deterministic" ) {
+        sampler.seed(Point2i(3, 7), 5);
+        const Point2 a = sampler.next2D();
+        sampler.seed(Point2i(3, 7), 5);
+        REQUIRE( sampler.next2D() == a );
+    }
+
+    SECTION( "Sobol stratifies all elementary intervals" ) {
+        constexpr int Count = 16;
+        for (int dimension = 0; dimension < 8; dimension++) {
+            std::vector<Point2> points;
+            for (int sample = 0; sample < Count; sample++) {
+                sampler.seed(Point2i(1, 2), sample);
+                for (int skipped = 0; skipped < dimension; skipped++)
+                    sampler.next2D();
+                points.push_back(sampler.next2D());
+            }
+
+            for (int columns = 1; columns <= Count; columns *= 2) {
+                const int rows = Count / columns;
+                std::vector<int> occupied(Count, 0);
+                for (const Point2 &p : points) {
+                    REQUIRE( p.x() >= 0 );
+                    REQUIRE( p.x() < 1 );
+                    REQUIRE( p.y() >= 0 );
+                    REQUIRE( p.y() < 1 );
+                    occupied[int(p.x() * columns) + columns * int(p.y() * rows)]++;
+                }
+                for (int cell = 0; cell < Count; cell++)
+                    REQUIRE( occupied[cell] == 1 );
+            }
+        }
+    }
+}
+
+TEST_CASE( "Blue noise Sobol does not reuse samples across pixels", "[sobol]" ) {
+    // the sequence index of a pixel exceeds 32 bits for large sample counts
+    Properties props;
+    props.set<int>("count", 1 << 16);
+    props.set<bool>("blueNoise", true);
+    Sobol sampler { props };
+
+    std::set<std::pair<float, float>> samples;
+    for (int y = 0; y < 512; y++) {
+        for (int x = 0; x < 512; x++) {
+            sampler.seed(Point2i(x, y), 0);
+            const Point2 p = sampler.next2D();
+            samples.emplace(p.x(), p.y());
+        }
+    }
+    REQUIRE( samples.size() == 512 * 512 );
+}
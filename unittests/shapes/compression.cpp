@@ -0,0 +1,130 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+#include "../../src/shapes/mesh.hpp"
+
+using namespace lightwave;
+
+namespace {
+
+ref<TriangleMesh> loadMesh(const std::string &filename, bool compress,
+                           bool quantize = false) {
+    Properties props { std::filesystem::path(__FILE__).parent_path() /
+                       "../../tests/meshes" };
+    props.set<std::string>("filename", filename);
+    props.set<bool>("compress", compress);
+    if (quantize)
+        props.set<bool>("quantize", true);
+    return std::dynamic_pointer_cast<TriangleMesh>(
+        Registry::create("shape", "mesh", props));
+}
+
+ref<Shape> instance(const ref<Shape> &shape, const ref<Texture> &alpha) {
+    Properties props;
+    props.addChild(shape);
+    if (alpha)
+        props.set("alpha", alpha);
+    return std::dynamic_pointer_cast<Shape>(
+        Registry::create("instance", "default", props));
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Vertex attribute encodings are accurate", "[compression]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+
+    for (float value : { 0.f, 1.f, -2.5f, 0.125f, 65504.f, 0x1p-24f })
+        REQUIRE( halfToFloat(floatToHalf(value)) == value );
+    REQUIRE( std::isinf(halfToFloat(floatToHalf(1e6f))) );
+    float maxHalfError = 0, maxAngle = 0;
+    for (int i = 0; i < 10000; i++) {
+        const float value = 8 * sampler->next() - 4;
+        maxHalfError = std::max(
+            maxHalfError,
+            std::abs(halfToFloat(floatToHalf(value)) - value) / std::abs(value));
+
+        const Vector n = squareToUniformSphere(sampler->next2D());
+        const Vector decoded = decodeOctahedral(encodeOctahedral(n));
+        // (the sine is more accurate than the cosine for small angles)
+        maxAngle = std::max(maxAngle, n.cross(decoded).length());
+    }
+    CAPTURE( maxHalfError, maxAngle );
+    REQUIRE( maxHalfError <= 0x1p-11f );
+    REQUIRE( maxAngle < 1e-4f );
+}
+
+TEST_CASE( "Compressed meshes agree with uncompressed ones", "[compression]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    const auto reference  = loadMesh("bunny.ply", false);
+    const auto compressed = loadMesh("bunny.ply", true);
+    const auto quantized  = loadMesh("bunny.ply", true, true);
+    REQUIRE( compressed->isCompressed() );
+    REQUIRE( compressed->numberOfTriangles() == reference->numberOfTriangles() );
+    // (32 + 12 bytes per vertex and triangle become 20 + 6 bytes, and 14 + 6
+    // bytes with quantized positions)
+    CAPTURE( reference->geometryMemory(), compressed->geometryMemory(),
+             quantized->geometryMemory() );
+    REQUIRE( compressed->geometryMemory() < 0.6f * reference->geometryMemory() );
+    REQUIRE( quantized->geometryMemory() < 0.5f * reference->geometryMemory() );
+
+    const Bounds bounds = reference->getBoundingBox();
+    const float size = bounds.diagonal().length();
+    int hits = 0, quantizedClose = 0;
+    for (int i = 0; i < 1000; i++) {
+        const Vector direction = squareToUniformSphere(sampler->next2D());
+        const Ray ray { bounds.center() + size * direction, -direction };
+        Intersection expected, its, quantizedIts;
+        const bool hit = reference->intersect(ray, expected, *sampler);
+        REQUIRE( compressed->intersect(ray, its, *sampler) == hit );
+        if (!hit)
+            continue;
+        hits++;
+        // positions are exact, only the attributes of the hit are encoded
+        // (up to rounding, as the kernels are compiled separately)
+        REQUIRE( std::abs(its.t - expected.t) <= 1e-5f * expected.t );
+        REQUIRE( (its.geometryNormal - expected.geometryNormal).length() < 1e-5f );
+        REQUIRE( (its.shadingNormal - expected.shadingNormal).length() < 1e-3f );
+        REQUIRE( (its.uv - expected.uv).length() < 1e-3f );
+
+        if (quantized->intersect(ray, quantizedIts, *sampler) &&
+            std::abs(quantizedIts.t - expected.t) < 1e-3f * size)
+            quantizedClose++;
+    }
+    CAPTURE( hits, quantizedClose );
+    REQUIRE( hits > 500 );
+    REQUIRE( quantizedClose > 0.99f * hits );
+}
+
+TEST_CASE( "Compressed meshes support alpha masks", "[compression]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    Properties checkerboardProps;
+    checkerboardProps.set<std::string>("scale", "3,5");
+    const auto alpha = std::dynamic_pointer_cast<Texture>(
+        Registry::create("texture", "checkerboard", checkerboardProps));
+    const auto reference  = instance(loadMesh("uvquad.ply", false), alpha);
+    const auto compressed = instance(loadMesh("uvquad.ply", true), alpha);
+
+    const Bounds bounds = reference->getBoundingBox();
+    int hits = 0, mismatches = 0;
+    for (int i = 0; i < 4096; i++) {
+        const Point target = bounds.min() + Vector(sampler->next(),
+                                                   sampler->next(), 0.5f) *
+                                                bounds.diagonal();
+        const Point origin = target + Vector(0.1f, 0.2f, 3);
+        const Ray ray { origin, (target - origin).normalized() };
+        Intersection expected, its;
+        const bool hit = reference->intersect(ray, expected, *sampler);
+        hits += hit;
+        // texture coordinates in half precision can flip samples close to
+        // the edges of the checkerboard
+        mismatches += compressed->intersect(ray, its, *sampler) != hit;
+    }
+    CAPTURE( hits, mismatches );
+    REQUIRE( hits > 1000 );
+    REQUIRE( mismatches < 0.01f * hits );
+}
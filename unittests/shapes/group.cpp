@@ -0,0 +1,110 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+using namespace lightwave;
+
+namespace {
+
+ref<Shape> mesh(const std::string &filename) {
+    Properties props { std::filesystem::path(__FILE__).parent_path() /
+                       "../../tests/meshes" };
+    props.set<std::string>("filename", filename);
+    return std::dynamic_pointer_cast<Shape>(
+        Registry::create("shape", "mesh", props));
+}
+
+ref<Instance> instance(const ref<Shape> &shape) {
+    Properties props;
+    props.addChild(shape);
+    return std::dynamic_pointer_cast<Instance>(
+        Registry::create("instance", "default", props));
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Groups flatten small untransformed meshes", "[group]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+
+    // two unique meshes that can be merged, and one that is instanced twice
+    // (each group gets its own instances, as flattening modifies them)
+    const auto instances = [](const ref<Shape> &bunny) {
+        const ref<Shape> shared = mesh("icosphere.ply");
+        return std::vector<ref<Instance>> {
+            instance(bunny),
+            instance(mesh("rubber_duck_toy_1k.ply")),
+            instance(shared),
+            instance(shared),
+        };
+    };
+    const auto group = [](const std::vector<ref<Instance>> &children,
+                          int flatten) {
+        Properties props;
+        for (const auto &child : children)
+            props.addChild(child);
+        props.set("flatten", flatten);
+        return std::dynamic_pointer_cast<Shape>(
+            Registry::create("shape", "group", props));
+    };
+    const auto regularInstances = instances(mesh("bunny.ply"));
+    const auto regular          = group(regularInstances, 0);
+
+    std::weak_ptr<Shape> original;
+    const auto flattenedInstances = [&] {
+        const ref<Shape> bunny = mesh("bunny.ply");
+        original               = bunny;
+        return instances(bunny);
+    }();
+    const auto flattened          = group(flattenedInstances, 1000000);
+    const auto index = [](const std::vector<ref<Instance>> &instances,
+                          const Instance *instance) {
+        for (size_t i = 0; i < instances.size(); i++) {
+            if (instances[i].get() == instance)
+                return int(i);
+        }
+        return -1;
+    };
+
+    SECTION( "Shared meshes stay instanced" ) {
+        REQUIRE_THAT( flattened->toString(), Catch::Matchers::ContainsSubstring("parts = 2") );
+        REQUIRE_THAT( regular->toString(), !Catch::Matchers::ContainsSubstring("parts =") );
+    }
+
+    SECTION( "Merged meshes are released" ) {
+        REQUIRE( original.expired() );
+        REQUIRE( flattenedInstances[0]->isMerged() );
+        REQUIRE( flattenedInstances[0]->shape() == flattenedInstances[1]->shape() );
+        REQUIRE( !flattenedInstances[2]->isMerged() );
+    }
+
+    SECTION( "Flattened groups report the same hits" ) {
+        const Bounds bounds = regular->getBoundingBox();
+        const Point eye     = bounds.center() + Vector(0.3f, 0.2f, 2) * bounds.diagonal().length();
+        constexpr int Resolution = 48;
+
+        int hits = 0;
+        for (int y = 0; y < Resolution; y++) {
+            for (int x = 0; x < Resolution; x++) {
+                const Point target =
+                    bounds.min() + Vector((x + 0.5f) / Resolution,
+                                          (y + 0.5f) / Resolution, 0.5f) *
+                                       bounds.diagonal();
+                const Ray ray { eye, (target - eye).normalized() };
+
+                Intersection expected, its;
+                REQUIRE( regular->intersect(ray, expected, *sampler) ==
+                         flattened->intersect(ray, its, *sampler) );
+                if (!expected)
+                    continue;
+                REQUIRE( its.t == expected.t );
+                REQUIRE( index(flattenedInstances, its.instance) ==
+                         index(regularInstances, expected.instance) );
+                REQUIRE( its.shadingNormal == expected.shadingNormal );
+                hits++;
+            }
+        }
+        REQUIRE( hits > 100 );
+    }
+}
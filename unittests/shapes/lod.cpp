@@ -0,0 +1,113 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+#include "../../src/shapes/mesh.hpp"
+
+using namespace lightwave;
+
+namespace {
+
+ref<TriangleMesh> bunny(int lods) {
+    Properties props { std::filesystem::path(__FILE__).parent_path() /
+                       "../../tests/meshes" };
+    props.set<std::string>("filename", "bunny.ply");
+    props.set<int>("lods", lods);
+    return std::dynamic_pointer_cast<TriangleMesh>(
+        Registry::create("shape", "mesh", props));
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Simplified levels of detail stay close to the mesh", "[lod]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    const auto mesh = bunny(3);
+    REQUIRE( mesh->withDetail(0) == nullptr );
+
+    // levels get coarser as the tolerated error grows
+    int previous = mesh->numberOfTriangles();
+    const Bounds bounds = mesh->getBoundingBox();
+    const float size = bounds.diagonal().length();
+    for (float error = size / 1000; error < size; error *= 2) {
+        const auto level =
+            std::dynamic_pointer_cast<TriangleMesh>(mesh->withDetail(error));
+        if (!level)
+            continue;
+        REQUIRE( level->numberOfTriangles() <= previous );
+        previous = level->numberOfTriangles();
+    }
+    REQUIRE( previous * 16 < mesh->numberOfTriangles() );
+
+    // rays towards the center find the coarsest level close to the mesh
+    const auto coarsest = mesh->withDetail(size);
+    REQUIRE( coarsest != nullptr );
+    int hits = 0, close = 0;
+    for (int i = 0; i < 1000; i++) {
+        const Vector direction = squareToUniformSphere(sampler->next2D());
+        const Ray ray { bounds.center() + size * direction, -direction };
+        Intersection expected, its;
+        const bool hitsMesh  = mesh->intersect(ray, expected, *sampler);
+        const bool hitsLevel = coarsest->intersect(ray, its, *sampler);
+        if (!hitsMesh || !hitsLevel)
+            continue;
+        hits++;
+        if (std::abs(its.t - expected.t) < size / 20)
+            close++;
+    }
+    CAPTURE( hits, close );
+    REQUIRE( hits > 500 );
+    REQUIRE( close > 0.9f * hits );
+}
+
+TEST_CASE( "Instances select the level of detail by distance", "[lod]" ) {
+    const auto mesh = bunny(2);
+    Properties props;
+    props.addChild(mesh);
+    const auto instance = std::dynamic_pointer_cast<Instance>(
+        Registry::create("instance", "default", props));
+    const Bounds bounds = instance->getBoundingBox();
+    const float size = bounds.diagonal().length();
+
+    // close to the mesh, no simplification is acceptable
+    instance->selectDetail(bounds.center() + Vector(0, 0, size), 1e-5f);
+    REQUIRE( instance->shape() == mesh.get() );
+
+    // far away, the coarsest level suffices
+    instance->selectDetail(bounds.center() + Vector(0, 0, 1e4f * size), 1e-3f);
+    REQUIRE( instance->shape() == mesh->withDetail(size).get() );
+}
+
+TEST_CASE( "Levels of detail that are not selected are released", "[lod]" ) {
+    const auto mesh = bunny(3);
+    const float size = mesh->getBoundingBox().diagonal().length();
+    const auto coarsest = mesh->withDetail(size);
+    REQUIRE( coarsest != nullptr );
+    mesh->releaseUnusedDetail();
+
+    // only the selected level remains
+    for (float error = size / 1000; error <= size; error *= 2) {
+        const auto level = mesh->withDetail(error);
+        REQUIRE( (level == nullptr || level == coarsest) );
+    }
+}
+
+TEST_CASE( "Flat shaded meshes are simplified", "[lod]" ) {
+    // split the bunny into separate vertices for each triangle, as flat
+    // shaded meshes are
+    const auto smooth = bunny(0);
+    std::vector<Vector3i> triangles;
+    std::vector<Vertex> vertices;
+    for (int i = 0; i < smooth->numberOfTriangles(); i++) {
+        const Vector3i indices = smooth->triangle(i);
+        triangles.push_back(Vector3i(0, 1, 2) + Vector3i(int(vertices.size())));
+        for (int j = 0; j < 3; j++)
+            vertices.push_back(smooth->vertex(indices[j]));
+    }
+
+    const std::vector<int> counts { int(triangles.size()) / 16 };
+    const auto levels = simplifyMesh(triangles, vertices, counts);
+    REQUIRE( levels.size() == 1 );
+    REQUIRE( int(levels[0].indices.size()) <= counts[0] );
+}
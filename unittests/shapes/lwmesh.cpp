@@ -0,0 +1,112 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+#include "../../src/shapes/mesh.hpp"
+
+#include <fstream>
+
+using namespace lightwave;
+
+namespace {
+
+ref<TriangleMesh> loadMesh(const std::filesystem::path &path, bool cache) {
+    Properties props;
+    props.set<std::string>("filename", path.string());
+    props.set<bool>("cache", cache);
+    return std::dynamic_pointer_cast<TriangleMesh>(
+        Registry::create("shape", "mesh", props));
+}
+
+/// @brief Counts the rays towards the center of the mesh for which both
+/// meshes report different hits.
+int countMismatches(const TriangleMesh &a, const TriangleMesh &b) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    const Bounds bounds = a.getBoundingBox();
+    const float size = bounds.diagonal().length();
+    int mismatches = 0;
+    for (int i = 0; i < 1000; i++) {
+        const Vector direction = squareToUniformSphere(sampler->next2D());
+        const Ray ray { bounds.center() + size * direction, -direction };
+        Intersection expected, its;
+        const bool hitsA = a.intersect(ray, expected, *sampler);
+        const bool hitsB = b.intersect(ray, its, *sampler);
+        if (hitsA != hitsB || its.t != expected.t ||
+            its.shadingNormal != expected.shadingNormal)
+            mismatches++;
+    }
+    return mismatches;
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Meshes are cached in lwmesh files next to their PLY files", "[lwmesh]" ) {
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / "lightwave-lwmesh-test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    const std::filesystem::path ply = directory / "bunny.ply";
+    const std::filesystem::path cache = directory / "bunny.lwmesh";
+    std::filesystem::copy_file(std::filesystem::path(__FILE__).parent_path() /
+                                   "../../tests/meshes/bunny.ply",
+                               ply);
+
+    const auto reference = loadMesh(ply, false);
+    REQUIRE( !std::filesystem::exists(cache) );
+
+    // caching is opt-in, so that source directories are left alone
+    Properties defaultProps;
+    defaultProps.set<std::string>("filename", ply.string());
+    Registry::create("shape", "mesh", defaultProps);
+    REQUIRE( !std::filesystem::exists(cache) );
+
+    // the first load writes the cache, which the second load maps
+    const auto parsed = loadMesh(ply, true);
+    REQUIRE( std::filesystem::exists(cache) );
+    REQUIRE( !parsed->vertices().isMapped() );
+    const auto mapped = loadMesh(ply, true);
+    REQUIRE( mapped->triangles().isMapped() );
+    REQUIRE( mapped->vertices().isMapped() );
+    REQUIRE( mapped->nodes().isMapped() );
+    REQUIRE( mapped->primitiveOrder().isMapped() );
+    REQUIRE( mapped->numberOfTriangles() == reference->numberOfTriangles() );
+    REQUIRE( countMismatches(*reference, *mapped) == 0 );
+
+    // lwmesh files can also be loaded directly
+    const std::filesystem::path converted = directory / "converted.lwmesh";
+    reference->save(converted);
+    const auto direct = loadMesh(converted, false);
+    REQUIRE( direct->triangles().isMapped() );
+    REQUIRE( countMismatches(*reference, *direct) == 0 );
+
+    SECTION( "outdated caches are rebuilt" ) {
+        // appending a comment changes the hash, but not the mesh
+        std::ofstream(ply, std::ios::app) << "\n";
+        const auto rebuilt = loadMesh(ply, true);
+        REQUIRE( !rebuilt->triangles().isMapped() );
+        REQUIRE( loadMesh(ply, true)->triangles().isMapped() );
+    }
+
+    SECTION( "caches written by other versions of the loader are rebuilt" ) {
+        reference->save(cache, lwmesh::hash(MappedFile(ply)),
+                        PlyLoaderVersion + 1);
+        REQUIRE( !loadMesh(ply, true)->triangles().isMapped() );
+        REQUIRE( loadMesh(ply, true)->triangles().isMapped() );
+    }
+
+    SECTION( "corrupted caches are ignored" ) {
+        std::filesystem::resize_file(cache,
+                                     std::filesystem::file_size(cache) / 2);
+        const auto rebuilt = loadMesh(ply, true);
+        REQUIRE( !rebuilt->triangles().isMapped() );
+        REQUIRE( countMismatches(*reference, *rebuilt) == 0 );
+        REQUIRE( loadMesh(ply, true)->triangles().isMapped() );
+
+        std::filesystem::resize_file(converted, 100);
+        REQUIRE_THROWS( loadMesh(converted, false) );
+    }
+
+    std::filesystem::remove_all(directory);
+}
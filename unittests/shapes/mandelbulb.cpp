@@ -0,0 +1,55 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+using namespace lightwave;
+
+namespace {
+
+ref<Shape> mandelbulb(int grid) {
+    Properties props;
+    props.set("n", 8.f);
+    props.set("grid", grid);
+    return std::dynamic_pointer_cast<Shape>(
+        Registry::create("shape", "mandelbulb", props));
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Mandelbulbs march within their bounding sphere", "[mandelbulb]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    const auto exact = mandelbulb(0);
+    // the distance estimate is no bound, hence the grid is not used
+    REQUIRE_THAT( mandelbulb(32)->toString(), Catch::Matchers::ContainsSubstring("grid = 0") );
+
+    // shoot rays from far outside (beyond the previous marching distance
+    // limit) at the bulb
+    const Bounds bounds = exact->getBoundingBox();
+    const Point eye     = Point(3, 4, -30);
+    constexpr int Resolution = 32;
+
+    int hits = 0;
+    for (int y = 0; y < Resolution; y++) {
+        for (int x = 0; x < Resolution; x++) {
+            const Point target =
+                bounds.min() + Vector((x + 0.5f) / Resolution,
+                                      (y + 0.5f) / Resolution, 0.5f) *
+                                   bounds.diagonal();
+            const Ray ray { eye, (target - eye).normalized() };
+
+            Intersection expected;
+            if (!exact->intersect(ray, expected, *sampler))
+                continue;
+            REQUIRE( bounds.includes(expected.position) );
+
+            // hits further away than previous ones are discarded
+            Intersection closer;
+            closer.t = expected.t - 0.01f;
+            REQUIRE( !exact->intersect(ray, closer, *sampler) );
+            hits++;
+        }
+    }
+    REQUIRE( hits > 100 );
+}
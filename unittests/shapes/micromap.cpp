@@ -0,0 +1,115 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+using namespace lightwave;
+
+namespace {
+
+ref<Instance> maskedQuad(const ref<Texture> &alpha) {
+    Properties meshProps { std::filesystem::path(__FILE__).parent_path() /
+                           "../../tests/meshes" };
+    meshProps.set<std::string>("filename", "uvquad.ply");
+    Properties props;
+    props.addChild(Registry::create("shape", "mesh", meshProps));
+    if (alpha)
+        props.set("alpha", alpha);
+    return std::dynamic_pointer_cast<Instance>(
+        Registry::create("instance", "default", props));
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Opacity micromaps discard transparent hits", "[micromap]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    Properties checkerboardProps;
+    checkerboardProps.set<std::string>("scale", "3,5");
+    const auto alpha = std::dynamic_pointer_cast<Texture>(
+        Registry::create("texture", "checkerboard", checkerboardProps));
+
+    const auto masked   = maskedQuad(alpha);
+    const auto unmasked = maskedQuad(nullptr);
+    REQUIRE( masked->variant() == "identity, opacity micromap" );
+
+    // shoot rays at the quad from both sides, and check that exactly those
+    // hits survive for which the alpha mask is one
+    const Bounds bounds = unmasked->getBoundingBox();
+    constexpr int Resolution = 64;
+    int opaque = 0, transparent = 0;
+    for (int y = 0; y < Resolution; y++) {
+        for (int x = 0; x < Resolution; x++) {
+            const Point target =
+                bounds.min() + Vector((x + 0.5f) / Resolution,
+                                      (y + 0.5f) / Resolution, 0.5f) *
+                                   bounds.diagonal();
+            for (float side : { -1.f, +1.f }) {
+                const Point origin = target + Vector(0.1f, 0.2f, side * 3);
+                const Ray ray { origin, (target - origin).normalized() };
+
+                Intersection expected;
+                if (!unmasked->intersect(ray, expected, *sampler))
+                    continue;
+                const bool isOpaque = alpha->evaluate(expected.uv).r() == 1;
+
+                Intersection its;
+                REQUIRE( masked->intersect(ray, its, *sampler) == isOpaque );
+                if (isOpaque) {
+                    REQUIRE( its.t == expected.t );
+                    opaque++;
+                } else {
+                    transparent++;
+                }
+            }
+        }
+    }
+    REQUIRE( opaque > 1000 );
+    REQUIRE( transparent > 1000 );
+}
+
+TEST_CASE( "Opacity micromaps do not miss small features of the mask", "[micromap]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    for (const int resolution : { 16, 256 }) {
+        // a transparent mask with a few isolated opaque texels, which are
+        // much smaller than micro-triangles at the higher resolution
+        const auto image = std::make_shared<Image>(Point2i(resolution));
+        for (int y = 0; y < resolution; y++)
+            for (int x = 0; x < resolution; x++)
+                (*image)(Point2i(x, y)) =
+                    Color((x * 7 + y * 13) % 61 == 0 ? 1.f : 0.f);
+        Properties textureProps;
+        textureProps.addChild(image);
+        textureProps.set<std::string>("filter", "nearest");
+        const auto alpha = std::dynamic_pointer_cast<Texture>(
+            Registry::create("texture", "image", textureProps));
+
+        const auto masked   = maskedQuad(alpha);
+        const auto unmasked = maskedQuad(nullptr);
+
+        const Bounds bounds = unmasked->getBoundingBox();
+        const int raysPerSide = 2 * resolution;
+        int opaque = 0;
+        for (int y = 0; y < raysPerSide; y++) {
+            for (int x = 0; x < raysPerSide; x++) {
+                const Point target =
+                    bounds.min() + Vector((x + 0.5f) / raysPerSide,
+                                          (y + 0.5f) / raysPerSide, 0.5f) *
+                                       bounds.diagonal();
+                const Point origin = target + Vector(0, 0, 3);
+                const Ray ray { origin, (target - origin).normalized() };
+
+                Intersection expected;
+                if (!unmasked->intersect(ray, expected, *sampler))
+                    continue;
+                const bool isOpaque = alpha->evaluate(expected.uv).r() == 1;
+
+                Intersection its;
+                REQUIRE( masked->intersect(ray, its, *sampler) == isOpaque );
+                opaque += isOpaque;
+            }
+        }
+        REQUIRE( opaque > 0 );
+    }
+}
@@ -0,0 +1,127 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave.hpp>
+
+using namespace lightwave;
+
+namespace {
+
+ref<Shape> shape(const std::string &type, const Properties &props = {}) {
+    return std::dynamic_pointer_cast<Shape>(
+        Registry::create("shape", type, props));
+}
+
+ref<Shape> sdfSphere(const std::string &center, float radius) {
+    Properties props;
+    props.set<std::string>("center", center);
+    props.set("radius", radius);
+    return shape("sdfsphere", props);
+}
+
+} // namespace
+
+// clang-format off
+
+TEST_CASE( "Signed distance fields", "[sdf]" ) {
+    const auto sampler = std::dynamic_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    // misses are reported with an infinite distance
+    const auto intersect = [&](const Shape &shape, const Ray &ray) {
+        Intersection its;
+        shape.intersect(ray, its, *sampler);
+        return its;
+    };
+
+    SECTION( "Sphere tracing agrees with analytic spheres" ) {
+        const auto sphere = shape("sphere");
+        for (float relaxation : { 1.f, 1.6f }) {
+            Properties props;
+            props.set("relaxation", relaxation);
+            const auto traced = shape("sdfsphere", props);
+
+            int hits = 0;
+            for (int y = 0; y < 32; y++) {
+                for (int x = 0; x < 32; x++) {
+                    const Point origin(0.3f, -0.2f, -5);
+                    const Point target((x + 0.5f) / 16 - 1, (y + 0.5f) / 16 - 1, 0);
+                    const Ray ray { origin, (target - origin).normalized() };
+
+                    const Intersection expected = intersect(*sphere, ray);
+                    const Intersection its      = intersect(*traced, ray);
+                    // grazing rays may or may not come close enough
+                    if (std::isinf(expected.t) || std::isinf(its.t))
+                        continue;
+                    // tracing stops slightly before the surface, which
+                    // matters for grazing rays
+                    REQUIRE( Vector(its.position).length() == Catch::Approx(1).margin(2 * Epsilon) );
+                    REQUIRE( its.t == Catch::Approx(expected.t).margin(1e-2) );
+                    REQUIRE( its.geometryNormal.dot(expected.geometryNormal) > 0.999f );
+                    hits++;
+                }
+            }
+            REQUIRE( hits > 500 );
+        }
+    }
+
+    SECTION( "Rays leaving the surface do not hit it again" ) {
+        const auto traced = sdfSphere("0,0,0", 1);
+        const Ray leaving { Point(0, 0, -1), Vector(0, 0.6f, -0.8f) };
+        REQUIRE( std::isinf(intersect(*traced, leaving).t) );
+        // rays into the sphere find its other side
+        const Ray entering { Point(0, 0, -1), Vector(0, 0, 1) };
+        REQUIRE( intersect(*traced, entering).t == Catch::Approx(2).margin(1e-3) );
+    }
+
+    SECTION( "Constructive solid geometry" ) {
+        const auto csg = [&](const std::string &operation) {
+            Properties props;
+            props.set<std::string>("operation", operation);
+            props.addChild(sdfSphere("0,0,0", 1));
+            props.addChild(sdfSphere("0,0,-1", 0.5f));
+            return shape("csg", props);
+        };
+        const Ray ray { Point(0, 0, -5), Vector(0, 0, 1) };
+        REQUIRE( intersect(*csg("union"), ray).t == Catch::Approx(3.5f).margin(1e-3) );
+        REQUIRE( intersect(*csg("intersection"), ray).t == Catch::Approx(4).margin(1e-3) );
+        REQUIRE( intersect(*csg("difference"), ray).t == Catch::Approx(4.5f).margin(1e-3) );
+        REQUIRE( intersect(*csg("difference"), ray).geometryNormal.z() == Catch::Approx(-1).margin(1e-3) );
+
+        const Bounds bounds = csg("intersection")->getBoundingBox();
+        REQUIRE( bounds.min().z() == Catch::Approx(-1) );
+        REQUIRE( bounds.max().z() == Catch::Approx(-0.5f) );
+    }
+
+    SECTION( "Baked distance grids do not change hits" ) {
+        const auto csg = [&](int grid, float smoothness) {
+            Properties props;
+            props.set<std::string>("operation", "difference");
+            props.set("grid", grid);
+            props.set("smoothness", smoothness);
+            props.addChild(sdfSphere("0,0,0", 1));
+            props.addChild(sdfSphere("0.5,0.5,-1", 0.6f));
+            return shape("csg", props);
+        };
+        // smooth differences enlarge distances, which the grid cannot handle
+        REQUIRE_THAT( csg(16, 0.2f)->toString(), !Catch::Matchers::ContainsSubstring("grid = 16") );
+
+        const auto exact = csg(0, 0);
+        const auto baked = csg(16, 0);
+        REQUIRE_THAT( baked->toString(), Catch::Matchers::ContainsSubstring("grid = 16") );
+        int hits = 0;
+        for (int y = 0; y < 32; y++) {
+            for (int x = 0; x < 32; x++) {
+                const Point origin(0.3f, -0.2f, -5);
+                const Point target((x + 0.5f) / 16 - 1, (y + 0.5f) / 16 - 1, 0);
+                const Ray ray { origin, (target - origin).normalized() };
+
+                const Intersection expected = intersect(*exact, ray);
+                const Intersection its      = intersect(*baked, ray);
+                REQUIRE( std::isinf(its.t) == std::isinf(expected.t) );
+                if (std::isinf(expected.t))
+                    continue;
+                REQUIRE( its.t == Catch::Approx(expected.t).margin(1e-3) );
+                hits++;
+            }
+        }
+        REQUIRE( hits > 300 );
+    }
+}